@@ -0,0 +1,32 @@
+/** @file benchmark.c
+ *
+ * @brief Measures HAL and wrapper performance and prints it as CSV
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 Irnas.  All rights reserved.
+ */
+
+#include <zephyr.h>
+#include "lr1110.h"
+
+
+#if DT_HAS_COMPAT_STATUS_OKAY(semtech_lr1110)
+LR1110_DT_INST_DEFINE(0, lr1110);
+#else
+lr1110_t lr1110;
+#endif
+
+int main()
+{
+#if !DT_HAS_COMPAT_STATUS_OKAY(semtech_lr1110)
+    lr1110_set_device_config(&lr1110, DEVICE_BOARD);
+#endif
+    struct lr1110_benchmark_cfg cfg = lr1110_benchmark_default_cfg();
+
+    lr1110_benchmark_print_header();
+    lr1110_benchmark_run(&lr1110, &cfg, lr1110_benchmark_print_cb, NULL);
+    lr1110_benchmark_print_meta(&lr1110);
+    printk("# done\n");
+
+    return 0;
+}
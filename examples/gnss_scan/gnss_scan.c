@@ -0,0 +1,90 @@
+/** @file gnss_scan.c
+ *
+ * @brief Runs autonomous GNSS scans and prints detected satellites and
+ *        NAV message, which can be sent to a solver
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 Irnas.  All rights reserved.
+ */
+
+#include <zephyr.h>
+#include "lr1110.h"
+
+
+#if DT_HAS_COMPAT_STATUS_OKAY(semtech_lr1110)
+LR1110_DT_INST_DEFINE(0, lr1110);
+#else
+lr1110_t lr1110;
+#endif
+
+static uint8_t nav_message[LR1110_GNSS_MAX_SIZE_ARRAY];
+static lr1110_gnss_detected_satellite_t satellites[LR1110_GNSS_MAX_SATELLITES];
+
+static struct lr1110_gnss_scan_async scan_async;
+static struct gnss_diagnostics scan_diagnostics;
+static K_SEM_DEFINE(scan_sem, 0, 1);
+
+/* Radio is not locked during the scan, so other threads could use it */
+static void scan_done(void * context,
+                      int status,
+                      struct gnss_diagnostics gnss_diagnostics,
+                      void * user_data)
+{
+    if (status) {
+        printk("GNSS scan failed: %d\n", status);
+    }
+    scan_diagnostics = gnss_diagnostics;
+    k_sem_give(&scan_sem);
+}
+
+int main()
+{
+    printk("Hello World! %s\n", CONFIG_BOARD);
+
+#if !DT_HAS_COMPAT_STATUS_OKAY(semtech_lr1110)
+    lr1110_set_device_config(&lr1110, DEVICE_BOARD);
+#endif
+    struct lr1110_init_diagnostics init_diagnostics = lr1110_init(&lr1110);
+    printk("Init took %d us\n", init_diagnostics.init_duration_us);
+
+    struct gnss_settings gnss_settings = lr1110_get_default_gnss_settings();
+
+    while(1)
+    {
+        int err = lr1110_start_gnss_scan(&lr1110, gnss_settings,
+                                         &scan_async, scan_done, NULL);
+        if (err) {
+            printk("Starting GNSS scan failed: %d\n", err);
+            k_sleep(K_MSEC(10000));
+            continue;
+        }
+        k_sem_take(&scan_sem, K_FOREVER);
+
+        struct gnss_diagnostics gnss_diagnostics = scan_diagnostics;
+
+        lr1110_print_gnss_diagnostics(gnss_diagnostics);
+
+        int nb = lr1110_get_gnss_detected_satellites(&lr1110, 
+                                                     gnss_diagnostics,
+                                                     satellites,
+                                                     ARRAY_SIZE(satellites));
+        for (int i = 0; i < nb; i++)
+        {
+            printk("%2d: satellite %3d, C/N0: %d dB\n",
+                   i, satellites[i].satellite_id, satellites[i].cnr);
+        }
+
+        int size = lr1110_get_gnss_scan_results(&lr1110, gnss_diagnostics,
+                                                nav_message,
+                                                sizeof(nav_message));
+        if (size > 0 && nav_message[0] == LR1110_GNSS_DESTINATION_SOLVER) {
+            printk("NAV: ");
+            for (int i = 0; i < size; i++) {
+                printk("%02x", nav_message[i]);
+            }
+            printk("\n");
+        }
+
+        k_sleep(K_MSEC(10000));
+    }
+}
@@ -0,0 +1,68 @@
+/** @file lora.c
+ *
+ * @brief Sends a counter every few seconds and prints received packets.
+ *        Radio stays in receive between sends, CPU sleeps in between.
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 Irnas.  All rights reserved.
+ */
+
+#include <zephyr.h>
+#include "lr1110.h"
+
+
+#if DT_HAS_COMPAT_STATUS_OKAY(semtech_lr1110)
+LR1110_DT_INST_DEFINE(0, lr1110);
+#else
+lr1110_t lr1110;
+#endif
+
+static struct lr1110_lora lora;
+
+static void tx_done(struct lr1110_lora * lora, int status, void * user_data)
+{
+    if (status) {
+        printk("Send failed: %d\n", status);
+    }
+}
+
+int main()
+{
+    printk("Hello World! %s\n", CONFIG_BOARD);
+
+#if !DT_HAS_COMPAT_STATUS_OKAY(semtech_lr1110)
+    lr1110_set_device_config(&lr1110, DEVICE_BOARD);
+#endif
+    lr1110_init(&lr1110);
+
+    if (lr1110_lora_init(&lr1110, &lora, lr1110_get_default_lora_settings())) {
+        printk("LoRa init failed\n");
+        return 0;
+    }
+    lr1110_lora_receive_start(&lora, NULL, NULL);
+
+    uint32_t counter = 0;
+    int64_t next_send = k_uptime_get();
+
+    while(1)
+    {
+        struct lr1110_lora_packet packet;
+        int64_t now = k_uptime_get();
+
+        if (now >= next_send) {
+            uint8_t payload[] = { counter >> 24, counter >> 16, 
+                                  counter >> 8, counter };
+
+            lr1110_lora_send(&lora, payload, sizeof(payload), tx_done, NULL);
+            counter++;
+            next_send = now + 5000;
+        }
+
+        if (!lr1110_lora_read(&lora, &packet, K_MSEC(next_send - now))) {
+            printk("Received %d bytes, rssi: %d dBm, snr: %d dB\n",
+                   packet.length, packet.rssi, packet.snr);
+        }
+    }
+
+    return 0;
+}
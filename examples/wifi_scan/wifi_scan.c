@@ -9,14 +9,63 @@
 #include "lr1110.h"
 
 
+#if DT_HAS_COMPAT_STATUS_OKAY(semtech_lr1110)
+LR1110_DT_INST_DEFINE(0, lr1110);
+#else
 lr1110_t lr1110;
+#endif
+
+static struct lr1110_wifi_scan_async scan_async;
+static struct wifi_diagnostics scan_diagnostics;
+static K_SEM_DEFINE(scan_sem, 0, 1);
+
+/* Radio is not locked during the scan, so other threads could use it */
+static void scan_done(void * context,
+                      int status,
+                      struct wifi_diagnostics wifi_diagnostics,
+                      void * user_data)
+{
+    if (status) {
+        printk("Wifi scan failed: %d\n", status);
+    }
+    scan_diagnostics = wifi_diagnostics;
+    k_sem_give(&scan_sem);
+}
+
+/* Called for every few results, while the rest are still in the radio */
+static bool print_results(void * context,
+                          const lr1110_wifi_extended_full_result_t * results,
+                          uint8_t start_index,
+                          uint8_t nb_results,
+                          void * user_data)
+{
+    for (int i = 0; i < nb_results; i++)
+    {
+        const uint8_t * mac = results[i].mac_address_3;
+
+        printk("%2d: %02x:%02x:%02x:%02x:%02x:%02x, rssi: %d\n", 
+               start_index + i, 
+               mac[0], mac[1], mac[2], mac[3], mac[4], mac[5], 
+               results[i].rssi);
+    }
+    return true;
+}
 
 int main()
 {
 	printk("Hello World! %s\n", CONFIG_BOARD);
 
+#if !DT_HAS_COMPAT_STATUS_OKAY(semtech_lr1110)
     lr1110_set_device_config(&lr1110, DEVICE_BOARD);
-    lr1110_init(&lr1110);
+#endif
+    struct lr1110_init_diagnostics init_diagnostics = lr1110_init(&lr1110);
+    printk("Init took %d us\n", init_diagnostics.init_duration_us);
+
+    struct lr1110_spi_tune_result tune_result;
+    if (!lr1110_spi_autotune(&lr1110, &tune_result)) {
+        printk("SPI clock: %d Hz, errors: %d\n", 
+               tune_result.frequency, tune_result.errors);
+    }
 
     lr1110_display_trx_version(&lr1110);
 
@@ -24,18 +73,26 @@ int main()
 
     lr1110_init_wifi_scan(&lr1110);
 
-    //lr1110_wifi_basic_complete_result_t results[LR1110_WIFI_MAX_RESULTS] = {0};
-    lr1110_wifi_extended_full_result_t results[32] = {0};
-
     while(1)
     {
-        struct wifi_diagnostics wifi_diagnostics = 
-            lr1110_execute_wifi_scan(&lr1110, wifi_settings);
+        int err = lr1110_start_wifi_scan(&lr1110, wifi_settings, 
+                                         &scan_async, scan_done, NULL);
+        if (err) {
+            printk("Starting wifi scan failed: %d\n", err);
+            k_sleep(K_MSEC(1000));
+            continue;
+        }
+        k_sem_take(&scan_sem, K_FOREVER);
+
+        struct wifi_diagnostics wifi_diagnostics = scan_diagnostics;
+
+        printk("Scan duration: %d ms, results: %d\n",
+               wifi_diagnostics.wifi_scan_duration,
+               wifi_diagnostics.num_wifi_results);
 
-        //lr1110_get_wifi_scan_results(&lr1110, wifi_diagnostics, results);
-        lr1110_get_ext_wifi_scan_results(&lr1110, wifi_diagnostics, results);
-        //lr1110_print_wifi_scan_results(&lr1110, wifi_diagnostics, results);
-        lr1110_print_ext_wifi_scan_results(&lr1110, wifi_diagnostics, results);
+        /* Results are read few at a time, no array for all of them */
+        lr1110_stream_ext_wifi_scan_results(&lr1110, wifi_diagnostics, 0, 
+                                            print_results, NULL);
 
         k_sleep(K_MSEC(1000));
     }
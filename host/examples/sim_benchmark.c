@@ -0,0 +1,44 @@
+/** @file sim_benchmark.c
+ *
+ * @brief Benchmark of HAL and wrapper layers against simulated LR1110. 
+ *        Output has the same format as examples/benchmark on target.
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 Irnas.  All rights reserved.
+ */
+
+#include <zephyr.h>
+#include "lr1110.h"
+#include "lr1110_sim.h"
+
+static lr1110_t lr1110;
+
+int main()
+{
+    struct lr1110_sim_ap aps[LR1110_WIFI_MAX_RESULTS];
+
+    /* Enough APs on all channels for the largest fetch */
+    for (uint8_t i = 0; i < ARRAY_SIZE(aps); i++)
+    {
+        aps[i] = (struct lr1110_sim_ap) {
+            .mac = { 0x02, 0x00, 0x00, 0x00, 0x00, i },
+            .rssi = -40 - i,
+            .channel = 1 + i % 14,
+            .signal_type = 1 + i % 3,
+            .ssid = "benchmark",
+        };
+    }
+
+    lr1110_sim_init(0, NULL);
+    lr1110_sim_add_wifi_scan(0, aps, ARRAY_SIZE(aps));
+    lr1110_sim_attach(0, &lr1110);
+
+    struct lr1110_benchmark_cfg cfg = lr1110_benchmark_default_cfg();
+
+    lr1110_benchmark_print_header();
+    lr1110_benchmark_run(&lr1110, &cfg, lr1110_benchmark_print_cb, NULL);
+    lr1110_benchmark_print_meta(&lr1110);
+    printk("# done\n");
+
+    return 0;
+}
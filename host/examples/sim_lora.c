@@ -0,0 +1,81 @@
+/** @file sim_lora.c
+ *
+ * @brief LoRa send and continuous receive against simulated LR1110.
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 Irnas.  All rights reserved.
+ */
+
+#include <zephyr.h>
+#include "lr1110.h"
+#include "lr1110_sim.h"
+
+#define PACKETS     8
+
+static lr1110_t lr1110;
+static struct lr1110_lora lora;
+
+static struct k_sem tx_sem;
+
+static void tx_done(struct lr1110_lora * lora, int status, void * user_data)
+{
+    printk("Send done: %d\n", status);
+    k_sem_give(&tx_sem);
+}
+
+int main()
+{
+    static const uint8_t hello[] = "hello";
+    static const uint8_t sensor[] = { 0x01, 0x17, 0x42 };
+    const struct lr1110_sim_lora_packet script[] = {
+        { hello, sizeof(hello), -60, 9, false },
+        { sensor, sizeof(sensor), -98, -3, false },
+        { sensor, sizeof(sensor), -120, -15, true },
+    };
+
+    k_sem_init(&tx_sem, 0, 1);
+    lr1110_sim_init(0, NULL);
+    for (uint8_t i = 0; i < ARRAY_SIZE(script); i++) {
+        lr1110_sim_add_lora_packet(0, &script[i]);
+    }
+    lr1110_sim_attach(0, &lr1110);
+    lr1110_init(&lr1110);
+
+    if (lr1110_lora_init(&lr1110, &lora, lr1110_get_default_lora_settings())) {
+        printk("LoRa init failed\n");
+        return 1;
+    }
+    lr1110_lora_receive_start(&lora, NULL, NULL);
+
+    for (int i = 0; i < PACKETS; i++)
+    {
+        struct lr1110_lora_packet packet;
+
+        if (lr1110_lora_read(&lora, &packet, K_MSEC(100))) {
+            printk("No packet\n");
+            break;
+        }
+        printk("%u: %d bytes, rssi: %d, snr: %d, first: %02x\n",
+               packet.timestamp, packet.length, packet.rssi, packet.snr,
+               packet.data[0]);
+
+        /* Reply in the middle, receiving goes on afterwards */
+        if (i == PACKETS / 2) {
+            lr1110_lora_send(&lora, hello, sizeof(hello), tx_done, NULL);
+            k_sem_take(&tx_sem, K_MSEC(100));
+        }
+    }
+    lr1110_lora_receive_stop(&lora);
+
+    struct lr1110_lora_stats stats;
+    lr1110_lora_get_stats(&lora, &stats);
+
+    printk("TX: %d, timeouts: %d\n", stats.tx_packets, stats.tx_timeouts);
+    printk("RX: %d, CRC errors: %d, header errors: %d, dropped: %d\n",
+           stats.rx_packets, stats.rx_crc_errors, stats.rx_header_errors,
+           stats.rx_dropped);
+
+    return 0;
+}
+
+/*** end of file ***/
@@ -0,0 +1,75 @@
+/** @file sim_power.c
+ *
+ * @brief Periodic wifi scans against simulated LR1110 with automatic sleep.
+ *        Radio is put to sleep shortly after each scan and woken up by the
+ *        first command of the next one. Printed statistics show time spent
+ *        in each power state and wakeup latency.
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 Irnas.  All rights reserved.
+ */
+
+#include <zephyr.h>
+#include "lr1110.h"
+#include "lr1110_sim.h"
+
+#define SCANS           5
+#define SCAN_PERIOD_MS  300
+#define IDLE_MS         20
+
+static lr1110_t lr1110;
+
+static const struct lr1110_sim_ap office[] = {
+    { { 0x00, 0x11, 0x22, 0x33, 0x44, 0x01 }, -48, 1, 3, "office" },
+    { { 0x00, 0x11, 0x22, 0x33, 0x44, 0x02 }, -63, 6, 3, "office-guest" },
+};
+
+static const char * const state_names[] = {
+    [LR1110_POWER_ACTIVE] = "active",
+    [LR1110_POWER_STANDBY] = "standby",
+    [LR1110_POWER_SLEEP] = "sleep",
+};
+
+int main()
+{
+    lr1110_sim_init(0, NULL);
+    for (int i = 0; i < SCANS; i++) {
+        lr1110_sim_add_wifi_scan(0, office, ARRAY_SIZE(office));
+    }
+    lr1110_sim_attach(0, &lr1110);
+
+    lr1110_init(&lr1110);
+    lr1110_init_wifi_scan(&lr1110);
+    lr1110_power_set_idle(&lr1110, IDLE_MS, LR1110_POWER_SLEEP);
+
+    struct wifi_settings wifi_settings = lr1110_get_default_wifi_settings();
+
+    for (int i = 0; i < SCANS; i++)
+    {
+        struct wifi_diagnostics wifi_diagnostics = 
+            lr1110_execute_wifi_scan(&lr1110, wifi_settings);
+
+        printk("Scan %d: %d results, radio %s\n", i, 
+               wifi_diagnostics.num_wifi_results,
+               state_names[lr1110_power_get_state(&lr1110)]);
+
+        k_sleep(K_MSEC(SCAN_PERIOD_MS));
+        printk("Before next scan: radio %s\n",
+               state_names[lr1110_power_get_state(&lr1110)]);
+    }
+
+    struct lr1110_power_stats stats;
+    lr1110_power_get_stats(&lr1110, &stats);
+
+    printk("Active: %d ms, standby: %d ms, sleep: %d ms\n",
+           (int) stats.time_ms[LR1110_POWER_ACTIVE],
+           (int) stats.time_ms[LR1110_POWER_STANDBY],
+           (int) stats.time_ms[LR1110_POWER_SLEEP]);
+    printk("Sleeps: %d, wakeups: %d, wakeup last: %d us, max: %d us\n",
+           stats.sleeps, stats.wakeups, stats.wakeup_us_last, 
+           stats.wakeup_us_max);
+
+    return 0;
+}
+
+/*** end of file ***/
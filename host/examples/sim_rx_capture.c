@@ -0,0 +1,131 @@
+/** @file sim_rx_capture.c
+ *
+ * @brief Sustained LoRa receive rate against simulated LR1110. Packets are
+ *        offered at increasing rate, and received through lr1110_lora
+ *        receive and through HAL continuous RX capture. Output is CSV:
+ *
+ *        mode,offered_pps,received_pps,dropped,overruns,service_max_us,
+ *        spi_per_packet
+ *
+ *        Overruns are packets that arrived while previous RX_DONE was
+ *        still pending in the radio, so host was too slow to read them.
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 Irnas.  All rights reserved.
+ */
+
+#include <zephyr.h>
+#include "lr1110.h"
+#include "lr1110_sim.h"
+
+#define RUN_MS          1000
+#define PAYLOAD_LENGTH  32
+
+enum mode {
+    MODE_LORA,
+    MODE_CAPTURE,
+};
+
+static lr1110_t lr1110;
+static struct lr1110_lora lora;
+static struct lr1110_rx_capture capture;
+
+/* Air time plus gap, in us */
+static const uint32_t periods[] = { 4000, 2000, 1000, 700, 500, 350, 250 };
+
+static void run(enum mode mode, uint32_t period_us)
+{
+    struct lr1110_sim_config config = lr1110_sim_default_config();
+    struct lr1110_lora_packet packet;
+    struct lr1110_sim_stats sim_stats;
+    struct lr1110_hal_stats hal_stats;
+    uint32_t received = 0;
+    uint32_t dropped = 0;
+    uint32_t service_max_us = 0;
+
+    config.spi_timing = false;
+    config.lora_packet_us = period_us / 2;
+    config.lora_rx_interval_us = period_us - config.lora_packet_us;
+
+    lr1110_sim_init(0, &config);
+    lr1110_init(&lr1110);
+    lr1110_spi_autotune(&lr1110, &(struct lr1110_spi_tune_result) {0});
+    lr1110_lora_init(&lr1110, &lora, lr1110_get_default_lora_settings());
+    lr1110_sim_reset_stats(0);
+    lr1110_hal_reset_stats(&lr1110);
+
+    if (mode == MODE_LORA) {
+        lr1110_lora_receive_start(&lora, NULL, NULL);
+    }
+    else {
+        lr1110_rx_capture_start(&lr1110, &capture);
+    }
+
+    int64_t end = k_uptime_get() + RUN_MS;
+
+    while (k_uptime_get() < end)
+    {
+        int err = (mode == MODE_LORA) ?
+                  lr1110_lora_read(&lora, &packet, K_MSEC(10)) :
+                  lr1110_rx_capture_read(&capture, &packet, K_MSEC(10));
+
+        if (!err) {
+            received++;
+        }
+    }
+
+    if (mode == MODE_LORA) {
+        struct lr1110_lora_stats stats;
+
+        lr1110_lora_receive_stop(&lora);
+        lr1110_lora_get_stats(&lora, &stats);
+        dropped = stats.rx_dropped;
+    }
+    else {
+        struct lr1110_rx_capture_stats stats;
+
+        lr1110_rx_capture_stop(&capture);
+        lr1110_rx_capture_get_stats(&capture, &stats);
+        dropped = stats.dropped;
+        service_max_us = (uint64_t) stats.service_cycles_max * 1000000 /
+                         sys_clock_hw_cycles_per_sec();
+    }
+    lr1110_sim_get_stats(0, &sim_stats);
+    lr1110_hal_get_stats(&lr1110, &hal_stats);
+
+    /* Includes start and stop, negligible over a run */
+    uint32_t spi_x10 = received ? hal_stats.spi_transactions * 10 / received : 0;
+
+    printk("%s,%u,%u,%u,%u,%u,%u.%u\n",
+           mode == MODE_LORA ? "lora" : "capture",
+           sim_stats.lora_rx_packets * 1000 / RUN_MS,
+           received * 1000 / RUN_MS,
+           dropped, sim_stats.lora_rx_overruns, service_max_us,
+           spi_x10 / 10, spi_x10 % 10);
+}
+
+int main()
+{
+    static uint8_t payload[PAYLOAD_LENGTH];
+    const struct lr1110_sim_lora_packet packet = {
+        payload, sizeof(payload), -70, 8, false
+    };
+
+    lr1110_sim_init(0, NULL);
+    lr1110_sim_add_lora_packet(0, &packet);
+    lr1110_sim_attach(0, &lr1110);
+
+    printk("mode,offered_pps,received_pps,dropped,overruns,service_max_us,"
+           "spi_per_packet\n");
+
+    for (uint8_t i = 0; i < ARRAY_SIZE(periods); i++)
+    {
+        run(MODE_LORA, periods[i]);
+        run(MODE_CAPTURE, periods[i]);
+    }
+    printk("# done\n");
+
+    return 0;
+}
+
+/*** end of file ***/
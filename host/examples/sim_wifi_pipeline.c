@@ -0,0 +1,78 @@
+/** @file sim_wifi_pipeline.c
+ *
+ * @brief Wifi scan pipeline against simulated LR1110. Application work is
+ *        simulated with a sleep, printed statistics show how much of it
+ *        overlapped with scanning.
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 Irnas.  All rights reserved.
+ */
+
+#include <zephyr.h>
+#include "lr1110.h"
+#include "lr1110_sim.h"
+
+#define SCANS       10
+#define APP_WORK_MS 80
+
+static lr1110_t lr1110;
+static struct lr1110_wifi_pipeline pipeline;
+
+static const struct lr1110_sim_ap office[] = {
+    { { 0x00, 0x11, 0x22, 0x33, 0x44, 0x01 }, -48, 1, 3, "office" },
+    { { 0x00, 0x11, 0x22, 0x33, 0x44, 0x02 }, -63, 6, 3, "office-guest" },
+    { { 0x00, 0x11, 0x22, 0x33, 0x44, 0x03 }, -77, 11, 2, "printer" },
+    { { 0x00, 0x11, 0x22, 0x33, 0x44, 0x04 }, -85, 3, 1, "lab" },
+};
+
+int main()
+{
+    lr1110_sim_init(0, NULL);
+    lr1110_sim_add_wifi_scan(0, office, ARRAY_SIZE(office));
+    lr1110_sim_attach(0, &lr1110);
+
+    lr1110_init(&lr1110);
+    lr1110_init_wifi_scan(&lr1110);
+
+    struct wifi_settings wifi_settings = lr1110_get_default_wifi_settings();
+    int64_t start = k_uptime_get();
+
+    int err = lr1110_wifi_pipeline_start(&lr1110, &pipeline, wifi_settings,
+                                         NULL, NULL);
+    if (err) {
+        printk("Pipeline start failed: %d\n", err);
+        return 1;
+    }
+
+    for (int i = 0; i < SCANS; i++)
+    {
+        struct lr1110_wifi_slot * slot =
+            lr1110_wifi_pipeline_take(&pipeline, K_SECONDS(1));
+
+        if (!slot) {
+            printk("No results\n");
+            break;
+        }
+        printk("Scan %d: %d results\n",
+               slot->seq, slot->wifi_diagnostics.num_wifi_results);
+
+        /* Encoding and sending the results */
+        k_sleep(K_MSEC(APP_WORK_MS));
+        lr1110_wifi_pipeline_release(&pipeline, slot);
+    }
+
+    lr1110_wifi_pipeline_stop(&pipeline);
+
+    struct lr1110_wifi_pipeline_stats stats;
+    lr1110_wifi_pipeline_get_stats(&pipeline, &stats);
+
+    printk("Total: %d ms, scans: %d, errors: %d, stalls: %d\n",
+           (int) (k_uptime_get() - start), stats.scans, stats.scan_errors,
+           stats.stalls);
+    printk("Radio: %d ms, app: %d ms, overlap: %d ms, stalled: %d ms\n",
+           stats.radio_ms, stats.app_ms, stats.overlap_ms, stats.stall_ms);
+
+    return 0;
+}
+
+/*** end of file ***/
@@ -0,0 +1,99 @@
+/** @file sim_wifi_scan.c
+ *
+ * @brief Wifi scan example running against simulated LR1110 on host.
+ *        With "trace" argument, HAL calls of the scans are dumped at the
+ *        end, for host/tools/trace_replay.c.
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 Irnas.  All rights reserved.
+ */
+
+#include <string.h>
+#include <zephyr.h>
+#include "lr1110.h"
+#include "lr1110_sim.h"
+
+#define SCANS   3
+
+static lr1110_t lr1110;
+
+LR1110_HAL_TRACE_DEFINE(trace, 128);
+
+static const struct lr1110_sim_ap office[] = {
+    { { 0x00, 0x11, 0x22, 0x33, 0x44, 0x01 }, -48, 1, 3, "office" },
+    { { 0x00, 0x11, 0x22, 0x33, 0x44, 0x02 }, -63, 6, 3, "office-guest" },
+    { { 0x00, 0x11, 0x22, 0x33, 0x44, 0x03 }, -77, 11, 2, "printer" },
+    { { 0x00, 0x11, 0x22, 0x33, 0x44, 0x04 }, -85, 3, 1, "lab" },
+};
+
+/* Called for every few results, while the rest are still in the radio */
+static bool print_results(void * context,
+                          const lr1110_wifi_extended_full_result_t * results,
+                          uint8_t start_index,
+                          uint8_t nb_results,
+                          void * user_data)
+{
+    for (int i = 0; i < nb_results; i++)
+    {
+        const uint8_t * mac = results[i].mac_address_3;
+
+        printk("%2d: %02x:%02x:%02x:%02x:%02x:%02x, rssi: %d, ssid: %.32s\n",
+               start_index + i,
+               mac[0], mac[1], mac[2], mac[3], mac[4], mac[5],
+               results[i].rssi, results[i].ssid_bytes);
+    }
+    return true;
+}
+
+int main(int argc, char ** argv)
+{
+    bool dump_trace = argc > 1 && !strcmp(argv[1], "trace");
+
+    printk("Hello World! %s\n", CONFIG_BOARD);
+
+    lr1110_sim_init(0, NULL);
+    lr1110_sim_add_wifi_scan(0, office, ARRAY_SIZE(office));
+    lr1110_sim_add_wifi_scan(0, office, 2);
+    lr1110_sim_attach(0, &lr1110);
+
+    struct lr1110_init_diagnostics init_diagnostics = lr1110_init(&lr1110);
+    printk("Init took %d us\n", init_diagnostics.init_duration_us);
+
+    struct lr1110_spi_tune_result tune_result;
+    if (!lr1110_spi_autotune(&lr1110, &tune_result)) {
+        printk("SPI clock: %d Hz, errors: %d\n",
+               tune_result.frequency, tune_result.errors);
+    }
+
+    lr1110_display_trx_version(&lr1110);
+
+    struct wifi_settings wifi_settings = lr1110_get_default_wifi_settings();
+
+    lr1110_init_wifi_scan(&lr1110);
+    lr1110_hal_trace_start(&lr1110, &trace);
+
+    for (int scan = 0; scan < SCANS; scan++)
+    {
+        struct wifi_diagnostics wifi_diagnostics =
+            lr1110_execute_wifi_scan(&lr1110, wifi_settings);
+
+        printk("Scan duration: %d ms, results: %d\n",
+               wifi_diagnostics.wifi_scan_duration,
+               wifi_diagnostics.num_wifi_results);
+
+        lr1110_stream_ext_wifi_scan_results(&lr1110, wifi_diagnostics, 0,
+                                            print_results, NULL);
+    }
+
+    lr1110_hal_trace_stop(&lr1110);
+    if (dump_trace) {
+        lr1110_hal_trace_dump(&trace);
+    }
+
+    struct lr1110_sim_stats stats;
+
+    lr1110_sim_get_stats(0, &stats);
+    printk("Simulator: %u commands, %u unknown, %u bytes\n",
+           stats.commands, stats.unknown_commands, stats.bytes);
+    return 0;
+}
@@ -0,0 +1,39 @@
+/** @file device.h
+ *
+ * @brief       Device model of the host build. Devices are registered by 
+ *              the simulator and looked up by name.
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 Irnas.  All rights reserved.
+ */
+
+#ifndef HOST_DEVICE_H
+#define HOST_DEVICE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <zephyr.h>
+
+struct device {
+    const char * name;
+    const void * api;
+    void * data;
+    const struct device * next;     /* Registry link */
+};
+
+const struct device * device_get_binding(const char * name);
+void device_register(struct device * dev);
+
+static inline bool device_is_ready(const struct device * dev)
+{
+    return dev != NULL;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_DEVICE_H */
+/*** end of file ***/
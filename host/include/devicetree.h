@@ -0,0 +1,16 @@
+/** @file devicetree.h
+ *
+ * @brief       Host build has no devicetree, contexts are set up with 
+ *              lr1110_sim_attach instead of LR1110_DT_DEFINE.
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 Irnas.  All rights reserved.
+ */
+
+#ifndef HOST_DEVICETREE_H
+#define HOST_DEVICETREE_H
+
+#define DT_HAS_COMPAT_STATUS_OKAY(compat)   0
+
+#endif /* HOST_DEVICETREE_H */
+/*** end of file ***/
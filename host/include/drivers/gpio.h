@@ -0,0 +1,129 @@
+/** @file gpio.h
+ *
+ * @brief       GPIO API of the host build. Calls are forwarded to the 
+ *              driver API of the device, as in Zephyr.
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 Irnas.  All rights reserved.
+ */
+
+#ifndef HOST_DRIVERS_GPIO_H
+#define HOST_DRIVERS_GPIO_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <zephyr.h>
+#include <device.h>
+
+typedef uint8_t gpio_pin_t;
+typedef uint32_t gpio_flags_t;
+typedef uint32_t gpio_port_pins_t;
+
+#define GPIO_INPUT                  BIT(8)
+#define GPIO_OUTPUT                 BIT(9)
+#define GPIO_OUTPUT_INIT_LOW        BIT(10)
+#define GPIO_OUTPUT_INIT_HIGH       BIT(11)
+#define GPIO_OUTPUT_LOW             (GPIO_OUTPUT | GPIO_OUTPUT_INIT_LOW)
+#define GPIO_OUTPUT_HIGH            (GPIO_OUTPUT | GPIO_OUTPUT_INIT_HIGH)
+
+#define GPIO_INT_DISABLE            BIT(13)
+#define GPIO_INT_ENABLE             BIT(14)
+#define GPIO_INT_LEVELS_LOGICAL     BIT(15)
+#define GPIO_INT_EDGE               BIT(16)
+#define GPIO_INT_LOW_0              BIT(17)
+#define GPIO_INT_HIGH_1             BIT(18)
+
+#define GPIO_INT_EDGE_RISING        (GPIO_INT_ENABLE | GPIO_INT_EDGE | \
+                                     GPIO_INT_HIGH_1)
+#define GPIO_INT_EDGE_FALLING       (GPIO_INT_ENABLE | GPIO_INT_EDGE | \
+                                     GPIO_INT_LOW_0)
+#define GPIO_INT_EDGE_BOTH          (GPIO_INT_ENABLE | GPIO_INT_EDGE | \
+                                     GPIO_INT_LOW_0 | GPIO_INT_HIGH_1)
+#define GPIO_INT_LEVEL_LOW          (GPIO_INT_ENABLE | GPIO_INT_LOW_0)
+#define GPIO_INT_LEVEL_HIGH         (GPIO_INT_ENABLE | GPIO_INT_HIGH_1)
+#define GPIO_INT_EDGE_TO_INACTIVE   (GPIO_INT_EDGE_FALLING | \
+                                     GPIO_INT_LEVELS_LOGICAL)
+#define GPIO_INT_EDGE_TO_ACTIVE     (GPIO_INT_EDGE_RISING | \
+                                     GPIO_INT_LEVELS_LOGICAL)
+#define GPIO_INT_LEVEL_INACTIVE     (GPIO_INT_LEVEL_LOW | \
+                                     GPIO_INT_LEVELS_LOGICAL)
+#define GPIO_INT_LEVEL_ACTIVE       (GPIO_INT_LEVEL_HIGH | \
+                                     GPIO_INT_LEVELS_LOGICAL)
+
+struct gpio_callback;
+typedef void (*gpio_callback_handler_t)(const struct device * port,
+                                        struct gpio_callback * cb,
+                                        gpio_port_pins_t pins);
+
+struct gpio_callback {
+    struct gpio_callback * next;
+    gpio_callback_handler_t handler;
+    gpio_port_pins_t pin_mask;
+};
+
+struct gpio_driver_api {
+    int (*pin_configure)(const struct device * port, gpio_pin_t pin,
+                         gpio_flags_t flags);
+    int (*pin_get)(const struct device * port, gpio_pin_t pin);
+    int (*pin_set)(const struct device * port, gpio_pin_t pin, int value);
+    int (*pin_interrupt_configure)(const struct device * port, 
+                                   gpio_pin_t pin, gpio_flags_t flags);
+    int (*manage_callback)(const struct device * port, 
+                           struct gpio_callback * cb, bool set);
+};
+
+#define GPIO_API(port)  ((const struct gpio_driver_api *) (port)->api)
+
+static inline int gpio_pin_configure(const struct device * port, 
+                                     gpio_pin_t pin, gpio_flags_t flags)
+{
+    return GPIO_API(port)->pin_configure(port, pin, flags);
+}
+
+static inline int gpio_pin_get(const struct device * port, gpio_pin_t pin)
+{
+    return GPIO_API(port)->pin_get(port, pin);
+}
+
+static inline int gpio_pin_set(const struct device * port, gpio_pin_t pin, 
+                               int value)
+{
+    return GPIO_API(port)->pin_set(port, pin, value);
+}
+
+static inline int gpio_pin_interrupt_configure(const struct device * port,
+                                               gpio_pin_t pin, 
+                                               gpio_flags_t flags)
+{
+    return GPIO_API(port)->pin_interrupt_configure(port, pin, flags);
+}
+
+static inline void gpio_init_callback(struct gpio_callback * callback,
+                                      gpio_callback_handler_t handler,
+                                      gpio_port_pins_t pin_mask)
+{
+    callback->next = NULL;
+    callback->handler = handler;
+    callback->pin_mask = pin_mask;
+}
+
+static inline int gpio_add_callback(const struct device * port,
+                                    struct gpio_callback * callback)
+{
+    return GPIO_API(port)->manage_callback(port, callback, true);
+}
+
+static inline int gpio_remove_callback(const struct device * port,
+                                       struct gpio_callback * callback)
+{
+    return GPIO_API(port)->manage_callback(port, callback, false);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_DRIVERS_GPIO_H */
+/*** end of file ***/
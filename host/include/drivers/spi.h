@@ -0,0 +1,78 @@
+/** @file spi.h
+ *
+ * @brief       SPI API of the host build. Calls are forwarded to the 
+ *              driver API of the device, as in Zephyr.
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 Irnas.  All rights reserved.
+ */
+
+#ifndef HOST_DRIVERS_SPI_H
+#define HOST_DRIVERS_SPI_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <zephyr.h>
+#include <device.h>
+
+#define SPI_OP_MODE_MASTER      0
+#define SPI_TRANSFER_MSB        0
+#define SPI_WORD_SET(size)      ((size) << 5)
+
+struct spi_cs_control;
+
+struct spi_config {
+    uint32_t frequency;
+    uint16_t operation;
+    uint16_t slave;
+    const struct spi_cs_control * cs;
+};
+
+struct spi_buf {
+    void * buf;
+    size_t len;
+};
+
+struct spi_buf_set {
+    const struct spi_buf * buffers;
+    size_t count;
+};
+
+struct spi_driver_api {
+    int (*transceive)(const struct device * dev,
+                      const struct spi_config * config,
+                      const struct spi_buf_set * tx_bufs,
+                      const struct spi_buf_set * rx_bufs);
+};
+
+static inline int spi_transceive(const struct device * dev,
+                                 const struct spi_config * config,
+                                 const struct spi_buf_set * tx_bufs,
+                                 const struct spi_buf_set * rx_bufs)
+{
+    return ((const struct spi_driver_api *) dev->api)->transceive(
+        dev, config, tx_bufs, rx_bufs);
+}
+
+static inline int spi_write(const struct device * dev,
+                            const struct spi_config * config,
+                            const struct spi_buf_set * tx_bufs)
+{
+    return spi_transceive(dev, config, tx_bufs, NULL);
+}
+
+static inline int spi_read(const struct device * dev,
+                           const struct spi_config * config,
+                           const struct spi_buf_set * rx_bufs)
+{
+    return spi_transceive(dev, config, NULL, rx_bufs);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_DRIVERS_SPI_H */
+/*** end of file ***/
@@ -0,0 +1,274 @@
+/** @file zephyr.h
+ *
+ * @brief       Minimal POSIX implementation of the Zephyr kernel API used 
+ *              by the library, so src/ can be built and run on a Linux 
+ *              host against the LR1110 simulator. Only what the library 
+ *              uses is provided. Timeouts and cycles are in microseconds.
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 Irnas.  All rights reserved.
+ */
+
+#ifndef HOST_ZEPHYR_H
+#define HOST_ZEPHYR_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+
+#define CONFIG_BOARD                        "host"
+#define CONFIG_SYS_CLOCK_HW_CYCLES_PER_SEC  1000000
+#define CONFIG_SYSTEM_WORKQUEUE_PRIORITY    -1
+
+/* -------------------------------------------------------------------------
+ * Utilities
+ * ------------------------------------------------------------------------- */
+#ifndef MIN
+#define MIN(a, b)               (((a) < (b)) ? (a) : (b))
+#endif
+#ifndef MAX
+#define MAX(a, b)               (((a) > (b)) ? (a) : (b))
+#endif
+#define BIT(n)                  (1UL << (n))
+#define ARRAY_SIZE(array)       (sizeof(array) / sizeof((array)[0]))
+#define CONTAINER_OF(ptr, type, field) \
+    ((type *) (((char *) (ptr)) - offsetof(type, field)))
+#define BUILD_ASSERT(expr, ...) _Static_assert(expr, "" __VA_ARGS__)
+#define __ASSERT_NO_MSG(test)   assert(test)
+#define ARG_UNUSED(x)           (void) (x)
+#define IS_ENABLED(option)      (option)
+
+int printk(const char * fmt, ...) __attribute__((format(printf, 1, 2)));
+
+/* -------------------------------------------------------------------------
+ * Time
+ * ------------------------------------------------------------------------- */
+typedef struct {
+    int64_t us;
+} k_timeout_t;
+
+#define K_USEC(us)              ((k_timeout_t) { (int64_t) (us) })
+#define K_MSEC(ms)              ((k_timeout_t) { (int64_t) (ms) * 1000 })
+#define K_SECONDS(s)            ((k_timeout_t) { (int64_t) (s) * 1000000 })
+#define K_NO_WAIT               ((k_timeout_t) { 0 })
+#define K_FOREVER               ((k_timeout_t) { -1 })
+#define K_TIMEOUT_EQ(a, b)      ((a).us == (b).us)
+
+int64_t k_uptime_get(void);
+uint32_t k_uptime_get_32(void);
+uint32_t k_cycle_get_32(void);
+void k_busy_wait(uint32_t usec_to_wait);
+int32_t k_sleep(k_timeout_t timeout);
+bool k_is_in_isr(void);
+void k_yield(void);
+
+/* Threads are identified by their POSIX thread */
+typedef pthread_t k_tid_t;
+
+k_tid_t k_current_get(void);
+
+static inline int32_t k_msleep(int32_t ms)
+{
+    return k_sleep(K_MSEC(ms));
+}
+
+static inline int32_t k_usleep(int32_t us)
+{
+    return k_sleep(K_USEC(us));
+}
+
+/* Cycle counter runs at 1 MHz */
+static inline int sys_clock_hw_cycles_per_sec(void)
+{
+    return CONFIG_SYS_CLOCK_HW_CYCLES_PER_SEC;
+}
+
+static inline uint32_t k_cyc_to_us_floor32(uint32_t cyc)
+{
+    return cyc;
+}
+
+static inline uint32_t k_us_to_cyc_ceil32(uint32_t us)
+{
+    return us;
+}
+
+static inline uint64_t k_cyc_to_ns_floor64(uint64_t cyc)
+{
+    return cyc * 1000;
+}
+
+/* -------------------------------------------------------------------------
+ * Atomics
+ * ------------------------------------------------------------------------- */
+typedef long atomic_t;
+typedef long atomic_val_t;
+
+#define ATOMIC_INIT(i)          (i)
+
+static inline bool atomic_cas(atomic_t * target, atomic_val_t old_value,
+                              atomic_val_t new_value)
+{
+    return __atomic_compare_exchange_n(target, &old_value, new_value, false,
+                                       __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+static inline atomic_val_t atomic_get(const atomic_t * target)
+{
+    return __atomic_load_n(target, __ATOMIC_SEQ_CST);
+}
+
+static inline atomic_val_t atomic_set(atomic_t * target, atomic_val_t value)
+{
+    return __atomic_exchange_n(target, value, __ATOMIC_SEQ_CST);
+}
+
+static inline atomic_val_t atomic_add(atomic_t * target, atomic_val_t value)
+{
+    return __atomic_fetch_add(target, value, __ATOMIC_SEQ_CST);
+}
+
+static inline atomic_val_t atomic_inc(atomic_t * target)
+{
+    return atomic_add(target, 1);
+}
+
+static inline atomic_val_t atomic_dec(atomic_t * target)
+{
+    return atomic_add(target, -1);
+}
+
+static inline atomic_val_t atomic_clear(atomic_t * target)
+{
+    return atomic_set(target, 0);
+}
+
+static inline atomic_val_t atomic_or(atomic_t * target, atomic_val_t value)
+{
+    return __atomic_fetch_or(target, value, __ATOMIC_SEQ_CST);
+}
+
+/* -------------------------------------------------------------------------
+ * Semaphores and mutexes
+ * ------------------------------------------------------------------------- */
+struct k_sem {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    unsigned int count;
+    unsigned int limit;
+};
+
+int k_sem_init(struct k_sem * sem, unsigned int initial_count, 
+               unsigned int limit);
+int k_sem_take(struct k_sem * sem, k_timeout_t timeout);
+void k_sem_give(struct k_sem * sem);
+void k_sem_reset(struct k_sem * sem);
+unsigned int k_sem_count_get(struct k_sem * sem);
+
+/* Recursive, as in Zephyr */
+struct k_mutex {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    pthread_t owner;
+    unsigned int lock_count;
+};
+
+int k_mutex_init(struct k_mutex * mutex);
+int k_mutex_lock(struct k_mutex * mutex, k_timeout_t timeout);
+int k_mutex_unlock(struct k_mutex * mutex);
+
+/* -------------------------------------------------------------------------
+ * Work queues
+ * ------------------------------------------------------------------------- */
+struct k_work;
+typedef void (*k_work_handler_t)(struct k_work * work);
+
+struct k_work_q;
+
+struct k_work {
+    struct k_work * next;
+    k_work_handler_t handler;
+    uint32_t flags;
+    struct k_work_q * queue;    /* Last queue it was submitted to */
+};
+
+struct k_work_delayable {
+    struct k_work work;
+    struct k_work_delayable * next;
+    int64_t due_us;
+};
+
+/* Work flags, busy status returned by cancel and submit functions */
+#define K_WORK_RUNNING          BIT(0)
+#define K_WORK_CANCELING        BIT(1)
+#define K_WORK_QUEUED           BIT(2)
+#define K_WORK_DELAYED          BIT(3)
+
+struct k_work_q {
+    pthread_t tid;
+    pthread_cond_t cond;
+    struct k_work * head;
+    struct k_work * tail;
+    struct k_work_delayable * delayed;
+};
+
+struct k_work_queue_config {
+    const char * name;
+    bool no_yield;
+};
+
+/* Queue threads get pthreads default stack, stack members are unused */
+typedef char k_thread_stack_t;
+#define K_KERNEL_STACK_MEMBER(sym, size)    k_thread_stack_t sym[1]
+#define K_KERNEL_STACK_SIZEOF(sym)          sizeof(sym)
+#define K_PRIO_COOP(x)                      (-((x) + 1))
+#define K_PRIO_PREEMPT(x)                   (x)
+
+extern struct k_work_q k_sys_work_q;
+
+k_tid_t k_work_queue_thread_get(struct k_work_q * queue);
+void k_work_queue_init(struct k_work_q * queue);
+void k_work_queue_start(struct k_work_q * queue,
+                        k_thread_stack_t * stack,
+                        size_t stack_size,
+                        int prio,
+                        const struct k_work_queue_config * cfg);
+int k_work_submit_to_queue(struct k_work_q * queue, struct k_work * work);
+int k_work_schedule_for_queue(struct k_work_q * queue,
+                              struct k_work_delayable * dwork,
+                              k_timeout_t delay);
+int k_work_reschedule_for_queue(struct k_work_q * queue,
+                                struct k_work_delayable * dwork,
+                                k_timeout_t delay);
+
+void k_work_init(struct k_work * work, k_work_handler_t handler);
+int k_work_submit(struct k_work * work);
+int k_work_cancel(struct k_work * work);
+int k_work_busy_get(const struct k_work * work);
+bool k_work_flush(struct k_work * work);
+
+void k_work_init_delayable(struct k_work_delayable * dwork, 
+                           k_work_handler_t handler);
+int k_work_schedule(struct k_work_delayable * dwork, k_timeout_t delay);
+int k_work_reschedule(struct k_work_delayable * dwork, k_timeout_t delay);
+int k_work_cancel_delayable(struct k_work_delayable * dwork);
+
+static inline struct k_work_delayable *
+k_work_delayable_from_work(struct k_work * work)
+{
+    return CONTAINER_OF(work, struct k_work_delayable, work);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_ZEPHYR_H */
+/*** end of file ***/
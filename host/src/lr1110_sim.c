@@ -0,0 +1,1434 @@
+/** @file lr1110_sim.c
+ *
+ * @brief       Simulated LR1110 for host builds.
+ *
+ *              Command frame (NSS low to NSS high) is opcode (2 bytes) and
+ *              parameters, while chip clocks out Stat1, Stat2 and IRQ
+ *              status. Command is executed on NSS rising edge and BUSY
+ *              stays high for the modelled processing time. If command
+ *              has a response, next frame clocks out Stat1 and response.
+ *              Multi-byte values are big endian.
+ *
+ *              Interrupt thread wakes up on BUSY and event line changes
+ *              and runs armed GPIO callbacks, as interrupt context.
+ *
+ *              Each instance has its own GPIO port and SPI bus device,
+ *              whose data points to instance state, its own lock and
+ *              interrupt thread.
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 Irnas.  All rights reserved.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <zephyr.h>
+#include <device.h>
+#include <drivers/gpio.h>
+#include <drivers/spi.h>
+#include "posix_kernel.h"
+#include "lr1110_sim.h"
+#include "lr1110_driver/lr1110_system_types.h"
+#include "lr1110_driver/lr1110_wifi_types.h"
+
+/* -------------------------------------------------------------------------
+ * PRIVATE VARIABLES
+ * ------------------------------------------------------------------------- */
+
+#define SIM_FRAME_MAX           1100
+#define SIM_RESPONSE_MAX        1100
+#define SIM_REGMEM_WORDS        64
+#define SIM_WIFI_SCRIPT_MAX     16
+#define SIM_SSID_MAX            LR1110_WIFI_RESULT_SSID_LENGTH
+#define SIM_CALLBACKS_MAX       8
+#define SIM_LORA_SCRIPT_MAX     16
+#define SIM_RADIO_BUFFER_SIZE   256
+#define SIM_RX_CONTINUOUS       0xFFFFFF
+
+/* Opcodes */
+#define SIM_GROUP_SYSTEM                0x01
+#define SIM_GROUP_RADIO                 0x02
+#define SIM_GROUP_WIFI                  0x03
+
+#define SIM_SYSTEM_GET_STATUS           0x0100
+#define SIM_SYSTEM_GET_VERSION          0x0101
+#define SIM_SYSTEM_WRITE_REGMEM32       0x0105
+#define SIM_SYSTEM_READ_REGMEM32        0x0106
+#define SIM_SYSTEM_WRITE_BUFFER8        0x0109
+#define SIM_SYSTEM_READ_BUFFER8         0x010A
+#define SIM_SYSTEM_CLEAR_RX_BUFFER      0x010B
+#define SIM_SYSTEM_GET_ERRORS           0x010D
+#define SIM_SYSTEM_CLEAR_ERRORS         0x010E
+#define SIM_SYSTEM_CALIBRATE            0x010F
+#define SIM_SYSTEM_SET_DIOIRQPARAMS     0x0113
+#define SIM_SYSTEM_CLEAR_IRQ            0x0114
+#define SIM_SYSTEM_SET_SLEEP            0x011B
+#define SIM_SYSTEM_SET_STANDBY          0x011C
+
+#define SIM_RADIO_GET_RX_BUFFER_STATUS  0x0203
+#define SIM_RADIO_GET_PKT_STATUS        0x0204
+#define SIM_RADIO_SET_RX                0x0209
+#define SIM_RADIO_SET_TX                0x020A
+#define SIM_RADIO_SET_PKT_PARAMS        0x0210
+
+#define SIM_WIFI_SCAN                   0x0300
+#define SIM_WIFI_GET_NB_RESULTS         0x0305
+#define SIM_WIFI_READ_RESULTS           0x0306
+#define SIM_WIFI_RESET_CUMUL_TIMING     0x0307
+#define SIM_WIFI_READ_CUMUL_TIMING      0x0308
+#define SIM_WIFI_GET_VERSION            0x0320
+
+/* Wifi result formats, by size of one result */
+#define SIM_WIFI_BASIC_COMPLETE_SIZE    22
+#define SIM_WIFI_BASIC_MAC_TYPE_SIZE    9
+#define SIM_WIFI_EXTENDED_FULL_SIZE     79
+#define SIM_WIFI_FORMAT_MAC_TYPE        0x04
+
+/* Stat1 command status */
+#define SIM_CMD_FAIL                    0
+#define SIM_CMD_OK                      2
+#define SIM_CMD_DAT                     3
+
+/* Stat2 chip mode */
+#define SIM_MODE_SLEEP                  0
+#define SIM_MODE_STANDBY_RC             1
+#define SIM_MODE_RX                     4
+#define SIM_MODE_TX                     5
+#define SIM_MODE_WIFI_GNSS              6
+
+/* Stat2 reset status, last restart of chip */
+#define SIM_RESET_ANALOG                1
+#define SIM_RESET_EXTERNAL              2
+#define SIM_RESET_WAKEUP                5
+
+struct sim_ap {
+    struct lr1110_sim_ap ap;
+    char ssid[SIM_SSID_MAX];
+};
+
+struct sim_wifi_scan {
+    struct sim_ap aps[LR1110_WIFI_MAX_RESULTS];
+    uint8_t nb_aps;
+};
+
+struct sim_lora_packet {
+    struct lr1110_sim_lora_packet packet;
+    uint8_t data[SIM_RADIO_BUFFER_SIZE];
+};
+
+struct sim_chip {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;            /* Wakes interrupt thread */
+    bool started;
+    struct device gpio_dev;         /* Data of both devices is the chip */
+    struct device spi_dev;
+    char gpio_name[24];
+    char spi_name[24];
+    struct lr1110_sim_config config;
+    struct lr1110_sim_stats stats;
+
+    /* Lines */
+    bool reset_low;
+    bool nss_low;
+    uint64_t busy_until;
+    gpio_flags_t int_flags[LR1110_SIM_PIN_COUNT];
+    int int_level[LR1110_SIM_PIN_COUNT];    /* Last level, for edges */
+    struct gpio_callback * callbacks;
+
+    /* Chip state */
+    bool sleeping;
+    uint8_t mode;
+    uint8_t reset_status;
+    uint8_t cmd_status;
+    uint32_t irq_status;
+    uint32_t irq_mask;
+    uint16_t errors;
+    struct {
+        uint32_t address;
+        uint32_t value;
+    } regmem[SIM_REGMEM_WORDS];
+
+    /* Current frame */
+    uint8_t frame[SIM_FRAME_MAX];
+    size_t frame_len;
+    bool response_frame;
+    uint8_t response[SIM_RESPONSE_MAX];
+    size_t response_len;
+    bool response_pending;
+
+    /* Wifi */
+    struct sim_wifi_scan script[SIM_WIFI_SCRIPT_MAX];
+    uint8_t script_len;
+    uint8_t script_pos;
+    bool scanning;
+    uint64_t scan_end;
+    uint16_t scan_channels;
+    uint8_t scan_type;
+    uint8_t scan_mode;
+    uint8_t scan_max_results;
+    const struct sim_wifi_scan * results;
+    uint8_t nb_results;
+    uint8_t result_index[LR1110_WIFI_MAX_RESULTS];
+    lr1110_wifi_cumulative_timings_t timings;
+
+    /* LoRa, separate buffers hold payload to send and received payload,
+     * as on chip */
+    struct sim_lora_packet lora_script[SIM_LORA_SCRIPT_MAX];
+    uint8_t lora_script_len;
+    uint8_t lora_script_pos;
+    uint8_t tx_buffer[SIM_RADIO_BUFFER_SIZE];
+    uint8_t rx_buffer[SIM_RADIO_BUFFER_SIZE];
+    uint8_t pkt_length;             /* From packet parameters */
+    uint8_t rx_length;
+    int8_t rx_rssi;
+    int8_t rx_snr;
+    bool lora_tx;
+    bool lora_rx;
+    bool lora_rx_continuous;
+    uint64_t lora_end;              /* TX done or next packet received */
+};
+
+static struct sim_chip sims[LR1110_SIM_INSTANCES];
+
+/* Serializes start of instances */
+static pthread_mutex_t sims_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* -------------------------------------------------------------------------
+ * PRIVATE PROTOTYPES
+ * ------------------------------------------------------------------------- */
+static struct sim_chip * sim_get(uint8_t instance);
+static void sim_start(struct sim_chip * sim, uint8_t instance);
+static void * sim_irq_thread(void * arg);
+static void sim_update(struct sim_chip * sim, uint64_t now);
+static int sim_pin_level(struct sim_chip * sim, enum lr1110_sim_pin pin,
+                         uint64_t now);
+static void sim_reboot(struct sim_chip * sim, uint64_t now,
+                       uint8_t reset_status);
+static uint8_t sim_miso(struct sim_chip * sim, size_t pos);
+static void sim_frame_end(struct sim_chip * sim, uint64_t now);
+static void sim_respond(struct sim_chip * sim, const uint8_t * data,
+                        size_t len);
+static void sim_system_cmd(struct sim_chip * sim, uint16_t opcode,
+                           const uint8_t * params, size_t len, uint64_t now);
+static void sim_wifi_cmd(struct sim_chip * sim, uint16_t opcode,
+                         const uint8_t * params, size_t len, uint64_t now);
+static void sim_wifi_finish(struct sim_chip * sim, uint64_t now);
+static void sim_radio_cmd(struct sim_chip * sim, uint16_t opcode,
+                          const uint8_t * params, size_t len, uint64_t now);
+static void sim_lora_finish(struct sim_chip * sim);
+static size_t sim_wifi_put_result(struct sim_chip * sim, uint8_t * buf,
+                                  uint8_t format, const struct sim_ap * ap);
+static uint32_t get_be32(const uint8_t * buf);
+static void put_be16(uint8_t * buf, uint16_t value);
+static void put_be32(uint8_t * buf, uint32_t value);
+
+static int sim_gpio_configure(const struct device * port, gpio_pin_t pin,
+                              gpio_flags_t flags);
+static int sim_gpio_get(const struct device * port, gpio_pin_t pin);
+static int sim_gpio_set(const struct device * port, gpio_pin_t pin,
+                        int value);
+static int sim_gpio_interrupt_configure(const struct device * port,
+                                        gpio_pin_t pin, gpio_flags_t flags);
+static int sim_gpio_manage_callback(const struct device * port,
+                                    struct gpio_callback * cb, bool set);
+static int sim_spi_transceive(const struct device * dev,
+                              const struct spi_config * config,
+                              const struct spi_buf_set * tx_bufs,
+                              const struct spi_buf_set * rx_bufs);
+
+static const struct gpio_driver_api sim_gpio_api = {
+    .pin_configure = sim_gpio_configure,
+    .pin_get = sim_gpio_get,
+    .pin_set = sim_gpio_set,
+    .pin_interrupt_configure = sim_gpio_interrupt_configure,
+    .manage_callback = sim_gpio_manage_callback,
+};
+
+static const struct spi_driver_api sim_spi_api = {
+    .transceive = sim_spi_transceive,
+};
+
+/* -------------------------------------------------------------------------
+ * PUBLIC IMPLEMENTATIONS
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * @brief               Default timing, chip boots in 5 ms and scans each
+ *                      channel for 0.5 ms per scan
+ */
+struct lr1110_sim_config lr1110_sim_default_config(void)
+{
+    struct lr1110_sim_config config = {
+        .boot_us            = 5000,
+        .wakeup_us          = 300,
+        .cmd_us             = 20,
+        .calibrate_us       = 1000,
+        .wifi_scan_us       = 500,
+        .lora_packet_us     = 2000,
+        .lora_rx_interval_us = 1000,
+        .spi_timing         = true,
+        .spi_max_frequency  = 0,
+    };
+    return config;
+}
+
+
+/*!
+ * @brief               Powers up simulated chip, registers its devices and
+ *                      starts interrupt thread. Can be called again to
+ *                      change configuration, wifi script is kept.
+ *
+ * @param[in] instance  Simulated chip, below LR1110_SIM_INSTANCES
+ * @param[in] config    Configuration, NULL for default one
+ *
+ * @return              0 on success, -EINVAL if there is no such instance
+ */
+int lr1110_sim_init(uint8_t instance, const struct lr1110_sim_config * config)
+{
+    struct sim_chip * sim = sim_get(instance);
+
+    if (!sim) {
+        return -EINVAL;
+    }
+
+    pthread_mutex_lock(&sim->mutex);
+    sim->config = config ? *config : lr1110_sim_default_config();
+    memset(&sim->stats, 0, sizeof(sim->stats));
+    sim->reset_low = false;
+    sim->nss_low = false;
+    sim_reboot(sim, posix_now_us(), SIM_RESET_ANALOG);
+    pthread_cond_signal(&sim->cond);
+    pthread_mutex_unlock(&sim->mutex);
+    return 0;
+}
+
+
+/*!
+ * @brief               Connects radio context to simulated chip, instead
+ *                      of lr1110_set_device_config or LR1110_DT_DEFINE
+ *
+ * @param[in] instance  Simulated chip
+ * @param[out] lr1110   Radio context
+ *
+ * @return              0 on success, -EINVAL if there is no such instance
+ */
+int lr1110_sim_attach(uint8_t instance, lr1110_t * lr1110)
+{
+    struct sim_chip * sim = sim_get(instance);
+
+    if (!sim) {
+        return -EINVAL;
+    }
+
+    memset(lr1110, 0, sizeof(*lr1110));
+
+    lr1110->reset = (port_pin_t) { &sim->gpio_dev, LR1110_SIM_PIN_RESET };
+    lr1110->nss   = (port_pin_t) { &sim->gpio_dev, LR1110_SIM_PIN_NSS };
+    lr1110->busy  = (port_pin_t) { &sim->gpio_dev, LR1110_SIM_PIN_BUSY };
+    lr1110->event = (port_pin_t) { &sim->gpio_dev, LR1110_SIM_PIN_EVENT };
+    lr1110->lna   = (port_pin_t) { &sim->gpio_dev, LR1110_SIM_PIN_LNA };
+    lr1110->spi_dev_label = sim->spi_name;
+    lr1110->spi_dev = &sim->spi_dev;
+    lr1110->event_trigger_type = GPIO_INT_LEVEL_HIGH;
+    return 0;
+}
+
+
+/*!
+ * @brief               Appends scan to wifi script. Scans return scripted
+ *                      sets in order, repeating the script. APs outside of
+ *                      scanned channels and signal types are not reported.
+ *
+ * @param[in] instance  Simulated chip
+ * @param[in] aps       Access points found by scan
+ * @param[in] nb_aps    Number of access points, can be 0
+ *
+ * @return              0 on success, -ENOMEM if script is full, -EINVAL if
+ *                      there are too many APs or no such instance.
+ */
+int lr1110_sim_add_wifi_scan(uint8_t instance,
+                             const struct lr1110_sim_ap * aps,
+                             uint8_t nb_aps)
+{
+    struct sim_chip * sim = sim_get(instance);
+    int ret = 0;
+
+    if (!sim || nb_aps > LR1110_WIFI_MAX_RESULTS) {
+        return -EINVAL;
+    }
+
+    pthread_mutex_lock(&sim->mutex);
+    if (sim->script_len >= SIM_WIFI_SCRIPT_MAX) {
+        ret = -ENOMEM;
+    }
+    else {
+        struct sim_wifi_scan * scan = &sim->script[sim->script_len++];
+
+        memset(scan, 0, sizeof(*scan));
+        for (uint8_t i = 0; i < nb_aps; i++)
+        {
+            scan->aps[i].ap = aps[i];
+            if (aps[i].ssid) {
+                strncpy(scan->aps[i].ssid, aps[i].ssid, SIM_SSID_MAX);
+            }
+            scan->aps[i].ap.ssid = scan->aps[i].ssid;
+        }
+        scan->nb_aps = nb_aps;
+    }
+    pthread_mutex_unlock(&sim->mutex);
+    return ret;
+}
+
+
+/*!
+ * @brief               Removes all scripted scans, scans find nothing
+ */
+void lr1110_sim_clear_wifi_scans(uint8_t instance)
+{
+    struct sim_chip * sim = sim_get(instance);
+
+    if (!sim) {
+        return;
+    }
+
+    pthread_mutex_lock(&sim->mutex);
+    sim->script_len = 0;
+    sim->script_pos = 0;
+    sim->results = NULL;
+    sim->nb_results = 0;
+    pthread_mutex_unlock(&sim->mutex);
+}
+
+
+/*!
+ * @brief               Appends packet to LoRa script. While receiving, a
+ *                      packet arrives every lora_rx_interval_us plus air
+ *                      time, packets are taken in order, repeating the
+ *                      script.
+ *
+ * @param[in] instance  Simulated chip
+ * @param[in] packet    Packet, data is copied
+ *
+ * @return              0 on success, -ENOMEM if script is full, -EINVAL if
+ *                      there is no such instance
+ */
+int lr1110_sim_add_lora_packet(uint8_t instance,
+                               const struct lr1110_sim_lora_packet * packet)
+{
+    struct sim_chip * sim = sim_get(instance);
+    int ret = 0;
+
+    if (!sim) {
+        return -EINVAL;
+    }
+
+    pthread_mutex_lock(&sim->mutex);
+    if (sim->lora_script_len >= SIM_LORA_SCRIPT_MAX) {
+        ret = -ENOMEM;
+    }
+    else {
+        struct sim_lora_packet * entry =
+            &sim->lora_script[sim->lora_script_len++];
+
+        entry->packet = *packet;
+        memcpy(entry->data, packet->data, packet->length);
+        entry->packet.data = entry->data;
+    }
+    pthread_mutex_unlock(&sim->mutex);
+    return ret;
+}
+
+
+/*!
+ * @brief               Removes all scripted LoRa packets, nothing is
+ *                      received
+ */
+void lr1110_sim_clear_lora_packets(uint8_t instance)
+{
+    struct sim_chip * sim = sim_get(instance);
+
+    if (!sim) {
+        return;
+    }
+
+    pthread_mutex_lock(&sim->mutex);
+    sim->lora_script_len = 0;
+    sim->lora_script_pos = 0;
+    pthread_mutex_unlock(&sim->mutex);
+}
+
+
+void lr1110_sim_get_stats(uint8_t instance, struct lr1110_sim_stats * stats)
+{
+    struct sim_chip * sim = sim_get(instance);
+
+    if (!sim) {
+        memset(stats, 0, sizeof(*stats));
+        return;
+    }
+
+    pthread_mutex_lock(&sim->mutex);
+    *stats = sim->stats;
+    pthread_mutex_unlock(&sim->mutex);
+}
+
+
+void lr1110_sim_reset_stats(uint8_t instance)
+{
+    struct sim_chip * sim = sim_get(instance);
+
+    if (!sim) {
+        return;
+    }
+
+    pthread_mutex_lock(&sim->mutex);
+    memset(&sim->stats, 0, sizeof(sim->stats));
+    pthread_mutex_unlock(&sim->mutex);
+}
+
+/* -------------------------------------------------------------------------
+ * PRIVATE IMPLEMENTATIONS
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * @brief               Simulated chip of instance, started on first use
+ *
+ * @return              Chip, NULL if there is no such instance
+ */
+static struct sim_chip * sim_get(uint8_t instance)
+{
+    struct sim_chip * sim;
+
+    if (instance >= LR1110_SIM_INSTANCES) {
+        return NULL;
+    }
+
+    sim = &sims[instance];
+    pthread_mutex_lock(&sims_mutex);
+    if (!sim->started) {
+        sim_start(sim, instance);
+    }
+    pthread_mutex_unlock(&sims_mutex);
+    return sim;
+}
+
+
+/*!
+ * @brief               Registers devices of instance, their data points to
+ *                      the chip, and starts its interrupt thread
+ */
+static void sim_start(struct sim_chip * sim, uint8_t instance)
+{
+    pthread_t thread;
+
+    pthread_mutex_init(&sim->mutex, NULL);
+    posix_cond_init(&sim->cond);
+
+    snprintf(sim->gpio_name, sizeof(sim->gpio_name), "LR1110_SIM_GPIO_%u",
+             instance);
+    snprintf(sim->spi_name, sizeof(sim->spi_name), "LR1110_SIM_SPI_%u",
+             instance);
+    sim->gpio_dev = (struct device) {
+        .name = sim->gpio_name,
+        .api = &sim_gpio_api,
+        .data = sim,
+    };
+    sim->spi_dev = (struct device) {
+        .name = sim->spi_name,
+        .api = &sim_spi_api,
+        .data = sim,
+    };
+    device_register(&sim->gpio_dev);
+    device_register(&sim->spi_dev);
+
+    pthread_create(&thread, NULL, sim_irq_thread, sim);
+    pthread_detach(thread);
+    sim->started = true;
+}
+
+
+/*!
+ * @brief               Runs GPIO callbacks of armed lines that changed or
+ *                      are at their trigger level, sleeps until next
+ *                      modelled line change otherwise
+ */
+static void * sim_irq_thread(void * arg)
+{
+    struct sim_chip * sim = arg;
+
+    pthread_mutex_lock(&sim->mutex);
+
+    for (;;)
+    {
+        struct gpio_callback * fire[SIM_CALLBACKS_MAX];
+        gpio_port_pins_t fire_pins[SIM_CALLBACKS_MAX];
+        uint8_t nb_fire = 0;
+        uint64_t now = posix_now_us();
+
+        sim_update(sim, now);
+
+        for (int pin = 0; pin < LR1110_SIM_PIN_COUNT; pin++)
+        {
+            gpio_flags_t flags = sim->int_flags[pin];
+            int level = sim_pin_level(sim, pin, now);
+            int last = sim->int_level[pin];
+            bool trigger;
+
+            sim->int_level[pin] = level;
+
+            if (!(flags & GPIO_INT_ENABLE)) {
+                continue;
+            }
+            if (flags & GPIO_INT_EDGE) {
+                trigger = ((flags & GPIO_INT_HIGH_1) && !last && level) ||
+                          ((flags & GPIO_INT_LOW_0) && last && !level);
+            }
+            else {
+                trigger = ((flags & GPIO_INT_HIGH_1) && level) ||
+                          ((flags & GPIO_INT_LOW_0) && !level);
+            }
+            if (!trigger) {
+                continue;
+            }
+
+            for (struct gpio_callback * cb = sim->callbacks;
+                 cb && nb_fire < SIM_CALLBACKS_MAX; cb = cb->next)
+            {
+                if (cb->pin_mask & BIT(pin)) {
+                    fire[nb_fire] = cb;
+                    fire_pins[nb_fire++] = BIT(pin);
+                }
+            }
+        }
+
+        if (nb_fire) {
+            /* Callbacks reconfigure interrupts, so lock is released */
+            pthread_mutex_unlock(&sim->mutex);
+            posix_isr_enter();
+            for (uint8_t i = 0; i < nb_fire; i++) {
+                fire[i]->handler(&sim->gpio_dev, fire[i], fire_pins[i]);
+            }
+            posix_isr_exit();
+            pthread_mutex_lock(&sim->mutex);
+            continue;
+        }
+
+        uint64_t next = UINT64_MAX;
+
+        if (sim->busy_until > now) {
+            next = sim->busy_until;
+        }
+        if (sim->scanning) {
+            next = MIN(next, sim->scan_end);
+        }
+        if (sim->lora_tx || (sim->lora_rx && sim->lora_script_len)) {
+            next = MIN(next, sim->lora_end);
+        }
+
+        if (next == UINT64_MAX) {
+            pthread_cond_wait(&sim->cond, &sim->mutex);
+        }
+        else {
+            struct timespec ts;
+
+            posix_abs_time(&ts, next);
+            pthread_cond_timedwait(&sim->cond, &sim->mutex, &ts);
+        }
+    }
+    return NULL;
+}
+
+
+/*!
+ * @brief               Advances modelled operations to current time
+ */
+static void sim_update(struct sim_chip * sim, uint64_t now)
+{
+    if (sim->scanning && now >= sim->scan_end) {
+        sim_wifi_finish(sim, now);
+    }
+    /* Packets due while host was busy are all received */
+    while ((sim->lora_tx || (sim->lora_rx && sim->lora_script_len)) &&
+           now >= sim->lora_end) {
+        sim_lora_finish(sim);
+    }
+}
+
+
+/*!
+ * @brief               Level of a line, as seen by host
+ */
+static int sim_pin_level(struct sim_chip * sim, enum lr1110_sim_pin pin,
+                         uint64_t now)
+{
+    switch (pin)
+    {
+        case LR1110_SIM_PIN_BUSY:
+            return sim->reset_low || sim->sleeping || now < sim->busy_until;
+        case LR1110_SIM_PIN_EVENT:
+            return !sim->sleeping && (sim->irq_status & sim->irq_mask) != 0;
+        default:
+            return 0;
+    }
+}
+
+
+/*!
+ * @brief               Reset released, chip boots into standby
+ */
+static void sim_reboot(struct sim_chip * sim, uint64_t now,
+                       uint8_t reset_status)
+{
+    sim->busy_until = now + sim->config.boot_us;
+    sim->sleeping = false;
+    sim->mode = SIM_MODE_STANDBY_RC;
+    sim->reset_status = reset_status;
+    sim->cmd_status = SIM_CMD_OK;
+    sim->irq_status = 0;
+    sim->irq_mask = 0;
+    sim->errors = 0;
+    sim->response_pending = false;
+    sim->scanning = false;
+    sim->lora_tx = false;
+    sim->lora_rx = false;
+    sim->results = NULL;
+    sim->nb_results = 0;
+    memset(&sim->timings, 0, sizeof(sim->timings));
+    memset(sim->regmem, 0, sizeof(sim->regmem));
+    sim->stats.resets++;
+}
+
+
+/*!
+ * @brief               Byte clocked out by chip at position of frame
+ */
+static uint8_t sim_miso(struct sim_chip * sim, size_t pos)
+{
+    uint8_t stat1 = ((sim->response_frame ? SIM_CMD_DAT : sim->cmd_status)
+                     << 1) | ((sim->irq_status & sim->irq_mask) ? 1 : 0);
+
+    if (sim->response_frame) {
+        if (pos == 0) {
+            return stat1;
+        }
+        return pos - 1 < sim->response_len ? sim->response[pos - 1] : 0;
+    }
+
+    switch (pos)
+    {
+        case 0: return stat1;
+        case 1: return (sim->reset_status << 4) | (sim->mode << 1);
+        case 2: return sim->irq_status >> 24;
+        case 3: return sim->irq_status >> 16;
+        case 4: return sim->irq_status >> 8;
+        case 5: return sim->irq_status;
+        default: return 0;
+    }
+}
+
+
+/*!
+ * @brief               Executes command frame on NSS rising edge
+ */
+static void sim_frame_end(struct sim_chip * sim, uint64_t now)
+{
+    sim->stats.frames++;
+
+    if (sim->response_frame) {
+        sim->response_pending = false;
+        return;
+    }
+    if (sim->frame_len < 2 || sim->reset_low || sim->sleeping) {
+        return;
+    }
+
+    uint16_t opcode = (sim->frame[0] << 8) | sim->frame[1];
+    const uint8_t * params = &sim->frame[2];
+    size_t len = MIN(sim->frame_len, SIM_FRAME_MAX) - 2;
+
+    sim->stats.commands++;
+    sim->cmd_status = SIM_CMD_OK;
+    sim->response_pending = false;
+    sim->response_len = 0;
+    sim->busy_until = now + sim->config.cmd_us;
+
+    switch (opcode >> 8)
+    {
+        case SIM_GROUP_SYSTEM:
+            sim_system_cmd(sim, opcode, params, len, now);
+            break;
+        case SIM_GROUP_RADIO:
+            sim_radio_cmd(sim, opcode, params, len, now);
+            break;
+        case SIM_GROUP_WIFI:
+            sim_wifi_cmd(sim, opcode, params, len, now);
+            break;
+        default:
+            sim->cmd_status = SIM_CMD_FAIL;
+            break;
+    }
+
+    if (sim->cmd_status == SIM_CMD_FAIL) {
+        sim->stats.unknown_commands++;
+        sim->irq_status |= LR1110_SYSTEM_IRQ_CMD_ERROR;
+    }
+}
+
+
+static void sim_respond(struct sim_chip * sim, const uint8_t * data,
+                        size_t len)
+{
+    len = MIN(len, SIM_RESPONSE_MAX);
+    memcpy(sim->response, data, len);
+    sim->response_len = len;
+    sim->response_pending = true;
+}
+
+
+/*!
+ * @brief               System and register memory commands. Configuration
+ *                      commands that do not change modelled state are
+ *                      accepted.
+ */
+static void sim_system_cmd(struct sim_chip * sim, uint16_t opcode,
+                           const uint8_t * params, size_t len, uint64_t now)
+{
+    uint8_t buf[4 * SIM_REGMEM_WORDS];
+
+    switch (opcode)
+    {
+        case SIM_SYSTEM_GET_VERSION:
+            buf[0] = LR1110_SIM_VERSION_HW;
+            buf[1] = LR1110_SIM_VERSION_TYPE;
+            put_be16(&buf[2], LR1110_SIM_VERSION_FW);
+            sim_respond(sim, buf, 4);
+            break;
+
+        case SIM_SYSTEM_GET_ERRORS:
+            put_be16(buf, sim->errors);
+            sim_respond(sim, buf, 2);
+            break;
+
+        case SIM_SYSTEM_CLEAR_ERRORS:
+            sim->errors = 0;
+            break;
+
+        case SIM_SYSTEM_CALIBRATE:
+            sim->busy_until = now + sim->config.calibrate_us;
+            break;
+
+        case SIM_SYSTEM_SET_DIOIRQPARAMS:
+            if (len >= 4) {
+                sim->irq_mask = get_be32(params);
+            }
+            break;
+
+        case SIM_SYSTEM_CLEAR_IRQ:
+            if (len >= 4) {
+                sim->irq_status &= ~get_be32(params);
+            }
+            break;
+
+        case SIM_SYSTEM_SET_SLEEP:
+            sim->sleeping = true;
+            sim->mode = SIM_MODE_SLEEP;
+            break;
+
+        case SIM_SYSTEM_SET_STANDBY:
+            sim->scanning = false;
+            sim->lora_tx = false;
+            sim->lora_rx = false;
+            sim->mode = SIM_MODE_STANDBY_RC;
+            break;
+
+        case SIM_SYSTEM_WRITE_REGMEM32:
+            for (size_t i = 4; len >= 4 && i + 4 <= len; i += 4)
+            {
+                uint32_t address = get_be32(params) + i - 4;
+                int slot = -1;
+
+                for (int j = 0; j < SIM_REGMEM_WORDS; j++)
+                {
+                    if (sim->regmem[j].address == address ||
+                        (slot < 0 && !sim->regmem[j].address)) {
+                        slot = j;
+                        if (sim->regmem[j].address == address) {
+                            break;
+                        }
+                    }
+                }
+                if (slot >= 0) {
+                    sim->regmem[slot].address = address;
+                    sim->regmem[slot].value = get_be32(&params[i]);
+                }
+            }
+            break;
+
+        case SIM_SYSTEM_READ_REGMEM32:
+            if (len >= 5) {
+                uint8_t nb_words = MIN(params[4], SIM_REGMEM_WORDS);
+
+                memset(buf, 0, 4 * nb_words);
+                for (uint8_t i = 0; i < nb_words; i++)
+                {
+                    uint32_t address = get_be32(params) + 4 * i;
+
+                    for (int j = 0; j < SIM_REGMEM_WORDS; j++)
+                    {
+                        if (sim->regmem[j].address == address) {
+                            put_be32(&buf[4 * i], sim->regmem[j].value);
+                        }
+                    }
+                }
+                sim_respond(sim, buf, 4 * nb_words);
+            }
+            break;
+
+        case SIM_SYSTEM_WRITE_BUFFER8:
+            memcpy(sim->tx_buffer, params, MIN(len, SIM_RADIO_BUFFER_SIZE));
+            break;
+
+        case SIM_SYSTEM_READ_BUFFER8:
+            if (len < 2 || params[0] + params[1] > SIM_RADIO_BUFFER_SIZE) {
+                sim->cmd_status = SIM_CMD_FAIL;
+                break;
+            }
+            sim_respond(sim, &sim->rx_buffer[params[0]], params[1]);
+            break;
+
+        case SIM_SYSTEM_CLEAR_RX_BUFFER:
+            memset(sim->rx_buffer, 0, sizeof(sim->rx_buffer));
+            sim->rx_length = 0;
+            break;
+
+        default:
+            /* GetStatus is served by status bytes of the frame */
+            if ((opcode & 0xFF) > 0x2A) {
+                sim->cmd_status = SIM_CMD_FAIL;
+            }
+            break;
+    }
+}
+
+
+/*!
+ * @brief               Radio commands of LoRa packets. Modulation settings
+ *                      are accepted, air time is lora_packet_us.
+ */
+static void sim_radio_cmd(struct sim_chip * sim, uint16_t opcode,
+                          const uint8_t * params, size_t len, uint64_t now)
+{
+    uint8_t buf[3];
+
+    switch (opcode)
+    {
+        case SIM_RADIO_SET_PKT_PARAMS:
+            if (len >= 4) {
+                sim->pkt_length = params[3];
+            }
+            break;
+
+        case SIM_RADIO_SET_TX:
+            sim->lora_rx = false;
+            sim->lora_tx = true;
+            sim->lora_end = now + sim->config.lora_packet_us;
+            sim->mode = SIM_MODE_TX;
+            break;
+
+        case SIM_RADIO_SET_RX:
+            if (len < 3) {
+                sim->cmd_status = SIM_CMD_FAIL;
+                break;
+            }
+            sim->lora_tx = false;
+            sim->lora_rx = true;
+            sim->lora_rx_continuous = ((params[0] << 16) | (params[1] << 8) |
+                                      params[2]) == SIM_RX_CONTINUOUS;
+            sim->lora_end = now + sim->config.lora_rx_interval_us +
+                           sim->config.lora_packet_us;
+            sim->mode = SIM_MODE_RX;
+            break;
+
+        case SIM_RADIO_GET_RX_BUFFER_STATUS:
+            buf[0] = sim->rx_length;
+            buf[1] = 0;
+            sim_respond(sim, buf, 2);
+            break;
+
+        case SIM_RADIO_GET_PKT_STATUS:
+            /* LoRa: RSSI and signal RSSI as -2 * dBm, SNR as 4 * dB */
+            buf[0] = -2 * sim->rx_rssi;
+            buf[1] = 4 * sim->rx_snr;
+            buf[2] = -2 * sim->rx_rssi;
+            sim_respond(sim, buf, 3);
+            break;
+
+        default:
+            break;
+    }
+}
+
+
+/*!
+ * @brief               Packet sent or received. Continuous receive stays
+ *                      in RX for next packet.
+ */
+static void sim_lora_finish(struct sim_chip * sim)
+{
+    if (sim->lora_tx) {
+        sim->lora_tx = false;
+        sim->mode = SIM_MODE_STANDBY_RC;
+        sim->stats.lora_tx_packets++;
+        sim->irq_status |= LR1110_SYSTEM_IRQ_TX_DONE;
+        return;
+    }
+
+    const struct lr1110_sim_lora_packet * packet =
+        &sim->lora_script[sim->lora_script_pos].packet;
+
+    sim->lora_script_pos = (sim->lora_script_pos + 1) % sim->lora_script_len;
+
+    if (sim->irq_status & LR1110_SYSTEM_IRQ_RX_DONE) {
+        sim->stats.lora_rx_overruns++;
+    }
+    memcpy(sim->rx_buffer, packet->data, packet->length);
+    sim->rx_length = packet->length;
+    sim->rx_rssi = packet->rssi;
+    sim->rx_snr = packet->snr;
+    sim->stats.lora_rx_packets++;
+    sim->irq_status |= LR1110_SYSTEM_IRQ_RX_DONE;
+    if (packet->crc_error) {
+        sim->irq_status |= LR1110_SYSTEM_IRQ_CRC_ERROR;
+    }
+
+    if (sim->lora_rx_continuous) {
+        sim->lora_end += sim->config.lora_rx_interval_us +
+                        sim->config.lora_packet_us;
+    }
+    else {
+        sim->lora_rx = false;
+        sim->mode = SIM_MODE_STANDBY_RC;
+    }
+}
+
+
+/*!
+ * @brief               Wifi commands. BUSY stays high for the whole scan.
+ */
+static void sim_wifi_cmd(struct sim_chip * sim, uint16_t opcode,
+                         const uint8_t * params, size_t len, uint64_t now)
+{
+    uint8_t buf[SIM_RESPONSE_MAX];
+
+    switch (opcode)
+    {
+        case SIM_WIFI_SCAN:
+            if (len < 9) {
+                sim->cmd_status = SIM_CMD_FAIL;
+                break;
+            }
+            sim->scan_type = params[0];
+            sim->scan_channels = ((params[1] << 8) | params[2]) &
+                                LR1110_WIFI_ALL_CHANNELS;
+            sim->scan_mode = params[3];
+            sim->scan_max_results = params[4];
+            sim->scan_end = now + (uint64_t)
+                           __builtin_popcount(sim->scan_channels) *
+                           params[5] * sim->config.wifi_scan_us;
+            sim->busy_until = sim->scan_end;
+            sim->scanning = true;
+            sim->mode = SIM_MODE_WIFI_GNSS;
+            sim->stats.wifi_scans++;
+            break;
+
+        case SIM_WIFI_GET_NB_RESULTS:
+            buf[0] = sim->nb_results;
+            sim_respond(sim, buf, 1);
+            break;
+
+        case SIM_WIFI_READ_RESULTS:
+            if (len < 3) {
+                sim->cmd_status = SIM_CMD_FAIL;
+                break;
+            }
+            size_t size = 0;
+
+            for (uint8_t i = params[0];
+                 i < sim->nb_results && i < params[0] + params[1]; i++)
+            {
+                if (size + SIM_WIFI_EXTENDED_FULL_SIZE > sizeof(buf)) {
+                    break;
+                }
+                size += sim_wifi_put_result(sim, 
+                    &buf[size], params[2],
+                    &sim->results->aps[sim->result_index[i]]);
+            }
+            sim_respond(sim, buf, size);
+            break;
+
+        case SIM_WIFI_RESET_CUMUL_TIMING:
+            memset(&sim->timings, 0, sizeof(sim->timings));
+            break;
+
+        case SIM_WIFI_READ_CUMUL_TIMING:
+            /* In field order of lr1110_wifi_cumulative_timings_t */
+            put_be32(&buf[0], sim->timings.rx_detection_us);
+            put_be32(&buf[4], sim->timings.rx_correlation_us);
+            put_be32(&buf[8], sim->timings.rx_capture_us);
+            put_be32(&buf[12], sim->timings.demodulation_us);
+            sim_respond(sim, buf, 16);
+            break;
+
+        case SIM_WIFI_GET_VERSION:
+            buf[0] = 1;
+            buf[1] = 3;
+            sim_respond(sim, buf, 2);
+            break;
+
+        default:
+            /* Remaining wifi commands only configure the scanner */
+            break;
+    }
+}
+
+
+/*!
+ * @brief               Scan is over, results are taken from next scripted
+ *                      scan and WIFI_SCAN_DONE is raised
+ */
+static void sim_wifi_finish(struct sim_chip * sim, uint64_t now)
+{
+    uint32_t scan_us = __builtin_popcount(sim->scan_channels) *
+                       sim->config.wifi_scan_us;
+
+    sim->scanning = false;
+    sim->mode = SIM_MODE_STANDBY_RC;
+    sim->nb_results = 0;
+    sim->results = NULL;
+
+    if (sim->script_len) {
+        sim->results = &sim->script[sim->script_pos];
+        sim->script_pos = (sim->script_pos + 1) % sim->script_len;
+
+        for (uint8_t i = 0; i < sim->results->nb_aps &&
+                            sim->nb_results < sim->scan_max_results; i++)
+        {
+            const struct lr1110_sim_ap * ap = &sim->results->aps[i].ap;
+            bool type_ok = sim->scan_type == LR1110_WIFI_TYPE_SCAN_B_G_N ||
+                           sim->scan_type == ap->signal_type;
+
+            if (type_ok && ap->channel >= 1 && ap->channel <= 14 &&
+                (sim->scan_channels & BIT(ap->channel - 1))) {
+                sim->result_index[sim->nb_results++] = i;
+            }
+        }
+    }
+
+    /* Synthetic split of scan time between scanner phases */
+    sim->timings.rx_detection_us += scan_us / 2;
+    sim->timings.rx_correlation_us += scan_us / 4;
+    sim->timings.rx_capture_us += scan_us / 8;
+    sim->timings.demodulation_us += sim->nb_results *
+                                   (sim->config.wifi_scan_us / 8);
+
+    sim->irq_status |= LR1110_SYSTEM_IRQ_WIFI_SCAN_DONE;
+}
+
+
+/*!
+ * @brief               Writes one result in requested format. Scans in
+ *                      full beacon mode give extended results.
+ *
+ * @return              Size of result
+ */
+static size_t sim_wifi_put_result(struct sim_chip * sim, uint8_t * buf,
+                                  uint8_t format,
+                                  const struct sim_ap * sim_ap)
+{
+    const struct lr1110_sim_ap * ap = &sim_ap->ap;
+    uint8_t data_rate_info = ap->signal_type & 0x03;
+    uint8_t channel_info = ap->channel & 0x0F;
+
+    if (format == SIM_WIFI_FORMAT_MAC_TYPE) {
+        buf[0] = data_rate_info;
+        buf[1] = channel_info;
+        buf[2] = ap->rssi;
+        memcpy(&buf[3], ap->mac, LR1110_WIFI_MAC_ADDRESS_LENGTH);
+        return SIM_WIFI_BASIC_MAC_TYPE_SIZE;
+    }
+
+    if (sim->scan_mode != LR1110_WIFI_SCAN_MODE_FULL_BEACON) {
+        memset(buf, 0, SIM_WIFI_BASIC_COMPLETE_SIZE);
+        buf[0] = data_rate_info;
+        buf[1] = channel_info;
+        buf[2] = ap->rssi;
+        buf[3] = 0x00;              /* Beacon */
+        memcpy(&buf[4], ap->mac, LR1110_WIFI_MAC_ADDRESS_LENGTH);
+        put_be16(&buf[20], 100);    /* Beacon period, TU */
+        return SIM_WIFI_BASIC_COMPLETE_SIZE;
+    }
+
+    memset(buf, 0, SIM_WIFI_EXTENDED_FULL_SIZE);
+    buf[0] = data_rate_info;
+    buf[1] = channel_info;
+    buf[2] = ap->rssi;
+    put_be16(&buf[8], 0x0080);      /* Frame control, beacon */
+    memset(&buf[10], 0xFF, LR1110_WIFI_MAC_ADDRESS_LENGTH);
+    memcpy(&buf[16], ap->mac, LR1110_WIFI_MAC_ADDRESS_LENGTH);
+    memcpy(&buf[22], ap->mac, LR1110_WIFI_MAC_ADDRESS_LENGTH);
+    put_be16(&buf[36], 100);
+    memcpy(&buf[40], sim_ap->ssid, SIM_SSID_MAX);
+    buf[72] = ap->channel;
+    buf[76] = 1;                    /* FCS ok */
+    return SIM_WIFI_EXTENDED_FULL_SIZE;
+}
+
+
+static uint32_t get_be32(const uint8_t * buf)
+{
+    return ((uint32_t) buf[0] << 24) | ((uint32_t) buf[1] << 16) |
+           ((uint32_t) buf[2] << 8) | buf[3];
+}
+
+
+static void put_be16(uint8_t * buf, uint16_t value)
+{
+    buf[0] = value >> 8;
+    buf[1] = value;
+}
+
+
+static void put_be32(uint8_t * buf, uint32_t value)
+{
+    buf[0] = value >> 24;
+    buf[1] = value >> 16;
+    buf[2] = value >> 8;
+    buf[3] = value;
+}
+
+
+static int sim_gpio_configure(const struct device * port, gpio_pin_t pin,
+                              gpio_flags_t flags)
+{
+    if (flags & GPIO_OUTPUT_INIT_LOW) {
+        return sim_gpio_set(port, pin, 0);
+    }
+    if (flags & GPIO_OUTPUT_INIT_HIGH) {
+        return sim_gpio_set(port, pin, 1);
+    }
+    return 0;
+}
+
+
+static int sim_gpio_get(const struct device * port, gpio_pin_t pin)
+{
+    struct sim_chip * sim = port->data;
+    int level;
+
+    if (pin >= LR1110_SIM_PIN_COUNT) {
+        return -EINVAL;
+    }
+
+    pthread_mutex_lock(&sim->mutex);
+    uint64_t now = posix_now_us();
+
+    sim_update(sim, now);
+    level = sim_pin_level(sim, pin, now);
+    pthread_mutex_unlock(&sim->mutex);
+    return level;
+}
+
+
+/*!
+ * @brief               Host drives reset and NSS, NSS edges frame commands
+ *                      and wake chip from sleep
+ */
+static int sim_gpio_set(const struct device * port, gpio_pin_t pin,
+                        int value)
+{
+    struct sim_chip * sim = port->data;
+
+    pthread_mutex_lock(&sim->mutex);
+    uint64_t now = posix_now_us();
+
+    sim_update(sim, now);
+
+    switch (pin)
+    {
+        case LR1110_SIM_PIN_RESET:
+            if (!sim->reset_low && !value) {
+                sim->reset_low = true;
+            }
+            else if (sim->reset_low && value) {
+                sim->reset_low = false;
+                sim_reboot(sim, now, SIM_RESET_EXTERNAL);
+            }
+            break;
+
+        case LR1110_SIM_PIN_NSS:
+            if (!sim->nss_low && !value) {
+                sim->nss_low = true;
+                sim->frame_len = 0;
+                sim->response_frame = sim->response_pending;
+                if (sim->sleeping) {
+                    sim->sleeping = false;
+                    sim->mode = SIM_MODE_STANDBY_RC;
+                    sim->reset_status = SIM_RESET_WAKEUP;
+                    sim->busy_until = now + sim->config.wakeup_us;
+                }
+            }
+            else if (sim->nss_low && value) {
+                sim->nss_low = false;
+                if (sim->frame_len) {
+                    sim_frame_end(sim, now);
+                }
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    pthread_cond_signal(&sim->cond);
+    pthread_mutex_unlock(&sim->mutex);
+    return 0;
+}
+
+
+static int sim_gpio_interrupt_configure(const struct device * port,
+                                        gpio_pin_t pin, gpio_flags_t flags)
+{
+    struct sim_chip * sim = port->data;
+
+    if (pin >= LR1110_SIM_PIN_COUNT) {
+        return -EINVAL;
+    }
+
+    pthread_mutex_lock(&sim->mutex);
+    uint64_t now = posix_now_us();
+
+    sim_update(sim, now);
+    sim->int_flags[pin] = (flags & GPIO_INT_DISABLE) ? 0 : flags;
+    sim->int_level[pin] = sim_pin_level(sim, pin, now);
+    pthread_cond_signal(&sim->cond);
+    pthread_mutex_unlock(&sim->mutex);
+    return 0;
+}
+
+
+static int sim_gpio_manage_callback(const struct device * port,
+                                    struct gpio_callback * cb, bool set)
+{
+    struct sim_chip * sim = port->data;
+
+    pthread_mutex_lock(&sim->mutex);
+
+    struct gpio_callback ** link = &sim->callbacks;
+
+    while (*link && *link != cb) {
+        link = &(*link)->next;
+    }
+    if (*link) {
+        *link = cb->next;
+    }
+    if (set) {
+        cb->next = sim->callbacks;
+        sim->callbacks = cb;
+    }
+
+    pthread_mutex_unlock(&sim->mutex);
+    return 0;
+}
+
+
+/*!
+ * @brief               Exchanges bytes of current frame. NSS has to be low.
+ *                      With spi_timing, call takes as long as transfer at
+ *                      configured clock.
+ */
+static int sim_spi_transceive(const struct device * dev,
+                              const struct spi_config * config,
+                              const struct spi_buf_set * tx_bufs,
+                              const struct spi_buf_set * rx_bufs)
+{
+    struct sim_chip * sim = dev->data;
+    size_t tx_len = 0;
+    size_t rx_len = 0;
+    uint64_t start = posix_now_us();
+
+    for (size_t i = 0; tx_bufs && i < tx_bufs->count; i++) {
+        tx_len += tx_bufs->buffers[i].len;
+    }
+    for (size_t i = 0; rx_bufs && i < rx_bufs->count; i++) {
+        rx_len += rx_bufs->buffers[i].len;
+    }
+
+    pthread_mutex_lock(&sim->mutex);
+
+    if (!sim->nss_low) {
+        pthread_mutex_unlock(&sim->mutex);
+        return -EIO;
+    }
+
+    bool corrupt = sim->config.spi_max_frequency &&
+                   config->frequency > sim->config.spi_max_frequency;
+    size_t len = MAX(tx_len, rx_len);
+    size_t tx_buf = 0, tx_pos = 0, rx_buf = 0, rx_pos = 0;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        uint8_t mosi = 0;
+        uint8_t miso = sim_miso(sim, sim->frame_len);
+
+        /* Advance over tx buffers, NULL buffer clocks zeros */
+        while (tx_bufs && tx_buf < tx_bufs->count &&
+               tx_pos >= tx_bufs->buffers[tx_buf].len) {
+            tx_buf++;
+            tx_pos = 0;
+        }
+        if (tx_bufs && tx_buf < tx_bufs->count) {
+            const uint8_t * data = tx_bufs->buffers[tx_buf].buf;
+
+            mosi = data ? data[tx_pos] : 0;
+            tx_pos++;
+        }
+
+        while (rx_bufs && rx_buf < rx_bufs->count &&
+               rx_pos >= rx_bufs->buffers[rx_buf].len) {
+            rx_buf++;
+            rx_pos = 0;
+        }
+        if (rx_bufs && rx_buf < rx_bufs->count) {
+            uint8_t * data = rx_bufs->buffers[rx_buf].buf;
+
+            if (data) {
+                data[rx_pos] = corrupt ? miso ^ (1 << (i % 8)) : miso;
+            }
+            rx_pos++;
+        }
+
+        if (sim->frame_len < SIM_FRAME_MAX) {
+            sim->frame[sim->frame_len] = corrupt ? mosi ^ 0x01 : mosi;
+        }
+        sim->frame_len++;
+    }
+
+    sim->stats.bytes += len;
+    if (corrupt) {
+        sim->stats.corrupted_frames++;
+    }
+    bool spi_timing = sim->config.spi_timing;
+
+    pthread_mutex_unlock(&sim->mutex);
+
+    if (spi_timing && config->frequency) {
+        uint64_t end = start + (len * 8 * 1000000ULL + config->frequency - 1) /
+                               config->frequency;
+
+        while (posix_now_us() < end);
+    }
+    return 0;
+}
+
+/*** end of file ***/
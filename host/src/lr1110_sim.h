@@ -0,0 +1,127 @@
+/** @file lr1110_sim.h
+ *
+ * @brief       Simulated LR1110 for host builds. Simulator provides a GPIO
+ *              port and a SPI bus device, decodes SPI command frames the 
+ *              way the chip does and drives BUSY and event (DIO9) lines 
+ *              with configurable timing. System commands used by 
+ *              lr1110_init, register memory, IRQ status, wifi scans 
+ *              that return scripted access point sets and LoRa packets
+ *              sent and received over a scripted link are modelled.
+ *
+ *              Several chips can be simulated, each one is an instance
+ *              with its own GPIO port, SPI bus device, scripts and
+ *              statistics, so radios can run in parallel without sharing
+ *              any state.
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 Irnas.  All rights reserved.
+ */
+
+#ifndef LR1110_SIM_H
+#define LR1110_SIM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "lr1110.h"
+
+/* Number of simulated chips */
+#ifndef LR1110_SIM_INSTANCES
+#define LR1110_SIM_INSTANCES        4
+#endif
+
+/* Version reported by simulated chip */
+#define LR1110_SIM_VERSION_HW       0x22
+#define LR1110_SIM_VERSION_TYPE     0x01
+#define LR1110_SIM_VERSION_FW       0x0307
+
+/* Pins of simulated GPIO port */
+enum lr1110_sim_pin {
+    LR1110_SIM_PIN_RESET = 0,
+    LR1110_SIM_PIN_NSS,
+    LR1110_SIM_PIN_BUSY,
+    LR1110_SIM_PIN_EVENT,
+    LR1110_SIM_PIN_LNA,
+    LR1110_SIM_PIN_COUNT,
+};
+
+/*!
+ * @brief Timing and link model. Defaults are shorter than on real chip, 
+ *        so runs against simulator are fast.
+ */
+struct lr1110_sim_config {
+    uint32_t boot_us;               /* BUSY high after reset */
+    uint32_t wakeup_us;             /* BUSY high after wakeup from sleep */
+    uint32_t cmd_us;                /* BUSY high after each command */
+    uint32_t calibrate_us;          /* BUSY high after calibration */
+    uint32_t wifi_scan_us;          /* Per channel and per scan */
+    uint32_t lora_packet_us;        /* Air time of each LoRa packet */
+    uint32_t lora_rx_interval_us;   /* Gap between received packets */
+    bool spi_timing;                /* Transfers take time of SPI clock */
+    uint32_t spi_max_frequency;     /* Received bytes are corrupted above 
+                                     * this clock, 0 for no limit */
+};
+
+/*!
+ * @brief Scripted access point
+ */
+struct lr1110_sim_ap {
+    uint8_t mac[LR1110_WIFI_MAC_ADDRESS_LENGTH];
+    int8_t rssi;
+    uint8_t channel;                /* 1 to 14 */
+    uint8_t signal_type;            /* 1 - B, 2 - G, 3 - N */
+    const char * ssid;              /* Copied, can be NULL */
+};
+
+/*!
+ * @brief Scripted LoRa packet
+ */
+struct lr1110_sim_lora_packet {
+    const uint8_t * data;           /* Copied */
+    uint8_t length;
+    int8_t rssi;
+    int8_t snr;
+    bool crc_error;
+};
+
+/*!
+ * @brief Simulator counters
+ */
+struct lr1110_sim_stats {
+    uint32_t frames;                /* NSS framed transfers */
+    uint32_t commands;
+    uint32_t unknown_commands;
+    uint32_t bytes;
+    uint32_t resets;
+    uint32_t wifi_scans;
+    uint32_t lora_tx_packets;
+    uint32_t lora_rx_packets;
+    uint32_t lora_rx_overruns;      /* Received while RX_DONE was pending */
+    uint32_t corrupted_frames;      /* Transfers above spi_max_frequency */
+};
+
+struct lr1110_sim_config lr1110_sim_default_config(void);
+int lr1110_sim_init(uint8_t instance, const struct lr1110_sim_config * config);
+int lr1110_sim_attach(uint8_t instance, lr1110_t * lr1110);
+
+int lr1110_sim_add_wifi_scan(uint8_t instance,
+                             const struct lr1110_sim_ap * aps,
+                             uint8_t nb_aps);
+void lr1110_sim_clear_wifi_scans(uint8_t instance);
+
+int lr1110_sim_add_lora_packet(uint8_t instance,
+                               const struct lr1110_sim_lora_packet * packet);
+void lr1110_sim_clear_lora_packets(uint8_t instance);
+
+void lr1110_sim_get_stats(uint8_t instance, struct lr1110_sim_stats * stats);
+void lr1110_sim_reset_stats(uint8_t instance);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LR1110_SIM_H */
+/*** end of file ***/
@@ -0,0 +1,704 @@
+/** @file posix_kernel.c
+ *
+ * @brief       POSIX implementation of the Zephyr kernel API used by the 
+ *              library. Semaphores and mutexes are built on pthreads, 
+ *              each work queue is a single thread, system work queue is
+ *              started on first use. All waits use CLOCK_MONOTONIC.
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 Irnas.  All rights reserved.
+ */
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <sched.h>
+#include <unistd.h>
+#include <zephyr.h>
+#include <device.h>
+#include "posix_kernel.h"
+
+/* -------------------------------------------------------------------------
+ * PRIVATE VARIABLES
+ * ------------------------------------------------------------------------- */
+
+static struct timespec boot_time;
+static __thread int isr_nesting;
+
+static pthread_mutex_t devices_mutex = PTHREAD_MUTEX_INITIALIZER;
+static const struct device * devices;
+
+/* Work queues, one mutex guards all of them */
+struct k_work_q k_sys_work_q;
+static pthread_once_t workq_once = PTHREAD_ONCE_INIT;
+static pthread_once_t workq_idle_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t workq_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t workq_idle_cond;
+
+/* -------------------------------------------------------------------------
+ * PRIVATE PROTOTYPES
+ * ------------------------------------------------------------------------- */
+static void timeout_to_abs(struct timespec * ts, k_timeout_t timeout);
+static void workq_sys_start(void);
+static void workq_idle_init(void);
+static void * workq_thread(void * arg);
+static void workq_append(struct k_work_q * queue, struct k_work * work);
+static bool workq_remove(struct k_work * work);
+static bool workq_remove_delayed(struct k_work_delayable * dwork);
+
+/* -------------------------------------------------------------------------
+ * PUBLIC IMPLEMENTATIONS
+ * ------------------------------------------------------------------------- */
+
+__attribute__((constructor))
+static void posix_kernel_init(void)
+{
+    clock_gettime(CLOCK_MONOTONIC, &boot_time);
+}
+
+
+/*!
+ * @brief               Time since start of the process
+ */
+uint64_t posix_now_us(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) (now.tv_sec - boot_time.tv_sec) * 1000000 +
+           (now.tv_nsec - boot_time.tv_nsec) / 1000;
+}
+
+
+/*!
+ * @brief               Converts process time to CLOCK_MONOTONIC timespec
+ */
+void posix_abs_time(struct timespec * ts, uint64_t at_us)
+{
+    uint64_t ns = boot_time.tv_nsec + (at_us % 1000000) * 1000;
+
+    ts->tv_sec = boot_time.tv_sec + at_us / 1000000 + ns / 1000000000;
+    ts->tv_nsec = ns % 1000000000;
+}
+
+
+/*!
+ * @brief               Initializes condition variable on CLOCK_MONOTONIC
+ */
+void posix_cond_init(pthread_cond_t * cond)
+{
+    pthread_condattr_t attr;
+
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+
+/*!
+ * @brief               Marks calling thread as interrupt context, while 
+ *                      simulated devices run GPIO callbacks
+ */
+void posix_isr_enter(void)
+{
+    isr_nesting++;
+}
+
+
+void posix_isr_exit(void)
+{
+    isr_nesting--;
+}
+
+
+int printk(const char * fmt, ...)
+{
+    va_list args;
+    int ret;
+
+    va_start(args, fmt);
+    ret = vprintf(fmt, args);
+    va_end(args);
+    return ret;
+}
+
+
+int64_t k_uptime_get(void)
+{
+    return posix_now_us() / 1000;
+}
+
+
+uint32_t k_uptime_get_32(void)
+{
+    return (uint32_t) k_uptime_get();
+}
+
+
+uint32_t k_cycle_get_32(void)
+{
+    return (uint32_t) posix_now_us();
+}
+
+
+void k_busy_wait(uint32_t usec_to_wait)
+{
+    uint64_t end = posix_now_us() + usec_to_wait;
+
+    while (posix_now_us() < end);
+}
+
+
+int32_t k_sleep(k_timeout_t timeout)
+{
+    struct timespec ts;
+
+    if (K_TIMEOUT_EQ(timeout, K_FOREVER)) {
+        for (;;) {
+            pause();
+        }
+    }
+
+    timeout_to_abs(&ts, timeout);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == 
+           EINTR);
+    return 0;
+}
+
+
+bool k_is_in_isr(void)
+{
+    return isr_nesting > 0;
+}
+
+
+void k_yield(void)
+{
+    sched_yield();
+}
+
+
+k_tid_t k_current_get(void)
+{
+    return pthread_self();
+}
+
+
+void device_register(struct device * dev)
+{
+    pthread_mutex_lock(&devices_mutex);
+    dev->next = devices;
+    devices = dev;
+    pthread_mutex_unlock(&devices_mutex);
+}
+
+
+const struct device * device_get_binding(const char * name)
+{
+    const struct device * dev;
+
+    pthread_mutex_lock(&devices_mutex);
+    for (dev = devices; dev; dev = dev->next)
+    {
+        if (name && !strcmp(dev->name, name)) {
+            break;
+        }
+    }
+    pthread_mutex_unlock(&devices_mutex);
+    return dev;
+}
+
+
+int k_sem_init(struct k_sem * sem, unsigned int initial_count, 
+               unsigned int limit)
+{
+    pthread_mutex_init(&sem->mutex, NULL);
+    posix_cond_init(&sem->cond);
+    sem->count = initial_count;
+    sem->limit = limit;
+    return 0;
+}
+
+
+int k_sem_take(struct k_sem * sem, k_timeout_t timeout)
+{
+    struct timespec ts;
+    int ret = 0;
+
+    timeout_to_abs(&ts, timeout);
+
+    pthread_mutex_lock(&sem->mutex);
+    while (sem->count == 0)
+    {
+        if (K_TIMEOUT_EQ(timeout, K_NO_WAIT)) {
+            ret = -EBUSY;
+            break;
+        }
+        if (K_TIMEOUT_EQ(timeout, K_FOREVER)) {
+            pthread_cond_wait(&sem->cond, &sem->mutex);
+        }
+        else if (pthread_cond_timedwait(&sem->cond, &sem->mutex, &ts) == 
+                 ETIMEDOUT && sem->count == 0) {
+            ret = -EAGAIN;
+            break;
+        }
+    }
+    if (!ret) {
+        sem->count--;
+    }
+    pthread_mutex_unlock(&sem->mutex);
+    return ret;
+}
+
+
+void k_sem_give(struct k_sem * sem)
+{
+    pthread_mutex_lock(&sem->mutex);
+    if (sem->count < sem->limit) {
+        sem->count++;
+    }
+    pthread_cond_signal(&sem->cond);
+    pthread_mutex_unlock(&sem->mutex);
+}
+
+
+void k_sem_reset(struct k_sem * sem)
+{
+    pthread_mutex_lock(&sem->mutex);
+    sem->count = 0;
+    pthread_mutex_unlock(&sem->mutex);
+}
+
+
+unsigned int k_sem_count_get(struct k_sem * sem)
+{
+    unsigned int count;
+
+    pthread_mutex_lock(&sem->mutex);
+    count = sem->count;
+    pthread_mutex_unlock(&sem->mutex);
+    return count;
+}
+
+
+int k_mutex_init(struct k_mutex * mutex)
+{
+    pthread_mutex_init(&mutex->mutex, NULL);
+    posix_cond_init(&mutex->cond);
+    mutex->lock_count = 0;
+    return 0;
+}
+
+
+int k_mutex_lock(struct k_mutex * mutex, k_timeout_t timeout)
+{
+    struct timespec ts;
+    pthread_t self = pthread_self();
+    int ret = 0;
+
+    timeout_to_abs(&ts, timeout);
+
+    pthread_mutex_lock(&mutex->mutex);
+    while (mutex->lock_count && !pthread_equal(mutex->owner, self))
+    {
+        if (K_TIMEOUT_EQ(timeout, K_NO_WAIT)) {
+            ret = -EBUSY;
+            break;
+        }
+        if (K_TIMEOUT_EQ(timeout, K_FOREVER)) {
+            pthread_cond_wait(&mutex->cond, &mutex->mutex);
+        }
+        else if (pthread_cond_timedwait(&mutex->cond, &mutex->mutex, &ts) ==
+                 ETIMEDOUT && mutex->lock_count) {
+            ret = -EAGAIN;
+            break;
+        }
+    }
+    if (!ret) {
+        mutex->owner = self;
+        mutex->lock_count++;
+    }
+    pthread_mutex_unlock(&mutex->mutex);
+    return ret;
+}
+
+
+int k_mutex_unlock(struct k_mutex * mutex)
+{
+    int ret = 0;
+
+    pthread_mutex_lock(&mutex->mutex);
+    if (!mutex->lock_count) {
+        ret = -EINVAL;
+    }
+    else if (!pthread_equal(mutex->owner, pthread_self())) {
+        ret = -EPERM;
+    }
+    else if (--mutex->lock_count == 0) {
+        pthread_cond_signal(&mutex->cond);
+    }
+    pthread_mutex_unlock(&mutex->mutex);
+    return ret;
+}
+
+
+k_tid_t k_work_queue_thread_get(struct k_work_q * queue)
+{
+    if (queue == &k_sys_work_q) {
+        pthread_once(&workq_once, workq_sys_start);
+    }
+    return queue->tid;
+}
+
+
+void k_work_queue_init(struct k_work_q * queue)
+{
+    memset(queue, 0, sizeof(*queue));
+}
+
+
+/*!
+ * @brief               Starts queue thread, stack and priority are left to
+ *                      pthreads
+ */
+void k_work_queue_start(struct k_work_q * queue,
+                        k_thread_stack_t * stack,
+                        size_t stack_size,
+                        int prio,
+                        const struct k_work_queue_config * cfg)
+{
+    pthread_once(&workq_idle_once, workq_idle_init);
+    posix_cond_init(&queue->cond);
+    pthread_create(&queue->tid, NULL, workq_thread, queue);
+    pthread_detach(queue->tid);
+}
+
+
+void k_work_init(struct k_work * work, k_work_handler_t handler)
+{
+    memset(work, 0, sizeof(*work));
+    work->handler = handler;
+}
+
+
+/*!
+ * @brief               Queues work, if it is not queued already
+ *
+ * @return              1 if queued, 0 if it was already queued
+ */
+int k_work_submit_to_queue(struct k_work_q * queue, struct k_work * work)
+{
+    int ret = 0;
+
+    pthread_mutex_lock(&workq_mutex);
+    if (!(work->flags & K_WORK_QUEUED)) {
+        workq_append(queue, work);
+        ret = 1;
+    }
+    pthread_mutex_unlock(&workq_mutex);
+    return ret;
+}
+
+
+int k_work_submit(struct k_work * work)
+{
+    pthread_once(&workq_once, workq_sys_start);
+    return k_work_submit_to_queue(&k_sys_work_q, work);
+}
+
+
+/*!
+ * @brief               Removes work from queue
+ *
+ * @return              K_WORK_RUNNING if handler is still running
+ */
+int k_work_cancel(struct k_work * work)
+{
+    int busy;
+
+    pthread_mutex_lock(&workq_mutex);
+    workq_remove(work);
+    busy = work->flags;
+    pthread_mutex_unlock(&workq_mutex);
+    return busy;
+}
+
+
+int k_work_busy_get(const struct k_work * work)
+{
+    int busy;
+
+    pthread_mutex_lock(&workq_mutex);
+    busy = work->flags;
+    pthread_mutex_unlock(&workq_mutex);
+    return busy;
+}
+
+
+/*!
+ * @brief               Waits until work is neither queued nor running
+ *
+ * @return              True if caller had to wait
+ */
+bool k_work_flush(struct k_work * work)
+{
+    bool waited = false;
+
+    pthread_once(&workq_idle_once, workq_idle_init);
+
+    pthread_mutex_lock(&workq_mutex);
+    while (work->flags & (K_WORK_QUEUED | K_WORK_RUNNING))
+    {
+        waited = true;
+        pthread_cond_wait(&workq_idle_cond, &workq_mutex);
+    }
+    pthread_mutex_unlock(&workq_mutex);
+    return waited;
+}
+
+
+void k_work_init_delayable(struct k_work_delayable * dwork, 
+                           k_work_handler_t handler)
+{
+    memset(dwork, 0, sizeof(*dwork));
+    dwork->work.handler = handler;
+}
+
+
+/*!
+ * @brief               Schedules work, if it is not scheduled or queued 
+ *                      already
+ *
+ * @return              1 if scheduled, 0 if it already was
+ */
+int k_work_schedule_for_queue(struct k_work_q * queue,
+                              struct k_work_delayable * dwork,
+                              k_timeout_t delay)
+{
+    int ret = 0;
+
+    pthread_mutex_lock(&workq_mutex);
+    if (!(dwork->work.flags & (K_WORK_QUEUED | K_WORK_DELAYED))) {
+        if (K_TIMEOUT_EQ(delay, K_NO_WAIT)) {
+            workq_append(queue, &dwork->work);
+        }
+        else {
+            dwork->due_us = posix_now_us() + delay.us;
+            dwork->work.queue = queue;
+            dwork->work.flags |= K_WORK_DELAYED;
+            dwork->next = queue->delayed;
+            queue->delayed = dwork;
+            pthread_cond_signal(&queue->cond);
+        }
+        ret = 1;
+    }
+    pthread_mutex_unlock(&workq_mutex);
+    return ret;
+}
+
+
+int k_work_schedule(struct k_work_delayable * dwork, k_timeout_t delay)
+{
+    pthread_once(&workq_once, workq_sys_start);
+    return k_work_schedule_for_queue(&k_sys_work_q, dwork, delay);
+}
+
+
+/*!
+ * @brief               Schedules work, replacing existing schedule
+ */
+int k_work_reschedule_for_queue(struct k_work_q * queue,
+                                struct k_work_delayable * dwork,
+                                k_timeout_t delay)
+{
+    pthread_mutex_lock(&workq_mutex);
+    workq_remove_delayed(dwork);
+    pthread_mutex_unlock(&workq_mutex);
+
+    return k_work_schedule_for_queue(queue, dwork, delay);
+}
+
+
+int k_work_reschedule(struct k_work_delayable * dwork, k_timeout_t delay)
+{
+    pthread_once(&workq_once, workq_sys_start);
+    return k_work_reschedule_for_queue(&k_sys_work_q, dwork, delay);
+}
+
+
+int k_work_cancel_delayable(struct k_work_delayable * dwork)
+{
+    int busy;
+
+    pthread_mutex_lock(&workq_mutex);
+    workq_remove_delayed(dwork);
+    workq_remove(&dwork->work);
+    busy = dwork->work.flags;
+    pthread_mutex_unlock(&workq_mutex);
+    return busy;
+}
+
+/* -------------------------------------------------------------------------
+ * PRIVATE IMPLEMENTATIONS
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * @brief               Absolute deadline of relative timeout
+ */
+static void timeout_to_abs(struct timespec * ts, k_timeout_t timeout)
+{
+    posix_abs_time(ts, posix_now_us() + (timeout.us > 0 ? timeout.us : 0));
+}
+
+
+static void workq_sys_start(void)
+{
+    k_work_queue_init(&k_sys_work_q);
+    k_work_queue_start(&k_sys_work_q, NULL, 0, 0, NULL);
+}
+
+
+static void workq_idle_init(void)
+{
+    posix_cond_init(&workq_idle_cond);
+}
+
+
+/*!
+ * @brief               Runs queued works, moves due delayed works to queue
+ */
+static void * workq_thread(void * arg)
+{
+    struct k_work_q * queue = arg;
+
+    pthread_mutex_lock(&workq_mutex);
+
+    for (;;)
+    {
+        uint64_t now = posix_now_us();
+        uint64_t next_due = UINT64_MAX;
+        struct k_work_delayable ** link = &queue->delayed;
+
+        while (*link)
+        {
+            struct k_work_delayable * dwork = *link;
+
+            if (dwork->due_us <= now) {
+                *link = dwork->next;
+                dwork->work.flags &= ~K_WORK_DELAYED;
+                workq_append(queue, &dwork->work);
+            }
+            else {
+                next_due = MIN(next_due, dwork->due_us);
+                link = &dwork->next;
+            }
+        }
+
+        struct k_work * work = queue->head;
+
+        if (!work) {
+            if (next_due == UINT64_MAX) {
+                pthread_cond_wait(&queue->cond, &workq_mutex);
+            }
+            else {
+                struct timespec ts;
+
+                posix_abs_time(&ts, next_due);
+                pthread_cond_timedwait(&queue->cond, &workq_mutex, &ts);
+            }
+            continue;
+        }
+
+        queue->head = work->next;
+        if (!queue->head) {
+            queue->tail = NULL;
+        }
+        work->flags = (work->flags & ~K_WORK_QUEUED) | K_WORK_RUNNING;
+
+        pthread_mutex_unlock(&workq_mutex);
+        work->handler(work);
+        pthread_mutex_lock(&workq_mutex);
+
+        work->flags &= ~K_WORK_RUNNING;
+        pthread_cond_broadcast(&workq_idle_cond);
+    }
+    return NULL;
+}
+
+
+/*!
+ * @brief               Appends work to queue, workq_mutex has to be held
+ */
+static void workq_append(struct k_work_q * queue, struct k_work * work)
+{
+    work->next = NULL;
+    work->queue = queue;
+    work->flags |= K_WORK_QUEUED;
+    if (queue->tail) {
+        queue->tail->next = work;
+    }
+    else {
+        queue->head = work;
+    }
+    queue->tail = work;
+    pthread_cond_signal(&queue->cond);
+}
+
+
+/*!
+ * @brief               Removes work from queue, workq_mutex has to be held
+ */
+static bool workq_remove(struct k_work * work)
+{
+    struct k_work_q * queue = work->queue;
+    struct k_work * prev = NULL;
+
+    if (!(work->flags & K_WORK_QUEUED)) {
+        return false;
+    }
+    for (struct k_work * it = queue->head; it; prev = it, it = it->next)
+    {
+        if (it == work) {
+            if (prev) {
+                prev->next = it->next;
+            }
+            else {
+                queue->head = it->next;
+            }
+            if (queue->tail == it) {
+                queue->tail = prev;
+            }
+            break;
+        }
+    }
+    work->flags &= ~K_WORK_QUEUED;
+    pthread_cond_broadcast(&workq_idle_cond);
+    return true;
+}
+
+
+/*!
+ * @brief               Removes work from delayed list, workq_mutex has to 
+ *                      be held
+ */
+static bool workq_remove_delayed(struct k_work_delayable * dwork)
+{
+    struct k_work_q * queue = dwork->work.queue;
+
+    if (!(dwork->work.flags & K_WORK_DELAYED)) {
+        return false;
+    }
+    for (struct k_work_delayable ** link = &queue->delayed; *link; 
+         link = &(*link)->next)
+    {
+        if (*link == dwork) {
+            *link = dwork->next;
+            break;
+        }
+    }
+    dwork->work.flags &= ~K_WORK_DELAYED;
+    return true;
+}
+
+/*** end of file ***/
@@ -0,0 +1,32 @@
+/** @file posix_kernel.h
+ *
+ * @brief       Helpers of the POSIX kernel shim that are used by simulated
+ *              devices, but are not part of Zephyr API.
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 Irnas.  All rights reserved.
+ */
+
+#ifndef POSIX_KERNEL_H
+#define POSIX_KERNEL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+
+uint64_t posix_now_us(void);
+void posix_abs_time(struct timespec * ts, uint64_t at_us);
+void posix_cond_init(pthread_cond_t * cond);
+void posix_isr_enter(void);
+void posix_isr_exit(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* POSIX_KERNEL_H */
+/*** end of file ***/
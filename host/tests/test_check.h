@@ -0,0 +1,52 @@
+/** @file test_check.h
+ *
+ * @brief       Checks of host tests run by CTest. Failed check is reported
+ *              with its location and counted, test exits with non-zero 
+ *              code if any of its checks failed.
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 Irnas.  All rights reserved.
+ */
+
+#ifndef TEST_CHECK_H
+#define TEST_CHECK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <zephyr.h>
+
+static int test_failures;
+
+#define TEST_CHECK(cond)                                                    \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            printk("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            test_failures++;                                                \
+        }                                                                   \
+    } while (0)
+
+/* Checks value is within [min, max], values are printed on failure */
+#define TEST_CHECK_RANGE(value, min, max)                                   \
+    do {                                                                    \
+        long long _v = (long long) (value);                                 \
+        if (_v < (long long) (min) || _v > (long long) (max)) {             \
+            printk("%s:%d: check failed: %s = %lld, not in [%lld, %lld]\n", \
+                   __FILE__, __LINE__, #value, _v,                          \
+                   (long long) (min), (long long) (max));                   \
+            test_failures++;                                                \
+        }                                                                   \
+    } while (0)
+
+/* Exit code of the test */
+#define TEST_RESULT()                                                       \
+    (printk("%s: %d checks failed\n", __FILE__, test_failures),             \
+     test_failures ? 1 : 0)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TEST_CHECK_H */
+/*** end of file ***/
@@ -0,0 +1,202 @@
+/** @file test_multi_instance.c
+ *
+ * @brief Two radio instances test, run by CTest. Each radio is attached
+ *        to its own simulated chip with its own scripted APs and LoRa
+ *        packets, and is driven from its own thread, so wifi scans and
+ *        LoRa receptions of both radios interleave. Radios have to get
+ *        only their own results, SPI traffic of each radio has to reach
+ *        only its own chip and scans have to run in parallel.
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 Irnas.  All rights reserved.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <pthread.h>
+#include <zephyr.h>
+#include "lr1110.h"
+#include "lr1110_sim.h"
+#include "test_check.h"
+
+#define RADIOS          2
+#define ITERATIONS      4
+
+struct radio {
+    uint8_t instance;
+    lr1110_t lr1110;
+    struct lr1110_lora lora;
+    const struct lr1110_sim_ap * aps;
+    uint8_t nb_aps;
+    const uint8_t * payload;
+    uint8_t payload_length;
+
+    /* Filled in by radio thread */
+    uint32_t scan_start[ITERATIONS];
+    uint32_t scan_end[ITERATIONS];
+    uint8_t nb_results[ITERATIONS];
+    uint32_t foreign_results;       /* Results not scripted for radio */
+    uint32_t packets;
+    uint32_t foreign_packets;       /* Packets not scripted for radio */
+};
+
+static const struct lr1110_sim_ap aps_0[] = {
+    { { 0xa0, 0x00, 0x00, 0x00, 0x00, 0x01 }, -48, 1, 3, "radio0-a" },
+    { { 0xa0, 0x00, 0x00, 0x00, 0x00, 0x02 }, -63, 6, 3, "radio0-b" },
+    { { 0xa0, 0x00, 0x00, 0x00, 0x00, 0x03 }, -77, 11, 2, "radio0-c" },
+};
+
+static const struct lr1110_sim_ap aps_1[] = {
+    { { 0xb1, 0x00, 0x00, 0x00, 0x00, 0x01 }, -50, 2, 3, "radio1-a" },
+    { { 0xb1, 0x00, 0x00, 0x00, 0x00, 0x02 }, -55, 4, 3, "radio1-b" },
+    { { 0xb1, 0x00, 0x00, 0x00, 0x00, 0x03 }, -70, 9, 1, "radio1-c" },
+    { { 0xb1, 0x00, 0x00, 0x00, 0x00, 0x04 }, -81, 13, 2, "radio1-d" },
+    { { 0xb1, 0x00, 0x00, 0x00, 0x00, 0x05 }, -90, 14, 1, "radio1-e" },
+};
+
+static const uint8_t payload_0[] = "radio zero";
+static const uint8_t payload_1[] = { 0x01, 0x17, 0x42, 0x99 };
+
+static struct radio radios[RADIOS] = {
+    { .instance = 0, .aps = aps_0, .nb_aps = ARRAY_SIZE(aps_0),
+      .payload = payload_0, .payload_length = sizeof(payload_0) },
+    { .instance = 1, .aps = aps_1, .nb_aps = ARRAY_SIZE(aps_1),
+      .payload = payload_1, .payload_length = sizeof(payload_1) },
+};
+
+static bool is_own_ap(const struct radio * radio, const uint8_t * mac)
+{
+    for (uint8_t i = 0; i < radio->nb_aps; i++)
+    {
+        if (!memcmp(radio->aps[i].mac, mac, LR1110_WIFI_MAC_ADDRESS_LENGTH)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Alternates wifi scans and LoRa reception on one radio */
+static void * radio_thread(void * arg)
+{
+    struct radio * radio = arg;
+    struct wifi_settings wifi_settings = lr1110_get_default_wifi_settings();
+    lr1110_wifi_extended_full_result_t results[LR1110_WIFI_MAX_RESULTS];
+
+    wifi_settings.nb_scan_per_channel = 10;
+
+    for (int i = 0; i < ITERATIONS; i++)
+    {
+        radio->scan_start[i] = k_cycle_get_32();
+
+        struct wifi_diagnostics wifi_diagnostics =
+            lr1110_execute_wifi_scan(&radio->lr1110, wifi_settings);
+
+        radio->scan_end[i] = k_cycle_get_32();
+        radio->nb_results[i] = wifi_diagnostics.num_wifi_results;
+
+        lr1110_get_ext_wifi_scan_results(&radio->lr1110, wifi_diagnostics,
+                                         results);
+        for (uint8_t j = 0; j < wifi_diagnostics.num_wifi_results; j++)
+        {
+            if (!is_own_ap(radio, results[j].mac_address_3)) {
+                radio->foreign_results++;
+            }
+        }
+
+        struct lr1110_lora_packet packet;
+
+        lr1110_lora_receive_start(&radio->lora, NULL, NULL);
+        if (!lr1110_lora_read(&radio->lora, &packet, K_MSEC(200))) {
+            radio->packets++;
+            if (packet.length != radio->payload_length ||
+                memcmp(packet.data, radio->payload, packet.length)) {
+                radio->foreign_packets++;
+            }
+        }
+        lr1110_lora_receive_stop(&radio->lora);
+    }
+    return NULL;
+}
+
+int main(void)
+{
+    pthread_t threads[RADIOS];
+    bool overlap = false;
+
+    for (int r = 0; r < RADIOS; r++)
+    {
+        struct radio * radio = &radios[r];
+        const struct lr1110_sim_lora_packet packet = {
+            radio->payload, radio->payload_length, -60 - 10 * r, 5, false
+        };
+
+        TEST_CHECK(!lr1110_sim_init(radio->instance, NULL));
+        TEST_CHECK(!lr1110_sim_add_wifi_scan(radio->instance, radio->aps,
+                                             radio->nb_aps));
+        TEST_CHECK(!lr1110_sim_add_lora_packet(radio->instance, &packet));
+        TEST_CHECK(!lr1110_sim_attach(radio->instance, &radio->lr1110));
+    }
+    TEST_CHECK(lr1110_sim_init(LR1110_SIM_INSTANCES, NULL) == -EINVAL);
+
+    /* Devices of instances are distinct */
+    TEST_CHECK(radios[0].lr1110.spi_dev != radios[1].lr1110.spi_dev);
+    TEST_CHECK(radios[0].lr1110.busy.port != radios[1].lr1110.busy.port);
+
+    for (int r = 0; r < RADIOS; r++)
+    {
+        struct radio * radio = &radios[r];
+
+        TEST_CHECK(lr1110_init(&radio->lr1110).errors == 0);
+        lr1110_init_wifi_scan(&radio->lr1110);
+        TEST_CHECK(!lr1110_lora_init(&radio->lr1110, &radio->lora,
+                                     lr1110_get_default_lora_settings()));
+        lr1110_sim_reset_stats(radio->instance);
+        lr1110_hal_reset_stats(&radio->lr1110);
+    }
+
+    for (int r = 0; r < RADIOS; r++) {
+        pthread_create(&threads[r], NULL, radio_thread, &radios[r]);
+    }
+    for (int r = 0; r < RADIOS; r++) {
+        pthread_join(threads[r], NULL);
+    }
+
+    for (int r = 0; r < RADIOS; r++)
+    {
+        struct radio * radio = &radios[r];
+        struct lr1110_sim_stats sim_stats;
+        struct lr1110_hal_stats hal_stats;
+
+        for (int i = 0; i < ITERATIONS; i++) {
+            TEST_CHECK(radio->nb_results[i] == radio->nb_aps);
+        }
+        TEST_CHECK(radio->foreign_results == 0);
+        TEST_CHECK(radio->packets == ITERATIONS);
+        TEST_CHECK(radio->foreign_packets == 0);
+
+        /* Every transaction of the radio reached its own chip only */
+        lr1110_sim_get_stats(radio->instance, &sim_stats);
+        lr1110_hal_get_stats(&radio->lr1110, &hal_stats);
+        TEST_CHECK(sim_stats.wifi_scans == ITERATIONS);
+        TEST_CHECK(sim_stats.unknown_commands == 0);
+        TEST_CHECK(sim_stats.corrupted_frames == 0);
+        TEST_CHECK(sim_stats.bytes == hal_stats.spi_bytes);
+    }
+
+    /* Radios do not serialize each other */
+    for (int i = 0; i < ITERATIONS; i++)
+    {
+        for (int j = 0; j < ITERATIONS; j++)
+        {
+            if (radios[0].scan_start[i] < radios[1].scan_end[j] &&
+                radios[1].scan_start[j] < radios[0].scan_end[i]) {
+                overlap = true;
+            }
+        }
+    }
+    TEST_CHECK(overlap);
+
+    return TEST_RESULT();
+}
+
+/*** end of file ***/
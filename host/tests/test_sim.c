@@ -0,0 +1,335 @@
+/** @file test_sim.c
+ *
+ * @brief Simulator and HAL test, run by CTest. Radio is initialized
+ *        against simulated chip, scans have to return scripted access
+ *        points, BUSY and event line have to follow modelled timing and
+ *        scan and wakeup durations have to stay within bounds. Radio
+ *        handlers waiting for the radio must not stall system work
+ *        queue. Warm start is used only when chip was not reset during
+ *        sleep.
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 Irnas.  All rights reserved.
+ */
+
+#include <string.h>
+#include <zephyr.h>
+#include <drivers/gpio.h>
+#include "lr1110.h"
+#include "lr1110_sim.h"
+#include "test_check.h"
+
+/* Slack for host scheduling, timing bounds are loose so CI does not flake */
+#define TIMING_SLACK_US     200000
+
+static lr1110_t lr1110;
+static struct lr1110_wifi_scan_async scan_async;
+static struct k_sem scan_sem;
+static struct k_sem sys_work_sem;
+static int scan_status;
+static uint8_t scan_results;
+
+static const struct lr1110_sim_ap office[] = {
+    { { 0x00, 0x11, 0x22, 0x33, 0x44, 0x01 }, -48, 1, 3, "office" },
+    { { 0x00, 0x11, 0x22, 0x33, 0x44, 0x02 }, -63, 6, 3, "office-guest" },
+    { { 0x00, 0x11, 0x22, 0x33, 0x44, 0x03 }, -77, 11, 2, "printer" },
+    { { 0x00, 0x11, 0x22, 0x33, 0x44, 0x04 }, -85, 3, 1, "lab" },
+};
+
+static int pin_get(port_pin_t line)
+{
+    return gpio_pin_get(line.port, line.pin);
+}
+
+/* Polls line until it has given level, returns time it took or -1 */
+static int32_t wait_pin(port_pin_t line, int level, uint32_t timeout_us)
+{
+    uint32_t start = k_cycle_get_32();
+
+    while (pin_get(line) != level)
+    {
+        if (k_cycle_get_32() - start > timeout_us) {
+            return -1;
+        }
+        k_usleep(50);
+    }
+    return k_cyc_to_us_floor32(k_cycle_get_32() - start);
+}
+
+static const struct lr1110_sim_ap * find_ap(const uint8_t * mac)
+{
+    for (int i = 0; i < ARRAY_SIZE(office); i++)
+    {
+        if (!memcmp(office[i].mac, mac, LR1110_WIFI_MAC_ADDRESS_LENGTH)) {
+            return &office[i];
+        }
+    }
+    return NULL;
+}
+
+static void scan_done(void * context, int status,
+                      struct wifi_diagnostics wifi_diagnostics,
+                      void * user_data)
+{
+    scan_status = status;
+    scan_results = wifi_diagnostics.num_wifi_results;
+    k_sem_give(&scan_sem);
+}
+
+static void sys_work_handler(struct k_work * work)
+{
+    k_sem_give(&sys_work_sem);
+}
+
+static void test_init(const struct lr1110_sim_config * config)
+{
+    struct lr1110_init_diagnostics init_diagnostics = lr1110_init(&lr1110);
+    lr1110_system_version_t version;
+
+    TEST_CHECK(init_diagnostics.errors == 0);
+    TEST_CHECK(!init_diagnostics.warm_start);
+    /* Reset is released only once chip booted */
+    TEST_CHECK_RANGE(init_diagnostics.init_duration_us, config->boot_us,
+                     config->boot_us + config->calibrate_us +
+                     TIMING_SLACK_US);
+
+    lr1110_get_trx_version(&lr1110, &version);
+    TEST_CHECK(version.hw == LR1110_SIM_VERSION_HW);
+    TEST_CHECK(version.type == LR1110_SIM_VERSION_TYPE);
+    TEST_CHECK(version.fw == LR1110_SIM_VERSION_FW);
+}
+
+static void test_wifi_scan(const struct lr1110_sim_config * config)
+{
+    struct wifi_settings wifi_settings = lr1110_get_default_wifi_settings();
+    lr1110_wifi_extended_full_result_t results[LR1110_WIFI_MAX_RESULTS];
+    uint32_t scan_ms;
+
+    lr1110_sim_clear_wifi_scans(0);
+    lr1110_sim_add_wifi_scan(0, office, ARRAY_SIZE(office));
+    lr1110_sim_add_wifi_scan(0, office, ARRAY_SIZE(office));
+    lr1110_sim_add_wifi_scan(0, NULL, 0);
+    lr1110_init_wifi_scan(&lr1110);
+
+    /* All scripted APs, each with its RSSI, channel and SSID */
+    struct wifi_diagnostics wifi_diagnostics =
+        lr1110_execute_wifi_scan(&lr1110, wifi_settings);
+
+    TEST_CHECK(wifi_diagnostics.num_wifi_results == ARRAY_SIZE(office));
+    memset(results, 0, sizeof(results));
+    lr1110_get_ext_wifi_scan_results(&lr1110, wifi_diagnostics, results);
+    for (int i = 0; i < wifi_diagnostics.num_wifi_results; i++)
+    {
+        const struct lr1110_sim_ap * ap = find_ap(results[i].mac_address_3);
+
+        TEST_CHECK(ap != NULL);
+        if (ap) {
+            TEST_CHECK(results[i].rssi == ap->rssi);
+            TEST_CHECK(results[i].current_channel == ap->channel);
+            TEST_CHECK(!strncmp((const char *) results[i].ssid_bytes,
+                                ap->ssid,
+                                LR1110_WIFI_RESULT_SSID_LENGTH));
+        }
+    }
+
+    /* BUSY stays high for the whole modelled scan */
+    scan_ms = 14 * wifi_settings.nb_scan_per_channel *
+              config->wifi_scan_us / 1000;
+    TEST_CHECK_RANGE(wifi_diagnostics.wifi_scan_duration, scan_ms,
+                     scan_ms + TIMING_SLACK_US / 1000);
+
+    /* Only APs on scanned channels are reported */
+    wifi_settings.channels = BIT(LR1110_WIFI_CHANNEL_1 - 1) |
+                             BIT(LR1110_WIFI_CHANNEL_6 - 1);
+    wifi_settings.nb_scan_per_channel = 10;
+    wifi_diagnostics = lr1110_execute_wifi_scan(&lr1110, wifi_settings);
+    TEST_CHECK(wifi_diagnostics.num_wifi_results == 2);
+    scan_ms = 2 * wifi_settings.nb_scan_per_channel *
+              config->wifi_scan_us / 1000;
+    TEST_CHECK_RANGE(wifi_diagnostics.wifi_scan_duration, scan_ms,
+                     scan_ms + TIMING_SLACK_US / 1000);
+
+    /* Empty scripted scan */
+    wifi_diagnostics = lr1110_execute_wifi_scan(&lr1110, wifi_settings);
+    TEST_CHECK(wifi_diagnostics.num_wifi_results == 0);
+}
+
+static void test_busy(const struct lr1110_sim_config * config)
+{
+    lr1110_system_version_t version;
+    lr1110_system_sleep_cfg_t sleep_cfg = { .is_warm_start = true };
+    struct lr1110_power_stats power_stats;
+
+    lr1110_lock(&lr1110, K_FOREVER);
+
+    /* Second command waits until BUSY of the first one is released */
+    uint32_t start = k_cycle_get_32();
+
+    TEST_CHECK(!lr1110_system_set_standby(&lr1110,
+                                          LR1110_SYSTEM_STANDBY_CFG_RC));
+    TEST_CHECK(pin_get(lr1110.busy) == 1);
+    TEST_CHECK(!lr1110_system_get_version(&lr1110, &version));
+    TEST_CHECK_RANGE(k_cyc_to_us_floor32(k_cycle_get_32() - start),
+                     config->cmd_us, config->cmd_us + TIMING_SLACK_US);
+    TEST_CHECK_RANGE(wait_pin(lr1110.busy, 0, TIMING_SLACK_US),
+                     0, config->cmd_us + TIMING_SLACK_US);
+
+    /* Sleeping chip keeps BUSY high until it is woken up */
+    TEST_CHECK(!lr1110_system_set_sleep(&lr1110, sleep_cfg, 0));
+    k_usleep(2 * config->cmd_us);
+    TEST_CHECK(pin_get(lr1110.busy) == 1);
+    TEST_CHECK(lr1110_power_get_state(&lr1110) == LR1110_POWER_SLEEP);
+
+    TEST_CHECK(lr1110_hal_wakeup(&lr1110) == LR1110_HAL_STATUS_OK);
+    TEST_CHECK(pin_get(lr1110.busy) == 0);
+    lr1110_power_get_stats(&lr1110, &power_stats);
+    TEST_CHECK(power_stats.wakeups == 1);
+    TEST_CHECK_RANGE(power_stats.wakeup_us_last, config->wakeup_us,
+                     config->wakeup_us + TIMING_SLACK_US);
+
+    lr1110_unlock(&lr1110);
+}
+
+static void test_irq(const struct lr1110_sim_config * config)
+{
+    const uint8_t nb_scan = 10;
+    const uint32_t scan_us = nb_scan * config->wifi_scan_us;
+    lr1110_system_irq_mask_t irq_status = 0;
+
+    lr1110_sim_clear_wifi_scans(0);
+    lr1110_sim_add_wifi_scan(0, office, ARRAY_SIZE(office));
+    lr1110_lock(&lr1110, K_FOREVER);
+
+    /* Routed IRQ raises event line once scan is over */
+    TEST_CHECK(!lr1110_system_set_dio_irq_params(
+        &lr1110, LR1110_SYSTEM_IRQ_WIFI_SCAN_DONE, 0));
+    TEST_CHECK(!lr1110_system_clear_irq_status(&lr1110,
+                                               LR1110_SYSTEM_IRQ_ALL_MASK));
+    TEST_CHECK(pin_get(lr1110.event) == 0);
+
+    TEST_CHECK(!lr1110_wifi_scan(&lr1110, LR1110_WIFI_TYPE_SCAN_B_G_N,
+                                 BIT(LR1110_WIFI_CHANNEL_1 - 1),
+                                 LR1110_WIFI_SCAN_MODE_BEACON,
+                                 LR1110_WIFI_MAX_RESULTS, nb_scan,
+                                 0, false));
+    TEST_CHECK(pin_get(lr1110.busy) == 1);
+    TEST_CHECK_RANGE(wait_pin(lr1110.event, 1, scan_us + TIMING_SLACK_US),
+                     scan_us / 2, scan_us + TIMING_SLACK_US);
+
+    TEST_CHECK(!lr1110_system_get_irq_status(&lr1110, &irq_status));
+    TEST_CHECK(irq_status & LR1110_SYSTEM_IRQ_WIFI_SCAN_DONE);
+
+    /* Clearing IRQ releases event line */
+    TEST_CHECK(!lr1110_system_clear_irq_status(
+        &lr1110, LR1110_SYSTEM_IRQ_WIFI_SCAN_DONE));
+    TEST_CHECK(pin_get(lr1110.event) == 0);
+
+    /* IRQ that is not routed is only set in IRQ status */
+    TEST_CHECK(!lr1110_system_set_dio_irq_params(&lr1110, 0, 0));
+    TEST_CHECK(!lr1110_wifi_scan(&lr1110, LR1110_WIFI_TYPE_SCAN_B_G_N,
+                                 BIT(LR1110_WIFI_CHANNEL_1 - 1),
+                                 LR1110_WIFI_SCAN_MODE_BEACON,
+                                 LR1110_WIFI_MAX_RESULTS, nb_scan,
+                                 0, false));
+    TEST_CHECK(wait_pin(lr1110.busy, 0, scan_us + TIMING_SLACK_US) >= 0);
+    TEST_CHECK(pin_get(lr1110.event) == 0);
+    TEST_CHECK(!lr1110_system_get_irq_status(&lr1110, &irq_status));
+    TEST_CHECK(irq_status & LR1110_SYSTEM_IRQ_WIFI_SCAN_DONE);
+    TEST_CHECK(!lr1110_system_clear_irq_status(&lr1110,
+                                               LR1110_SYSTEM_IRQ_ALL_MASK));
+
+    lr1110_unlock(&lr1110);
+}
+
+static void test_work_queue(const struct lr1110_sim_config * config)
+{
+    struct wifi_settings wifi_settings = lr1110_get_default_wifi_settings();
+    struct k_work sys_work;
+    uint32_t scan_us;
+
+    k_sem_init(&scan_sem, 0, 1);
+    k_sem_init(&sys_work_sem, 0, 1);
+    k_work_init(&sys_work, sys_work_handler);
+    lr1110_sim_clear_wifi_scans(0);
+    lr1110_sim_add_wifi_scan(0, office, ARRAY_SIZE(office));
+
+    wifi_settings.channels = BIT(LR1110_WIFI_CHANNEL_1 - 1);
+    wifi_settings.nb_scan_per_channel = 10;
+    scan_us = wifi_settings.nb_scan_per_channel * config->wifi_scan_us;
+    TEST_CHECK(!lr1110_start_wifi_scan(&lr1110, wifi_settings, &scan_async,
+                                       scan_done, NULL));
+
+    /* Scan is done while radio is held, its handlers have to wait */
+    lr1110_lock(&lr1110, K_FOREVER);
+    TEST_CHECK(wait_pin(lr1110.event, 1, scan_us + TIMING_SLACK_US) >= 0);
+    k_work_submit(&sys_work);
+    TEST_CHECK(!k_sem_take(&sys_work_sem, K_MSEC(100)));
+    TEST_CHECK(k_sem_take(&scan_sem, K_NO_WAIT) != 0);
+    lr1110_unlock(&lr1110);
+
+    TEST_CHECK(!k_sem_take(&scan_sem, K_MSEC(1000)));
+    TEST_CHECK(scan_status == 0);
+    TEST_CHECK(scan_results == 1);
+}
+
+static void test_warm_init(void)
+{
+    lr1110_system_sleep_cfg_t sleep_cfg = { .is_warm_start = true };
+    struct lr1110_init_diagnostics init_diagnostics;
+    struct lr1110_sim_stats stats;
+
+    /* Chip kept its state through sleep */
+    lr1110_lock(&lr1110, K_FOREVER);
+    TEST_CHECK(!lr1110_system_set_sleep(&lr1110, sleep_cfg, 0));
+    lr1110_unlock(&lr1110);
+    lr1110_sim_get_stats(0, &stats);
+    uint32_t resets = stats.resets;
+
+    init_diagnostics = lr1110_warm_init(&lr1110);
+    TEST_CHECK(init_diagnostics.warm_start);
+    TEST_CHECK(init_diagnostics.errors == 0);
+    lr1110_sim_get_stats(0, &stats);
+    TEST_CHECK(stats.resets == resets);
+
+    /* Chip that was reset while host slept responds, but lost its state */
+    lr1110_lock(&lr1110, K_FOREVER);
+    TEST_CHECK(!lr1110_system_set_sleep(&lr1110, sleep_cfg, 0));
+    TEST_CHECK(lr1110_hal_reset(&lr1110) == LR1110_HAL_STATUS_OK);
+    lr1110_unlock(&lr1110);
+
+    init_diagnostics = lr1110_warm_init(&lr1110);
+    TEST_CHECK(!init_diagnostics.warm_start);
+    TEST_CHECK(init_diagnostics.errors == 0);
+    lr1110_sim_get_stats(0, &stats);
+    TEST_CHECK(stats.resets == resets + 2);
+
+    /* Chip that was not put to sleep after cold start is not trusted */
+    TEST_CHECK(!lr1110_warm_init(&lr1110).warm_start);
+}
+
+int main(void)
+{
+    struct lr1110_sim_config config = lr1110_sim_default_config();
+    struct lr1110_sim_stats stats;
+
+    /* Commands long enough to see BUSY from host */
+    config.cmd_us = 2000;
+
+    lr1110_sim_init(0, &config);
+    lr1110_sim_attach(0, &lr1110);
+
+    test_init(&config);
+    test_wifi_scan(&config);
+    test_busy(&config);
+    test_irq(&config);
+    test_work_queue(&config);
+    test_warm_init();
+
+    lr1110_sim_get_stats(0, &stats);
+    TEST_CHECK(stats.unknown_commands == 0);
+    TEST_CHECK(stats.corrupted_frames == 0);
+
+    return TEST_RESULT();
+}
+
+/*** end of file ***/
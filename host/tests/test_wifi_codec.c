@@ -0,0 +1,237 @@
+/** @file test_wifi_codec.c
+ *
+ * @brief Wifi result codec test, run by CTest. Basic and extended results
+ *        have to survive encode and decode, header has to hold version
+ *        and number of APs, only strongest APs are kept by top-N limit
+ *        and truncation to buffer size, malformed messages are rejected.
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 Irnas.  All rights reserved.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr.h>
+#include "lr1110_wifi_codec.h"
+#include "test_check.h"
+
+#define NB_APS      6
+#define GUARD       0xA5
+
+/* Unsorted by RSSI, RSSI of each AP is unique */
+static const struct lr1110_wifi_ap aps[NB_APS] = {
+    { { 0x00, 0x11, 0x22, 0x33, 0x44, 0x01 }, -63, 6, 3 },
+    { { 0x00, 0x11, 0x22, 0x33, 0x44, 0x02 }, -48, 1, 3 },
+    { { 0xfe, 0xdc, 0xba, 0x98, 0x76, 0x54 }, -91, 14, 1 },
+    { { 0x02, 0x00, 0x00, 0x00, 0x00, 0xff }, -77, 11, 2 },
+    { { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff }, -127, 13, 0 },
+    { { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, -30, 0, 1 },
+};
+
+/* Indexes of aps, strongest first */
+static const uint8_t by_rssi[NB_APS] = { 5, 1, 0, 3, 2, 4 };
+
+static bool ap_equal(const struct lr1110_wifi_ap * a,
+                     const struct lr1110_wifi_ap * b)
+{
+    return !memcmp(a->mac, b->mac, LR1110_WIFI_MAC_ADDRESS_LENGTH) &&
+           a->rssi == b->rssi &&
+           a->channel == b->channel &&
+           a->signal_type == b->signal_type;
+}
+
+/* Decoded APs have to be the strongest count of aps, in RSSI order */
+static void check_strongest(const struct lr1110_wifi_ap * decoded,
+                            int count)
+{
+    for (int i = 0; i < count; i++) {
+        TEST_CHECK(ap_equal(&decoded[i], &aps[by_rssi[i]]));
+    }
+}
+
+static void test_header(void)
+{
+    uint8_t buf[LR1110_WIFI_CODEC_SIZE(NB_APS) + 1];
+    struct lr1110_wifi_ap decoded[NB_APS];
+
+    TEST_CHECK(LR1110_WIFI_CODEC_SIZE(0) == 1);
+    TEST_CHECK(LR1110_WIFI_CODEC_SIZE(1) == 9);
+    TEST_CHECK(LR1110_WIFI_CODEC_SIZE(NB_APS) == 1 + (NB_APS * 61 + 7) / 8);
+
+    memset(buf, GUARD, sizeof(buf));
+    int len = lr1110_wifi_encode(aps, NB_APS, 0, false, buf, sizeof(buf));
+
+    TEST_CHECK(len == LR1110_WIFI_CODEC_SIZE(NB_APS));
+    TEST_CHECK((buf[0] >> 6) == LR1110_WIFI_CODEC_VERSION);
+    TEST_CHECK((buf[0] & 0x3F) == NB_APS);
+    /* Padding of last byte is zero, nothing is written past message */
+    TEST_CHECK((buf[len - 1] & ((1 << (8 * (len - 1) - NB_APS * 61)) - 1))
+               == 0);
+    TEST_CHECK(buf[len] == GUARD);
+
+    /* No APs is header only */
+    len = lr1110_wifi_encode(aps, 0, 0, false, buf, sizeof(buf));
+    TEST_CHECK(len == 1);
+    TEST_CHECK(buf[0] == (LR1110_WIFI_CODEC_VERSION << 6));
+    TEST_CHECK(lr1110_wifi_decode(buf, len, decoded, NB_APS) == 0);
+}
+
+static void test_round_trip(void)
+{
+    uint8_t buf[LR1110_WIFI_CODEC_SIZE(NB_APS)];
+    struct lr1110_wifi_ap decoded[NB_APS];
+    int len;
+
+    len = lr1110_wifi_encode(aps, NB_APS, 0, false, buf, sizeof(buf));
+    TEST_CHECK(len == sizeof(buf));
+    TEST_CHECK(lr1110_wifi_decode(buf, len, decoded, NB_APS) == NB_APS);
+    check_strongest(decoded, NB_APS);
+
+    /* RSSI is clamped to what 7 bits hold */
+    struct lr1110_wifi_ap clamped[2] = { aps[0], aps[1] };
+
+    clamped[0].rssi = 5;
+    clamped[1].rssi = -128;
+    len = lr1110_wifi_encode(clamped, 2, 0, false, buf, sizeof(buf));
+    TEST_CHECK(lr1110_wifi_decode(buf, len, decoded, NB_APS) == 2);
+    TEST_CHECK(decoded[0].rssi == 0);
+    TEST_CHECK(decoded[1].rssi == -127);
+}
+
+static void test_round_trip_basic(void)
+{
+    lr1110_wifi_basic_complete_result_t results[NB_APS];
+    uint8_t buf[LR1110_WIFI_CODEC_SIZE(NB_APS)];
+    struct lr1110_wifi_ap decoded[NB_APS];
+
+    memset(results, 0, sizeof(results));
+    for (int i = 0; i < NB_APS; i++)
+    {
+        memcpy(results[i].mac_address, aps[i].mac,
+               LR1110_WIFI_MAC_ADDRESS_LENGTH);
+        results[i].rssi = aps[i].rssi;
+        /* Bits above channel and signal type are not encoded */
+        results[i].channel_info_byte = 0xF0 | aps[i].channel;
+        results[i].data_rate_info_byte = 0xFC | aps[i].signal_type;
+        results[i].beacon_period_tu = 100;
+    }
+
+    int len = lr1110_wifi_encode_basic(results, NB_APS, 0, false,
+                                       buf, sizeof(buf));
+
+    TEST_CHECK(len == sizeof(buf));
+    TEST_CHECK(lr1110_wifi_decode(buf, len, decoded, NB_APS) == NB_APS);
+    check_strongest(decoded, NB_APS);
+}
+
+static void test_round_trip_ext(void)
+{
+    lr1110_wifi_extended_full_result_t results[NB_APS];
+    uint8_t buf[LR1110_WIFI_CODEC_SIZE(NB_APS)];
+    struct lr1110_wifi_ap decoded[NB_APS];
+
+    memset(results, 0, sizeof(results));
+    for (int i = 0; i < NB_APS; i++)
+    {
+        /* BSSID is address 3, others are not encoded */
+        memset(results[i].mac_address_1, 0xFF,
+               LR1110_WIFI_MAC_ADDRESS_LENGTH);
+        memset(results[i].mac_address_2, 0xEE,
+               LR1110_WIFI_MAC_ADDRESS_LENGTH);
+        memcpy(results[i].mac_address_3, aps[i].mac,
+               LR1110_WIFI_MAC_ADDRESS_LENGTH);
+        results[i].rssi = aps[i].rssi;
+        results[i].channel_info_byte = 0xF0 | aps[i].channel;
+        results[i].data_rate_info_byte = 0xFC | aps[i].signal_type;
+    }
+
+    int len = lr1110_wifi_encode_ext(results, NB_APS, 0, false,
+                                     buf, sizeof(buf));
+
+    TEST_CHECK(len == sizeof(buf));
+    TEST_CHECK(lr1110_wifi_decode(buf, len, decoded, NB_APS) == NB_APS);
+    check_strongest(decoded, NB_APS);
+}
+
+static void test_top_n(void)
+{
+    uint8_t buf[LR1110_WIFI_CODEC_SIZE(NB_APS)];
+    struct lr1110_wifi_ap decoded[NB_APS];
+
+    for (int max_aps = 1; max_aps <= NB_APS + 1; max_aps++)
+    {
+        int count = MIN(max_aps, NB_APS);
+        int len = lr1110_wifi_encode(aps, NB_APS, max_aps, false,
+                                     buf, sizeof(buf));
+
+        TEST_CHECK(len == LR1110_WIFI_CODEC_SIZE(count));
+        TEST_CHECK((buf[0] & 0x3F) == count);
+        TEST_CHECK(lr1110_wifi_decode(buf, len, decoded, NB_APS) == count);
+        check_strongest(decoded, count);
+    }
+}
+
+static void test_truncate(void)
+{
+    uint8_t buf[LR1110_WIFI_CODEC_SIZE(NB_APS)];
+    struct lr1110_wifi_ap decoded[NB_APS];
+    int len;
+
+    /* One byte short of 4 APs fits 3 of them */
+    size_t size = LR1110_WIFI_CODEC_SIZE(4) - 1;
+
+    memset(buf, GUARD, sizeof(buf));
+    len = lr1110_wifi_encode(aps, NB_APS, 0, true, buf, size);
+    TEST_CHECK(len == LR1110_WIFI_CODEC_SIZE(3));
+    TEST_CHECK(buf[size] == GUARD);
+    TEST_CHECK(lr1110_wifi_decode(buf, len, decoded, NB_APS) == 3);
+    check_strongest(decoded, 3);
+
+    /* Top-N limit is applied before truncation */
+    len = lr1110_wifi_encode(aps, NB_APS, 2, true, buf, size);
+    TEST_CHECK(len == LR1110_WIFI_CODEC_SIZE(2));
+
+    /* Header only, when no AP fits */
+    len = lr1110_wifi_encode(aps, NB_APS, 0, true, buf,
+                             LR1110_WIFI_CODEC_SIZE(1) - 1);
+    TEST_CHECK(len == LR1110_WIFI_CODEC_SIZE(0));
+    TEST_CHECK((buf[0] & 0x3F) == 0);
+
+    /* Without truncation too small buffer fails */
+    memset(buf, GUARD, sizeof(buf));
+    TEST_CHECK(lr1110_wifi_encode(aps, NB_APS, 0, false, buf, size) ==
+               -ENOMEM);
+    TEST_CHECK(buf[0] == GUARD);
+    TEST_CHECK(lr1110_wifi_encode(aps, NB_APS, 0, true, buf, 0) == -ENOMEM);
+}
+
+static void test_decode_errors(void)
+{
+    uint8_t buf[LR1110_WIFI_CODEC_SIZE(NB_APS)];
+    struct lr1110_wifi_ap decoded[NB_APS];
+    int len = lr1110_wifi_encode(aps, NB_APS, 0, false, buf, sizeof(buf));
+
+    TEST_CHECK(lr1110_wifi_decode(buf, 0, decoded, NB_APS) == -EINVAL);
+    /* Message shorter than its AP count */
+    TEST_CHECK(lr1110_wifi_decode(buf, len - 1, decoded, NB_APS) == -EINVAL);
+    TEST_CHECK(lr1110_wifi_decode(buf, len, decoded, NB_APS - 1) == -ENOMEM);
+
+    /* Unknown version */
+    buf[0] |= 0xC0;
+    TEST_CHECK(lr1110_wifi_decode(buf, len, decoded, NB_APS) == -EINVAL);
+}
+
+int main(void)
+{
+    test_header();
+    test_round_trip();
+    test_round_trip_basic();
+    test_round_trip_ext();
+    test_top_n();
+    test_truncate();
+    test_decode_errors();
+
+    return TEST_RESULT();
+}
+
+/*** end of file ***/
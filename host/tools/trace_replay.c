@@ -0,0 +1,204 @@
+/** @file trace_replay.c
+ *
+ * @brief Replays HAL trace dumped by lr1110_hal_trace_dump against
+ *        simulated LR1110 and reports timing of each command next to
+ *        recorded one, as CSV.
+ *
+ *        trace_replay [-g] [dump file]
+ *
+ *        Dump is read from stdin when file is not given. Lines that are not
+ *        trace records, like other console output, are skipped. With -g,
+ *        recorded gaps between calls are kept. Bytes that were not
+ *        recorded, beyond payload prefix, are sent as zeros.
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 Irnas.  All rights reserved.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr.h>
+#include "lr1110.h"
+#include "lr1110_sim.h"
+#include "lr1110_driver/lr1110_hal.h"
+
+#define LINE_MAX_LENGTH     1024
+#define BUFFER_SIZE         1024
+
+struct replay_record {
+    uint32_t seq;
+    uint32_t cycles;
+    char type;
+    unsigned int opcode;
+    uint16_t command_length;
+    uint16_t data_length;
+    uint32_t busy_us;
+    uint32_t duration_us;
+    unsigned int status;
+    uint8_t payload[BUFFER_SIZE];
+    uint16_t payload_length;
+};
+
+static lr1110_t lr1110;
+
+static uint8_t command[BUFFER_SIZE];
+static uint8_t data[BUFFER_SIZE];
+
+/*!
+ * @brief Parses one record line
+ *
+ * @return true if line is a record
+ */
+static bool parse_record(const char * line, struct replay_record * record)
+{
+    char payload[LINE_MAX_LENGTH];
+
+    if (sscanf(line, "%u %u %c %x %hu %hu %u %u %u %1023s",
+               &record->seq, &record->cycles, &record->type,
+               &record->opcode, &record->command_length,
+               &record->data_length, &record->busy_us,
+               &record->duration_us, &record->status, payload) != 10) {
+        return false;
+    }
+    if (!strchr("WRX", record->type) ||
+        record->command_length > BUFFER_SIZE ||
+        record->data_length > BUFFER_SIZE) {
+        return false;
+    }
+
+    record->payload_length = 0;
+    if (strcmp(payload, "-")) {
+        for (size_t i = 0; payload[2 * i] && payload[2 * i + 1] &&
+                           i < BUFFER_SIZE; i++)
+        {
+            unsigned int byte;
+
+            if (sscanf(&payload[2 * i], "%2x", &byte) != 1) {
+                return false;
+            }
+            record->payload[record->payload_length++] = byte;
+        }
+    }
+    return true;
+}
+
+
+/*!
+ * @brief Sends record to radio
+ *
+ * @return HAL status
+ */
+static lr1110_hal_status_t replay(const struct replay_record * record)
+{
+    uint16_t command_part = MIN(record->command_length,
+                                record->payload_length);
+
+    memset(command, 0, sizeof(command));
+    memset(data, 0, sizeof(data));
+    memcpy(command, record->payload, command_part);
+
+    switch (record->type)
+    {
+        case 'W':
+            /* Recorded data follows command in payload */
+            memcpy(data, &record->payload[command_part],
+                   record->payload_length - command_part);
+            return lr1110_hal_write(&lr1110, command, record->command_length,
+                                    data, record->data_length);
+        case 'R':
+            return lr1110_hal_read(&lr1110, command, record->command_length,
+                                   data, record->data_length);
+        default:
+            return lr1110_hal_write_read(&lr1110, command, data,
+                                         record->data_length);
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    FILE * input = stdin;
+    bool keep_gaps = false;
+    char line[LINE_MAX_LENGTH];
+    unsigned int cycles_per_sec = CONFIG_SYS_CLOCK_HW_CYCLES_PER_SEC;
+    struct replay_record record;
+    bool first = true;
+    uint32_t first_cycles = 0;
+    int64_t start_ms = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-g")) {
+            keep_gaps = true;
+        }
+        else if (!(input = fopen(argv[i], "r"))) {
+            perror(argv[i]);
+            return 1;
+        }
+    }
+
+    lr1110_sim_init(0, NULL);
+    lr1110_sim_attach(0, &lr1110);
+    lr1110_init(&lr1110);
+
+    printf("seq,type,opcode,command_length,data_length,"
+           "recorded_us,recorded_busy_us,recorded_status,"
+           "replay_us,replay_busy_us,replay_status,truncated\n");
+
+    while (fgets(line, sizeof(line), input))
+    {
+        const char * header = strstr(line, "cycles_per_sec ");
+
+        if (line[0] == '#' && header) {
+            sscanf(header, "cycles_per_sec %u", &cycles_per_sec);
+            continue;
+        }
+        if (!parse_record(line, &record)) {
+            continue;
+        }
+
+        if (first) {
+            first = false;
+            first_cycles = record.cycles;
+            start_ms = k_uptime_get();
+        }
+        if (keep_gaps) {
+            int64_t at_ms = start_ms + (uint64_t)
+                            (record.cycles - first_cycles) * 1000 /
+                            cycles_per_sec;
+
+            if (at_ms > k_uptime_get()) {
+                k_sleep(K_MSEC(at_ms - k_uptime_get()));
+            }
+        }
+
+        struct lr1110_hal_stats before;
+        struct lr1110_hal_stats after;
+
+        lr1110_hal_get_stats(&lr1110, &before);
+        uint32_t start = k_cycle_get_32();
+        lr1110_hal_status_t status = replay(&record);
+        uint32_t duration_us = k_cyc_to_us_floor32(k_cycle_get_32() - start);
+        lr1110_hal_get_stats(&lr1110, &after);
+
+        printf("%u,%c,%04x,%u,%u,%u,%u,%u,%u,%u,%d,%d\n",
+               record.seq, record.type, record.opcode,
+               record.command_length, record.data_length,
+               record.duration_us, record.busy_us, record.status,
+               duration_us,
+               (uint32_t) (after.busy_wait_total_us -
+                           before.busy_wait_total_us),
+               status,
+               record.payload_length <
+                   (record.type == 'W' ?
+                    record.command_length + record.data_length :
+                    record.command_length));
+    }
+
+    if (input != stdin) {
+        fclose(input);
+    }
+    return 0;
+}
+
+/*** end of file ***/
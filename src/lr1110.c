@@ -8,6 +8,7 @@
  * COPYRIGHT NOTICE: (c) 2021 Irnas.  All rights reserved.
  */ 
 
+#include <errno.h>
 #include "lr1110.h"
 #include "lr1110_configs.h"
 #include "lr1110_trx_board.h"
@@ -23,43 +24,85 @@
 /* -------------------------------------------------------------------------
  * PRIVATE PROTOTYPES
  * ------------------------------------------------------------------------- */
+static void lr1110_host_init(const void * context);
+static uint16_t lr1110_cold_start(const void * context);
+static bool lr1110_woke_from_sleep(const void * context);
+static void lr1110_event_init(const void * context);
+static void lr1110_event_isr(const struct device * port,
+                             struct gpio_callback * cb,
+                             gpio_port_pins_t pins);
 
 /* -------------------------------------------------------------------------
  * PUBLIC IMPLEMENTATIONS
  * ------------------------------------------------------------------------- */
 
-void lr1110_init(const void * context)
+/*!
+ * @brief               Initializes MCU peripherals, resets the radio and 
+ *                      performs full radio configuration and calibration.
+ *
+ * @param[in] context   Radio abstraction
+ *
+ * @return              Initialization diagnostics
+ */
+struct lr1110_init_diagnostics lr1110_init(const void * context)
 {
-    lr1110_gpio_init(context);
-    lr1110_spi_init(context);
+    struct lr1110_init_diagnostics init_diagnostics = {0};
+    uint32_t start = k_cycle_get_32();
 
-    lr1110_hal_reset(context);
+    lr1110_host_init(context);
 
-    /* Added to let the radio perform it startup sequence */
-    k_sleep(K_MSEC(500));
+    lr1110_lock(context, K_FOREVER);
+    init_diagnostics.errors = lr1110_cold_start(context);
+    /* Chip reset cleared IRQ routing of registered handlers */
+    lr1110_irq_resume((void *) context);
+    lr1110_unlock(context);
 
-    if (lr1110_system_set_reg_mode(context, LR1110_SYSTEM_REG_MODE_DCDC)) {
-        printk("Setting DCDC mode failed\n");
-    }
+    init_diagnostics.init_duration_us = 
+        k_cyc_to_us_floor32(k_cycle_get_32() - start);
+    return init_diagnostics;
+}
 
-    if (lr1110_rf_switch_init(context)) {
-        printk("RF switch init failed\n");
-    }
 
-    if (lr1110_system_set_tcxo_mode(context, 
-                                    LR1110_SYSTEM_TCXO_CTRL_3_0V, 
-                                    500)){
-        printk("Setting tcxo failed\n");
+/*!
+ * @brief               Initializes MCU peripherals and wakes up the radio,
+ *                      which kept its configuration and calibration through
+ *                      sleep with retention (warm start). TCXO setup and 
+ *                      calibration are skipped. If radio does not respond 
+ *                      or was reset meanwhile instead of waking up from 
+ *                      sleep, full initialization is performed instead.
+ *
+ * @param[in] context   Radio abstraction
+ *
+ * @return              Initialization diagnostics
+ */
+struct lr1110_init_diagnostics lr1110_warm_init(const void * context)
+{
+    struct lr1110_init_diagnostics init_diagnostics = {0};
+    uint32_t start = k_cycle_get_32();
+
+    lr1110_host_init(context);
+
+    lr1110_lock(context, K_FOREVER);
+
+    lr1110_hal_wakeup(context);
+
+    if (lr1110_woke_from_sleep(context)) {
+        lr1110_system_get_errors(context, &init_diagnostics.errors);
+        lr1110_system_clear_errors(context);
+        lr1110_system_clear_irq_status(context, LR1110_SYSTEM_IRQ_ALL_MASK);
+        init_diagnostics.warm_start = true;
+    }
+    else {
+        printk("Warm start failed, doing cold start\n");
+        init_diagnostics.errors = lr1110_cold_start(context);
     }
 
-    lr1110_system_cfg_lfclk(context, LR1110_SYSTEM_LFCLK_XTAL, true);
-    lr1110_system_clear_errors(context);
-    lr1110_system_calibrate(context, 0x3F); /* Value from Semtech's examples */
+    lr1110_irq_resume((void *) context);
+    lr1110_unlock(context);
 
-    uint16_t errors;
-    lr1110_system_get_errors(context, &errors);
-    lr1110_system_clear_errors(context);
-    lr1110_system_clear_irq_status(context, LR1110_SYSTEM_IRQ_ALL_MASK);
+    init_diagnostics.init_duration_us = 
+        k_cyc_to_us_floor32(k_cycle_get_32() - start);
+    return init_diagnostics;
 }
 
 
@@ -85,29 +128,226 @@ void lr1110_display_trx_version(const void * context)
     printk("FIRMWARE : 0x%04X\n\n",  lr1110_version.fw);
 }
 
+#if !DT_HAS_COMPAT_STATUS_OKAY(semtech_lr1110)
 void lr1110_set_device_config(void * context, const char * device)
 {
     lr1110_set_config(context, device);
 }
+#endif
 
+/*!
+ * @brief               Takes exclusive ownership of the radio, so a sequence 
+ *                      of commands can be issued without other threads 
+ *                      getting in between. Lock is recursive, single HAL 
+ *                      transactions take it as well.
+ *
+ * @param[in] context   Radio abstraction
+ * @param[in] timeout   How long to wait for the radio
+ *
+ * @return              0 on success, -EAGAIN on timeout.
+ */
+int lr1110_lock(const void * context, k_timeout_t timeout)
+{
+    return k_mutex_lock(&((lr1110_t*) context)->lock, timeout);
+}
+
+/*!
+ * @brief               Releases ownership taken with lr1110_lock
+ *
+ * @param[in] context   Radio abstraction
+ */
+void lr1110_unlock(const void * context)
+{
+    k_mutex_unlock(&((lr1110_t*) context)->lock);
+}
+
+/*!
+ * @brief               Routes selected IRQ sources to the event pin and arms
+ *                      the event interrupt. Event line is owned by caller 
+ *                      until lr1110_clear_event, IRQ dispatcher is 
+ *                      suspended meanwhile. Radio has to be locked.
+ *
+ * @param[in] context   Radio abstraction
+ * @param[in] event_mask IRQ sources that should raise the event pin
+ */
 void lr1110_prepare_event(void * context, lr1110_system_irq_mask_t event_mask)
 {
+    k_sem_reset(&((lr1110_t*) context)->event_sem);
+    lr1110_irq_suspend(context);
+
     lr1110_system_set_dio_irq_params(context, event_mask, 0);
+
+    gpio_pin_interrupt_configure(((lr1110_t*) context)->event.port,
+                                 ((lr1110_t*) context)->event.pin,
+                                 ((lr1110_t*) context)->event_trigger_type);
 }
 
-void lr1110_wait_for_event(void * context)
+/*!
+ * @brief               Sleeps until the event pin interrupt fires.
+ *
+ * @param[in] context   Radio abstraction
+ * @param[in] timeout_ms Maximum time to wait, in milliseconds
+ *
+ * @return              0 on event, -ETIMEDOUT if the event did not arrive
+ *                      in time.
+ */
+int lr1110_wait_for_event(void * context, uint32_t timeout_ms)
 {
-	while (0 == gpio_pin_get(((lr1110_t*) context)->event.port, 
-                             ((lr1110_t*) context)->event.pin));
+    if (k_sem_take(&((lr1110_t*) context)->event_sem, K_MSEC(timeout_ms))) {
+        gpio_pin_interrupt_configure(((lr1110_t*) context)->event.port,
+                                     ((lr1110_t*) context)->event.pin,
+                                     GPIO_INT_DISABLE);
+        return -ETIMEDOUT;
+    }
+    return 0;
 }
 
+/*!
+ * @brief               Clears IRQ status and gives event line back to IRQ
+ *                      dispatcher. Event interrupt is disarmed if no IRQ 
+ *                      handler is registered.
+ *
+ * @param[in] context   Radio abstraction
+ * @param[in] event_mask IRQ sources to clear
+ */
 void lr1110_clear_event(void * context, lr1110_system_irq_mask_t event_mask)
 {
+    gpio_pin_interrupt_configure(((lr1110_t*) context)->event.port,
+                                 ((lr1110_t*) context)->event.pin,
+                                 GPIO_INT_DISABLE);
     lr1110_system_clear_irq_status(context,  event_mask);
+    lr1110_irq_resume(context);
 }
 
 /* -------------------------------------------------------------------------
  * PRIVATE IMPLEMENTATIONS
  * ------------------------------------------------------------------------- */
 
+/*!
+ * @brief               Initializes MCU side peripherals
+ *
+ * @param[in] context   Radio abstraction
+ */
+static void lr1110_host_init(const void * context)
+{
+    lr1110_gpio_init(context);
+    lr1110_event_init(context);
+    lr1110_spi_init(context);
+    lr1110_power_init(context);
+}
+
+
+/*!
+ * @brief               Resets the radio and configures it from scratch
+ *
+ * @param[in] context   Radio abstraction
+ *
+ * @return              Chip errors after calibration
+ */
+static uint16_t lr1110_cold_start(const void * context)
+{
+    /* Returns once startup sequence is over */
+    if (lr1110_hal_reset(context)) {
+        printk("Radio did not finish startup\n");
+    }
+
+    if (lr1110_system_set_reg_mode(context, LR1110_SYSTEM_REG_MODE_DCDC)) {
+        printk("Setting DCDC mode failed\n");
+    }
+
+    if (lr1110_rf_switch_init(context)) {
+        printk("RF switch init failed\n");
+    }
+
+    if (lr1110_system_set_tcxo_mode(context, 
+                                    LR1110_SYSTEM_TCXO_CTRL_3_0V, 
+                                    500)){
+        printk("Setting tcxo failed\n");
+    }
+
+    lr1110_system_cfg_lfclk(context, LR1110_SYSTEM_LFCLK_XTAL, true);
+    lr1110_system_clear_errors(context);
+    lr1110_system_calibrate(context, 0x3F); /* Value from Semtech's examples */
+
+    uint16_t errors = 0;
+    lr1110_system_get_errors(context, &errors);
+    lr1110_system_clear_errors(context);
+    lr1110_system_clear_irq_status(context, LR1110_SYSTEM_IRQ_ALL_MASK);
+
+    return errors;
+}
+
+
+/*!
+ * @brief               Checks reset status in Stat2, which tells whether 
+ *                      radio last restarted by waking up from sleep or was
+ *                      reset (power on, brownout, NRESET, watchdog). 
+ *                      Library puts radio to sleep with retention only.
+ *
+ * @param[in] context   Radio abstraction
+ *
+ * @return              True if radio woke up from sleep
+ */
+static bool lr1110_woke_from_sleep(const void * context)
+{
+    lr1110_system_stat1_t stat1;
+    lr1110_system_stat2_t stat2;
+    lr1110_system_irq_mask_t irq_status;
+
+    if (lr1110_system_get_status(context, &stat1, &stat2, &irq_status)) {
+        return false;
+    }
+    return stat2.reset_status == LR1110_SYSTEM_RESET_STATUS_IOCD_RESTART ||
+           stat2.reset_status == LR1110_SYSTEM_RESET_STATUS_RTC_RESTART;
+}
+
+
+/*!
+ * @brief               Registers event pin interrupt callback. Interrupt 
+ *                      itself stays disabled until lr1110_prepare_event or
+ *                      until IRQ handler is registered.
+ *
+ * @param[in] context   Radio abstraction
+ */
+static void lr1110_event_init(const void * context)
+{
+    lr1110_t * lr1110 = (lr1110_t*) context;
+
+    k_sem_init(&lr1110->event_sem, 0, 1);
+    lr1110_irq_init(lr1110);
+
+    gpio_pin_interrupt_configure(lr1110->event.port, 
+                                 lr1110->event.pin,
+                                 GPIO_INT_DISABLE);
+    gpio_init_callback(&lr1110->event_cb_data, 
+                       lr1110_event_isr, 
+                       BIT(lr1110->event.pin));
+    gpio_add_callback(lr1110->event.port, &lr1110->event_cb_data);
+}
+
+/*!
+ * @brief               Event pin interrupt handler
+ *
+ * @note                Event pin is level triggered by default, so interrupt
+ *                      is masked here and armed again by lr1110_prepare_event
+ *                      or by IRQ dispatcher, once IRQ status is cleared.
+ */
+static void lr1110_event_isr(const struct device * port,
+                             struct gpio_callback * cb,
+                             gpio_port_pins_t pins)
+{
+    lr1110_t * lr1110 = CONTAINER_OF(cb, lr1110_t, event_cb_data);
+
+    lr1110->event_cycles = k_cycle_get_32();
+    gpio_pin_interrupt_configure(lr1110->event.port, 
+                                 lr1110->event.pin,
+                                 GPIO_INT_DISABLE);
+    k_sem_give(&lr1110->event_sem);
+    lr1110_irq_event(lr1110);
+
+    if (lr1110->event_interrupt_cb != NULL) {
+        lr1110->event_interrupt_cb();
+    }
+}
+
 /*** end of file ***/
@@ -17,10 +17,24 @@ extern "C" {
 
 #include <zephyr.h>
 #include <device.h>
+#include <devicetree.h>
 #include <drivers/gpio.h>
+#include <drivers/spi.h>
 #include "lr1110_driver/lr1110_system.h"
 #include "lr1110_driver/lr1110_system_types.h"
 #include "lr1110_wifi_scan.h"
+#include "lr1110_gnss_scan.h"
+#include "lr1110_almanac.h"
+#include "lr1110_lora.h"
+#include "lr1110_wifi_codec.h"
+#include "lr1110_ap_cache.h"
+#include "lr1110_wifi_scheduler.h"
+#include "lr1110_wifi_serialize.h"
+#include "lr1110_wifi_pipeline.h"
+#include "lr1110_benchmark.h"
+#include "lr1110_hal_trace.h"
+#include "lr1110_irq.h"
+#include "lr1110_trx_board.h"
 
 
 /*!
@@ -30,12 +44,14 @@ extern "C" {
  */
 typedef struct
 {
-    struct device * port;
+    const struct device * port;
     gpio_pin_t pin;
 } port_pin_t;
 
 /*!
- * @brief Radio hardware and global parameters, also known as context
+ * @brief Radio hardware and global parameters, also known as context. Has
+ *        to be zero initialized before first lr1110_init, IRQ dispatcher
+ *        and power manager state is kept through re-initialization.
  */
 typedef struct
 {
@@ -45,26 +61,60 @@ typedef struct
     port_pin_t busy;
     port_pin_t lna;
     char * spi_dev_label;
-    lr1110_system_rfswitch_cfg_t * rf_switch_cfg;
+    const lr1110_system_rfswitch_cfg_t * rf_switch_cfg;
     void (*event_interrupt_cb)(void);
     gpio_flags_t event_trigger_type;
+    struct gpio_callback event_cb_data;
+    struct k_sem event_sem;
+    uint32_t event_cycles;          /* Last event interrupt, hw cycles */
+    struct lr1110_irq irq;
+    struct gpio_callback busy_cb_data;
+    struct k_sem busy_sem;
+    struct lr1110_hal_stats hal_stats;
+    struct lr1110_power power;
+    const struct device * spi_dev;
+    uint32_t spi_max_frequency;
+    struct spi_config spi_cfg[2];   /* Active and spare, see trx board */
+    uint8_t spi_cfg_idx;
+    struct k_mutex lock;
+    bool lock_initialized;
+#if LR1110_HAL_TRACE
+    struct lr1110_hal_trace * hal_trace;    /* NULL when not recording */
+#endif
 } lr1110_t;
 
 
-void lr1110_init(const void * context);
+/*!
+ * @brief Outcome of radio initialization
+ */
+struct lr1110_init_diagnostics {
+    uint32_t init_duration_us;
+    uint16_t errors;    /* Chip errors reported during initialization */
+    bool warm_start;    /* Chip state was retained, cold start was skipped */
+};
+
+struct lr1110_init_diagnostics lr1110_init(const void * context);
+struct lr1110_init_diagnostics lr1110_warm_init(const void * context);
+#if !DT_HAS_COMPAT_STATUS_OKAY(semtech_lr1110)
 void lr1110_set_device_config(void * context, const char * device);
+#endif
 
 void lr1110_get_trx_version(const void * context, 
                             lr1110_system_version_t * lr1110_version);
 void lr1110_display_trx_version(const void * context);
 
+int lr1110_lock(const void * context, k_timeout_t timeout);
+void lr1110_unlock(const void * context);
+
 void lr1110_prepare_event(void * context, lr1110_system_irq_mask_t event_mask);
-void lr1110_wait_for_event(void * context);
+int lr1110_wait_for_event(void * context, uint32_t timeout_ms);
 void lr1110_clear_event(void * context, lr1110_system_irq_mask_t event_mask);
 
 #ifdef __cplusplus
 }
 #endif
 
+#include "lr1110_configs.h"
+
 #endif /* LR1110_TRX_H */
 /*** end of file ***/
@@ -0,0 +1,298 @@
+/** @file lr1110_almanac.c
+ *
+ * @brief       GNSS almanac update, streamed in chunks.
+ *
+ *              Two chunk buffers are used. While one is written to the
+ *              radio by calling thread, the other is filled by reader in
+ *              system work queue. If update itself runs in system work
+ *              queue, reader would never run while update waits for it,
+ *              so chunks are read inline, one after another, instead.
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 Irnas.  All rights reserved.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include "lr1110.h"
+#include "lr1110_almanac.h"
+#include "lr1110_driver/lr1110_gnss.h"
+
+#if defined(CONFIG_FLASH_MAP)
+#include <storage/flash_map.h>
+#endif
+
+/* -------------------------------------------------------------------------
+ * PRIVATE VARIABLES
+ * ------------------------------------------------------------------------- */
+
+/* Header block layout, multi-byte values are little endian. Header also
+ * holds almanac date, which is not needed, radio CRC tells if image is
+ * already there. */
+#define ALMANAC_HEADER_CRC_OFFSET       3
+
+/* -------------------------------------------------------------------------
+ * PRIVATE PROTOTYPES
+ * ------------------------------------------------------------------------- */
+static void almanac_read_handler(struct k_work * work);
+static void almanac_read_start(struct lr1110_almanac_update * update,
+                               uint8_t * buffer,
+                               uint16_t block);
+static int almanac_read_wait(struct lr1110_almanac_update * update);
+static int almanac_write(void * context,
+                         const uint8_t * blocks,
+                         uint16_t nb_blocks);
+
+/* -------------------------------------------------------------------------
+ * PUBLIC IMPLEMENTATIONS
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * @brief               Prepares update of image provided by reader. Header
+ *                      block is read to get image CRC. Stored
+ *                      progress can be restored into update->progress
+ *                      after this call.
+ *
+ * @param[out] update   Update state
+ * @param[in] read      Image reader, see lr1110_almanac_flash_read
+ * @param[in] user_data Passed to reader
+ * @param[in] image_size Image size in bytes
+ *
+ * @return              0 on success, -EINVAL if image size is not valid,
+ *                      reader error otherwise.
+ */
+int lr1110_almanac_update_init(struct lr1110_almanac_update * update,
+                               lr1110_almanac_read_t read,
+                               void * user_data,
+                               uint32_t image_size)
+{
+    uint8_t header[LR1110_ALMANAC_BLOCK_SIZE];
+
+    if (image_size % LR1110_ALMANAC_BLOCK_SIZE ||
+        image_size < 2 * LR1110_ALMANAC_BLOCK_SIZE ||
+        image_size / LR1110_ALMANAC_BLOCK_SIZE > UINT16_MAX) {
+        return -EINVAL;
+    }
+
+    memset(update, 0, sizeof(*update));
+    update->read = read;
+    update->user_data = user_data;
+    update->nb_blocks = image_size / LR1110_ALMANAC_BLOCK_SIZE;
+    k_work_init(&update->read_work, almanac_read_handler);
+    k_sem_init(&update->read_sem, 0, 1);
+
+    int err = read(user_data, 0, header, sizeof(header));
+
+    if (err) {
+        return err;
+    }
+
+    update->crc = header[ALMANAC_HEADER_CRC_OFFSET] |
+                  (header[ALMANAC_HEADER_CRC_OFFSET + 1] << 8) |
+                  (header[ALMANAC_HEADER_CRC_OFFSET + 2] << 16) |
+                  ((uint32_t) header[ALMANAC_HEADER_CRC_OFFSET + 3] << 24);
+    update->progress.crc = update->crc;
+    return 0;
+}
+
+
+/*!
+ * @brief               Writes image to radio. If radio almanac CRC already
+ *                      matches the image, nothing is written. If progress
+ *                      belongs to this image, writing continues after the
+ *                      last written block, header block is sent again
+ *                      first. On error progress is kept, so next call
+ *                      resumes. Can be called from system work queue,
+ *                      chunks are then not read ahead.
+ *
+ * @param[in] context   Radio abstraction
+ * @param[in] update    Update state
+ *
+ * @return              0 when image was written and verified, -EALREADY if
+ *                      radio already has it, -EBADMSG if CRC did not match
+ *                      after writing (next call starts over), -EIO on radio
+ *                      error, reader error otherwise.
+ */
+int lr1110_almanac_update_run(void * context,
+                              struct lr1110_almanac_update * update)
+{
+    struct lr1110_almanac_progress * progress = &update->progress;
+    uint32_t crc;
+    uint8_t idx = 0;
+    int err;
+
+    if (!lr1110_almanac_get_crc(context, &crc) && crc == update->crc) {
+        progress->next_block = update->nb_blocks;
+        return -EALREADY;
+    }
+
+    if (progress->crc != update->crc ||
+        progress->next_block >= update->nb_blocks) {
+        progress->crc = update->crc;
+        progress->next_block = 0;
+    }
+
+    if (progress->next_block > 0) {
+        almanac_read_start(update, update->buffers[0], 0);
+        err = almanac_read_wait(update);
+        if (!err) {
+            err = almanac_write(context, update->buffers[0], 1);
+        }
+        if (err) {
+            return err;
+        }
+    }
+
+    uint16_t block = progress->next_block;
+
+    almanac_read_start(update, update->buffers[idx], block);
+    err = almanac_read_wait(update);
+
+    while (!err && block < update->nb_blocks)
+    {
+        uint16_t nb = MIN(LR1110_ALMANAC_CHUNK_BLOCKS,
+                          update->nb_blocks - block);
+        uint16_t next = block + nb;
+
+        /* Next chunk is read while this one goes over SPI */
+        if (next < update->nb_blocks) {
+            almanac_read_start(update, update->buffers[!idx], next);
+        }
+
+        int write_err = almanac_write(context, update->buffers[idx], nb);
+
+        if (next < update->nb_blocks) {
+            err = almanac_read_wait(update);
+        }
+        if (write_err) {
+            return write_err;
+        }
+
+        block = next;
+        progress->next_block = next;
+        idx = !idx;
+    }
+
+    if (err) {
+        return err;
+    }
+
+    if (lr1110_almanac_get_crc(context, &crc)) {
+        return -EIO;
+    }
+    if (crc != update->crc) {
+        progress->next_block = 0;
+        return -EBADMSG;
+    }
+    return 0;
+}
+
+
+/*!
+ * @brief               Reads CRC of almanac stored in radio
+ *
+ * @param[in] context   Radio abstraction
+ * @param[out] crc      Almanac CRC
+ *
+ * @return              0 on success, -EIO on radio error
+ */
+int lr1110_almanac_get_crc(void * context, uint32_t * crc)
+{
+    lr1110_gnss_context_status_bytestream_t bytestream;
+    lr1110_gnss_context_status_t context_status;
+    lr1110_status_t status;
+
+    lr1110_lock(context, K_FOREVER);
+    status = lr1110_gnss_get_context_status(context, bytestream);
+    lr1110_unlock(context);
+
+    if (status || lr1110_gnss_parse_context_status_buffer(bytestream,
+                                                          &context_status)) {
+        return -EIO;
+    }
+
+    *crc = context_status.global_almanac_crc;
+    return 0;
+}
+
+
+#if defined(CONFIG_FLASH_MAP)
+/*!
+ * @brief               Reader of image stored in flash partition, user_data
+ *                      is partition opened with flash_area_open
+ */
+int lr1110_almanac_flash_read(void * user_data,
+                              uint32_t offset,
+                              uint8_t * buffer,
+                              size_t length)
+{
+    return flash_area_read((const struct flash_area *) user_data,
+                           offset, buffer, length);
+}
+#endif
+
+/* -------------------------------------------------------------------------
+ * PRIVATE IMPLEMENTATIONS
+ * ------------------------------------------------------------------------- */
+
+static void almanac_read_handler(struct k_work * work)
+{
+    struct lr1110_almanac_update * update =
+        CONTAINER_OF(work, struct lr1110_almanac_update, read_work);
+
+    update->read_err = update->read(update->user_data,
+                                    update->read_offset,
+                                    update->read_buffer,
+                                    update->read_length);
+    k_sem_give(&update->read_sem);
+}
+
+
+/*!
+ * @brief               Starts reading chunk that begins with block. In
+ *                      system work queue chunk is read before returning.
+ */
+static void almanac_read_start(struct lr1110_almanac_update * update,
+                               uint8_t * buffer,
+                               uint16_t block)
+{
+    uint16_t nb = MIN(LR1110_ALMANAC_CHUNK_BLOCKS, update->nb_blocks - block);
+
+    update->read_buffer = buffer;
+    update->read_offset = (uint32_t) block * LR1110_ALMANAC_BLOCK_SIZE;
+    update->read_length = nb * LR1110_ALMANAC_BLOCK_SIZE;
+
+    if (k_current_get() == k_work_queue_thread_get(&k_sys_work_q)) {
+        almanac_read_handler(&update->read_work);
+    }
+    else {
+        k_work_submit(&update->read_work);
+    }
+}
+
+
+static int almanac_read_wait(struct lr1110_almanac_update * update)
+{
+    k_sem_take(&update->read_sem, K_FOREVER);
+    return update->read_err;
+}
+
+
+/*!
+ * @brief               Writes blocks with one command, radio is locked
+ *                      only for this chunk
+ */
+static int almanac_write(void * context,
+                         const uint8_t * blocks,
+                         uint16_t nb_blocks)
+{
+    lr1110_status_t status;
+
+    lr1110_lock(context, K_FOREVER);
+    status = lr1110_gnss_almanac_update(context, blocks, nb_blocks);
+    lr1110_unlock(context);
+
+    return status ? -EIO : 0;
+}
+
+/*** end of file ***/
@@ -0,0 +1,95 @@
+/** @file lr1110_almanac.h
+ *
+ * @brief       GNSS almanac update, streamed from flash or any other
+ *              storage in small chunks. Next chunk is read while current
+ *              one is written over SPI, so the whole image never has to
+ *              be in RAM. Update is skipped when radio already has the
+ *              image, verified with almanac CRC when it is done and can be
+ *              resumed after interruption.
+ *
+ *              Image is a full almanac as provided by LoRa Cloud: header
+ *              block with date and CRC, followed by one block per
+ *              satellite.
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 Irnas.  All rights reserved.
+ */
+
+#ifndef LR1110_ALMANAC_H
+#define LR1110_ALMANAC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <zephyr.h>
+#include "lr1110_driver/lr1110_gnss_types.h"
+
+#define LR1110_ALMANAC_BLOCK_SIZE   LR1110_GNSS_SINGLE_ALMANAC_WRITE_SIZE
+
+/* Blocks written with one command, sets size of the two chunk buffers */
+#ifndef LR1110_ALMANAC_CHUNK_BLOCKS
+#define LR1110_ALMANAC_CHUNK_BLOCKS 8
+#endif
+
+/*!
+ * @brief Reads length bytes of image at offset into buffer
+ *
+ * @return 0 on success, negative errno otherwise
+ */
+typedef int (*lr1110_almanac_read_t)(void * user_data,
+                                     uint32_t offset,
+                                     uint8_t * buffer,
+                                     size_t length);
+
+/*!
+ * @brief Update progress. Can be stored by caller and restored after
+ *        reboot, update then continues where it stopped.
+ */
+struct lr1110_almanac_progress {
+    uint32_t crc;               /* CRC of image being written */
+    uint16_t next_block;        /* First block not written yet */
+};
+
+/*!
+ * @brief Update state, has to be initialized with lr1110_almanac_update_init
+ */
+struct lr1110_almanac_update {
+    lr1110_almanac_read_t read;
+    void * user_data;
+    uint16_t nb_blocks;
+    uint32_t crc;               /* From image header */
+    struct lr1110_almanac_progress progress;
+    /* Chunk reader, runs in system work queue, or inline when update
+     * itself runs there */
+    struct k_work read_work;
+    struct k_sem read_sem;
+    uint8_t * read_buffer;
+    uint32_t read_offset;
+    size_t read_length;
+    int read_err;
+    uint8_t buffers[2][LR1110_ALMANAC_CHUNK_BLOCKS *
+                       LR1110_ALMANAC_BLOCK_SIZE];
+};
+
+int lr1110_almanac_update_init(struct lr1110_almanac_update * update,
+                               lr1110_almanac_read_t read,
+                               void * user_data,
+                               uint32_t image_size);
+int lr1110_almanac_update_run(void * context,
+                              struct lr1110_almanac_update * update);
+int lr1110_almanac_get_crc(void * context, uint32_t * crc);
+
+#if defined(CONFIG_FLASH_MAP)
+int lr1110_almanac_flash_read(void * user_data,
+                              uint32_t offset,
+                              uint8_t * buffer,
+                              size_t length);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LR1110_ALMANAC_H */
+/*** end of file ***/
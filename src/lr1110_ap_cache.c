@@ -0,0 +1,326 @@
+/** @file lr1110_ap_cache.c
+ *
+ * @brief       Fixed size cache of observed wifi access points.
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 Irnas.  All rights reserved.
+ */
+
+#include <zephyr.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lr1110_ap_cache.h"
+
+/* -------------------------------------------------------------------------
+ * PRIVATE VARIABLES
+ * ------------------------------------------------------------------------- */
+
+/* Entry flags */
+#define AP_CACHE_USED       0x01
+#define AP_CACHE_NEW        0x02    /* Appearance not reported yet */
+
+/* Weight of new sample in RSSI moving average is 1/2^AP_CACHE_AVG_SHIFT */
+#define AP_CACHE_AVG_SHIFT  2
+
+/* -------------------------------------------------------------------------
+ * PRIVATE PROTOTYPES
+ * ------------------------------------------------------------------------- */
+static struct lr1110_ap_cache_entry * get_entry(struct lr1110_ap_cache * cache,
+                                                const uint8_t * mac,
+                                                uint32_t now_ms);
+static void add_sample(struct lr1110_ap_cache_entry * entry,
+                       const struct lr1110_wifi_ap * ap,
+                       uint32_t now_ms);
+static int8_t rssi_avg(const struct lr1110_ap_cache_entry * entry);
+
+/* -------------------------------------------------------------------------
+ * PUBLIC IMPLEMENTATIONS
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * @brief               Removes all entries and resets counters
+ *
+ * @param[in] cache     AP cache
+ */
+void lr1110_ap_cache_clear(struct lr1110_ap_cache * cache)
+{
+    memset(cache->entries, 0,
+           cache->size * sizeof(struct lr1110_ap_cache_entry));
+    cache->stable_count = 0;
+    cache->evicted = 0;
+    cache->dropped = 0;
+}
+
+
+/*!
+ * @brief               Adds observations from one scan. When cache is full,
+ *                      least recently seen AP is evicted, APs seen at now_ms
+ *                      are never evicted. If evicted AP was already
+ *                      reported, its disappearance can no longer be
+ *                      reported and it is counted in evicted. If all APs
+ *                      were seen at now_ms, new AP is counted in dropped.
+ *
+ * @param[in] cache     AP cache
+ * @param[in] aps       Observed access points
+ * @param[in] nb_aps    Number of observed access points
+ * @param[in] now_ms    Time of observation
+ */
+void lr1110_ap_cache_update(struct lr1110_ap_cache * cache,
+                            const struct lr1110_wifi_ap * aps,
+                            uint8_t nb_aps,
+                            uint32_t now_ms)
+{
+    for (uint8_t i = 0; i < nb_aps; i++)
+    {
+        struct lr1110_ap_cache_entry * entry = 
+            get_entry(cache, aps[i].mac, now_ms);
+
+        if (entry) {
+            add_sample(entry, &aps[i], now_ms);
+        }
+        else {
+            cache->dropped++;
+        }
+    }
+}
+
+
+/*!
+ * @brief               Returns APs that appeared, disappeared or changed
+ *                      average RSSI by at least rssi_change_db since they
+ *                      were last reported. Reported changes are cleared,
+ *                      disappeared APs are evicted. APs that disappear
+ *                      before their appearance was reported are evicted
+ *                      without reporting. Changes that do not fit into
+ *                      array are kept for next call.
+ *
+ * @param[in] cache     AP cache
+ * @param[in] now_ms    Current time, used for aging
+ * @param[out] changes  Changes
+ * @param[in] max_changes Size of changes array
+ *
+ * @return              Number of changes
+ */
+int lr1110_ap_cache_get_changes(struct lr1110_ap_cache * cache,
+                                uint32_t now_ms,
+                                struct lr1110_ap_change * changes,
+                                uint8_t max_changes)
+{
+    uint8_t count = 0;
+
+    for (uint8_t i = 0; i < cache->size && count < max_changes; i++)
+    {
+        struct lr1110_ap_cache_entry * entry = &cache->entries[i];
+        struct lr1110_ap_change * change = &changes[count];
+        int8_t avg = rssi_avg(entry);
+
+        if (!(entry->flags & AP_CACHE_USED)) {
+            continue;
+        }
+
+        if ((uint32_t) (now_ms - entry->last_seen_ms) > cache->max_age_ms) {
+            if (entry->flags & AP_CACHE_NEW) {
+                memset(entry, 0, sizeof(*entry));
+                continue;
+            }
+            change->type = LR1110_AP_DISAPPEARED;
+            change->rssi = entry->rssi_last;
+        }
+        else if (entry->flags & AP_CACHE_NEW) {
+            change->type = LR1110_AP_APPEARED;
+            change->rssi = avg;
+        }
+        else if (abs(avg - entry->rssi_reported) >= cache->rssi_change_db) {
+            change->type = LR1110_AP_RSSI_CHANGED;
+            change->rssi = avg;
+        }
+        else {
+            continue;
+        }
+
+        memcpy(change->mac, entry->mac, LR1110_WIFI_MAC_ADDRESS_LENGTH);
+        count++;
+
+        if (change->type == LR1110_AP_DISAPPEARED) {
+            memset(entry, 0, sizeof(*entry));
+        }
+        else {
+            entry->flags &= ~AP_CACHE_NEW;
+            entry->rssi_reported = avg;
+        }
+    }
+
+    cache->stable_count = count ? 0 : cache->stable_count + 1;
+    return count;
+}
+
+
+/*!
+ * @brief               Looks up cached AP
+ *
+ * @param[in] cache     AP cache
+ * @param[in] mac       MAC address
+ *
+ * @return              Entry, NULL if AP is not cached
+ */
+const struct lr1110_ap_cache_entry *
+lr1110_ap_cache_find(const struct lr1110_ap_cache * cache, const uint8_t * mac)
+{
+    for (uint8_t i = 0; i < cache->size; i++)
+    {
+        if ((cache->entries[i].flags & AP_CACHE_USED) &&
+            !memcmp(cache->entries[i].mac, mac,
+                    LR1110_WIFI_MAC_ADDRESS_LENGTH)) {
+            return &cache->entries[i];
+        }
+    }
+    return NULL;
+}
+
+
+/*!
+ * @brief               Streaming reader callback that feeds basic results
+ *                      into cache passed as user_data
+ */
+bool lr1110_ap_cache_results_cb(void * context,
+                                const lr1110_wifi_basic_complete_result_t * results,
+                                uint8_t start_index,
+                                uint8_t nb_results,
+                                void * user_data)
+{
+    struct lr1110_ap_cache * cache = user_data;
+
+    /* All chunks of one scan share its time, see lr1110_ap_cache_update */
+    if (!start_index) {
+        cache->scan_ms = k_uptime_get_32();
+    }
+
+    for (uint8_t i = 0; i < nb_results; i++)
+    {
+        struct lr1110_wifi_ap ap;
+
+        lr1110_wifi_ap_from_basic(&results[i], &ap);
+        lr1110_ap_cache_update(cache, &ap, 1, cache->scan_ms);
+    }
+    return true;
+}
+
+
+/*!
+ * @brief               Streaming reader callback that feeds extended results
+ *                      into cache passed as user_data
+ */
+bool lr1110_ap_cache_ext_results_cb(void * context,
+                                    const lr1110_wifi_extended_full_result_t * results,
+                                    uint8_t start_index,
+                                    uint8_t nb_results,
+                                    void * user_data)
+{
+    struct lr1110_ap_cache * cache = user_data;
+
+    /* All chunks of one scan share its time, see lr1110_ap_cache_update */
+    if (!start_index) {
+        cache->scan_ms = k_uptime_get_32();
+    }
+
+    for (uint8_t i = 0; i < nb_results; i++)
+    {
+        struct lr1110_wifi_ap ap;
+
+        lr1110_wifi_ap_from_ext(&results[i], &ap);
+        lr1110_ap_cache_update(cache, &ap, 1, cache->scan_ms);
+    }
+    return true;
+}
+
+/* -------------------------------------------------------------------------
+ * PRIVATE IMPLEMENTATIONS
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * @brief               Finds entry for MAC address, or takes a free one, or
+ *                      evicts least recently seen one that was not seen at
+ *                      now_ms
+ *
+ * @return              Entry, not used entry is zeroed. NULL if all entries
+ *                      were seen at now_ms.
+ */
+static struct lr1110_ap_cache_entry * get_entry(struct lr1110_ap_cache * cache,
+                                                const uint8_t * mac,
+                                                uint32_t now_ms)
+{
+    struct lr1110_ap_cache_entry * found =
+        (struct lr1110_ap_cache_entry *) lr1110_ap_cache_find(cache, mac);
+    struct lr1110_ap_cache_entry * oldest = NULL;
+
+    if (found) {
+        return found;
+    }
+
+    for (uint8_t i = 0; i < cache->size; i++)
+    {
+        struct lr1110_ap_cache_entry * entry = &cache->entries[i];
+
+        if (!(entry->flags & AP_CACHE_USED)) {
+            return entry;
+        }
+        /* Seen in current scan */
+        if (entry->last_seen_ms == now_ms) {
+            continue;
+        }
+        if (!oldest ||
+            (int32_t) (entry->last_seen_ms - oldest->last_seen_ms) < 0) {
+            oldest = entry;
+        }
+    }
+
+    if (!oldest) {
+        return NULL;
+    }
+    if (!(oldest->flags & AP_CACHE_NEW)) {
+        cache->evicted++;
+    }
+    memset(oldest, 0, sizeof(*oldest));
+    return oldest;
+}
+
+
+/*!
+ * @brief               Updates entry statistics with one observation
+ */
+static void add_sample(struct lr1110_ap_cache_entry * entry,
+                       const struct lr1110_wifi_ap * ap,
+                       uint32_t now_ms)
+{
+    if (!(entry->flags & AP_CACHE_USED)) {
+        memcpy(entry->mac, ap->mac, LR1110_WIFI_MAC_ADDRESS_LENGTH);
+        entry->flags = AP_CACHE_USED | AP_CACHE_NEW;
+        entry->first_seen_ms = now_ms;
+        entry->rssi_min = ap->rssi;
+        entry->rssi_max = ap->rssi;
+        entry->rssi_avg_q4 = ap->rssi * 16;
+    }
+
+    entry->channel = ap->channel;
+    entry->rssi_last = ap->rssi;
+    entry->rssi_min = MIN(entry->rssi_min, ap->rssi);
+    entry->rssi_max = MAX(entry->rssi_max, ap->rssi);
+    entry->rssi_avg_q4 += (ap->rssi * 16 - entry->rssi_avg_q4) /
+                          (1 << AP_CACHE_AVG_SHIFT);
+    entry->last_seen_ms = now_ms;
+
+    if (entry->hit_count < UINT16_MAX) {
+        entry->hit_count++;
+    }
+}
+
+
+/*!
+ * @brief               Average RSSI, rounded to whole dB
+ */
+static int8_t rssi_avg(const struct lr1110_ap_cache_entry * entry)
+{
+    return (entry->rssi_avg_q4 - 8) / 16;
+}
+
+/*** end of file ***/
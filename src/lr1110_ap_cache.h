@@ -0,0 +1,114 @@
+/** @file lr1110_ap_cache.h
+ *
+ * @brief       Fixed size cache of observed wifi access points. Keeps RSSI
+ *              statistics per AP and reports only APs that appeared,
+ *              disappeared or changed RSSI since last report, so unchanged
+ *              environment does not have to be sent again.
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 Irnas.  All rights reserved.
+ */
+
+#ifndef LR1110_AP_CACHE_H
+#define LR1110_AP_CACHE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "lr1110_wifi_codec.h"
+
+/*!
+ * @brief Cached access point
+ */
+struct lr1110_ap_cache_entry {
+    uint8_t mac[LR1110_WIFI_MAC_ADDRESS_LENGTH];
+    uint8_t channel;
+    uint8_t flags;
+    int8_t rssi_last;
+    int8_t rssi_min;
+    int8_t rssi_max;
+    int8_t rssi_reported;   /* Average RSSI at the time of last report */
+    int16_t rssi_avg_q4;    /* Moving average, in 1/16 dBm */
+    uint16_t hit_count;
+    uint32_t first_seen_ms;
+    uint32_t last_seen_ms;
+};
+
+/*!
+ * @brief Cache, storage is provided by LR1110_AP_CACHE_DEFINE
+ */
+struct lr1110_ap_cache {
+    struct lr1110_ap_cache_entry * entries;
+    uint8_t size;
+    uint8_t rssi_change_db;     /* Average RSSI change that is reported */
+    uint32_t max_age_ms;        /* APs not seen for longer disappear */
+    uint16_t stable_count;      /* Consecutive change queries with no change */
+    uint16_t evicted;           /* Reported APs evicted before they could be
+                                 * reported as disappeared */
+    uint16_t dropped;           /* APs not cached, as cache was full of APs
+                                 * from the same scan */
+    uint32_t scan_ms;           /* Time of scan fed by results callbacks */
+};
+
+enum lr1110_ap_change_type {
+    LR1110_AP_APPEARED = 0,
+    LR1110_AP_DISAPPEARED,
+    LR1110_AP_RSSI_CHANGED,
+};
+
+struct lr1110_ap_change {
+    uint8_t mac[LR1110_WIFI_MAC_ADDRESS_LENGTH];
+    enum lr1110_ap_change_type type;
+    int8_t rssi;                /* Average RSSI, last one for disappeared */
+};
+
+/*!
+ * @brief Defines cache with n entries
+ *
+ * @param name      Name of cache variable
+ * @param n         Number of cached APs, at most 255
+ * @param age_ms    APs not seen for longer than this are reported as
+ *                  disappeared and evicted
+ * @param rssi_db   Change of average RSSI, in dB, that is reported
+ */
+#define LR1110_AP_CACHE_DEFINE(name, n, age_ms, rssi_db)                       \
+    static struct lr1110_ap_cache_entry name##_entries[n];                     \
+    struct lr1110_ap_cache name = {                                            \
+        .entries = name##_entries,                                             \
+        .size = (n),                                                           \
+        .rssi_change_db = (rssi_db),                                           \
+        .max_age_ms = (age_ms),                                                \
+    }
+
+void lr1110_ap_cache_clear(struct lr1110_ap_cache * cache);
+void lr1110_ap_cache_update(struct lr1110_ap_cache * cache,
+                            const struct lr1110_wifi_ap * aps,
+                            uint8_t nb_aps,
+                            uint32_t now_ms);
+int lr1110_ap_cache_get_changes(struct lr1110_ap_cache * cache,
+                                uint32_t now_ms,
+                                struct lr1110_ap_change * changes,
+                                uint8_t max_changes);
+const struct lr1110_ap_cache_entry *
+lr1110_ap_cache_find(const struct lr1110_ap_cache * cache, const uint8_t * mac);
+
+bool lr1110_ap_cache_results_cb(void * context,
+                                const lr1110_wifi_basic_complete_result_t * results,
+                                uint8_t start_index,
+                                uint8_t nb_results,
+                                void * user_data);
+bool lr1110_ap_cache_ext_results_cb(void * context,
+                                    const lr1110_wifi_extended_full_result_t * results,
+                                    uint8_t start_index,
+                                    uint8_t nb_results,
+                                    void * user_data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LR1110_AP_CACHE_H */
+/*** end of file ***/
@@ -0,0 +1,309 @@
+/** @file lr1110_benchmark.c
+ *
+ * @brief       Benchmark of the HAL and wrapper layers.
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 Irnas.  All rights reserved.
+ */
+
+#include <zephyr.h>
+#include <string.h>
+#include "lr1110.h"
+#include "lr1110_benchmark.h"
+
+/* -------------------------------------------------------------------------
+ * PRIVATE VARIABLES
+ * ------------------------------------------------------------------------- */
+
+#ifndef LR1110_BENCHMARK_ITERATIONS
+#define LR1110_BENCHMARK_ITERATIONS     10
+#endif
+
+/* Number of results read by fetch benchmarks */
+static const uint8_t fetch_sizes[] = { 1, 2, 4, 8, 16, 32 };
+
+/* Fetched results, only one of the formats is used at a time */
+static union {
+    lr1110_wifi_basic_complete_result_t basic[LR1110_WIFI_MAX_RESULTS];
+    lr1110_wifi_extended_full_result_t ext[LR1110_WIFI_MAX_RESULTS];
+} results;
+
+/*!
+ * @brief Sums of one measurement over all iterations
+ */
+struct benchmark_acc {
+    struct lr1110_benchmark_result result;
+    uint64_t wall_us;
+    uint64_t hal_calls;
+    uint64_t spi_bytes;
+    uint64_t busy_us;
+    struct lr1110_hal_snapshot snapshot;    /* Iteration in progress */
+};
+
+/* -------------------------------------------------------------------------
+ * PRIVATE PROTOTYPES
+ * ------------------------------------------------------------------------- */
+static void benchmark_start(struct benchmark_acc * acc,
+                            const char * name,
+                            uint8_t nb_results);
+static void benchmark_begin(void * context, struct benchmark_acc * acc);
+static void benchmark_end(void * context, struct benchmark_acc * acc);
+static void benchmark_report(struct benchmark_acc * acc,
+                             lr1110_benchmark_cb_t cb,
+                             void * user_data);
+static int benchmark_fetch(void * context,
+                           const struct lr1110_benchmark_cfg * cfg,
+                           lr1110_wifi_mode_t scan_mode,
+                           lr1110_benchmark_cb_t cb,
+                           void * user_data);
+
+/* -------------------------------------------------------------------------
+ * PUBLIC IMPLEMENTATIONS
+ * ------------------------------------------------------------------------- */
+
+struct lr1110_benchmark_cfg lr1110_benchmark_default_cfg(void)
+{
+    struct lr1110_benchmark_cfg cfg = {
+        .iterations     = LR1110_BENCHMARK_ITERATIONS,
+        .autotune       = true,
+        .wifi_settings  = lr1110_get_default_wifi_settings(),
+    };
+    return cfg;
+}
+
+
+/*!
+ * @brief               Runs all measurements. Radio is initialized by the
+ *                      benchmark, context only has to be configured.
+ *                      Fetch benchmarks read results of a real scan, so
+ *                      sizes above number of found APs are skipped.
+ *
+ * @param[in] context   Radio abstraction
+ * @param[in] cfg       Configuration, NULL for default one
+ * @param[in] cb        Called for each measurement
+ * @param[in] user_data Passed to callback
+ *
+ * @return              Number of reported measurements
+ */
+int lr1110_benchmark_run(void * context,
+                         const struct lr1110_benchmark_cfg * cfg,
+                         lr1110_benchmark_cb_t cb,
+                         void * user_data)
+{
+    struct lr1110_benchmark_cfg default_cfg = lr1110_benchmark_default_cfg();
+    struct benchmark_acc acc;
+    int count = 0;
+
+    if (!cfg) {
+        cfg = &default_cfg;
+    }
+
+    /* Init, each iteration resets the radio */
+    benchmark_start(&acc, "init", 0);
+    for (uint16_t i = 0; i < cfg->iterations; i++)
+    {
+        benchmark_begin(context, &acc);
+        lr1110_init(context);
+        benchmark_end(context, &acc);
+    }
+    benchmark_report(&acc, cb, user_data);
+    count++;
+
+    if (cfg->autotune) {
+        struct lr1110_spi_tune_result tune_result;
+
+        lr1110_spi_autotune(context, &tune_result);
+    }
+    lr1110_init_wifi_scan(context);
+
+    /* Version read, shortest command with response */
+    benchmark_start(&acc, "version", 0);
+    for (uint16_t i = 0; i < cfg->iterations; i++)
+    {
+        lr1110_system_version_t version;
+
+        benchmark_begin(context, &acc);
+        lr1110_get_trx_version(context, &version);
+        benchmark_end(context, &acc);
+    }
+    benchmark_report(&acc, cb, user_data);
+    count++;
+
+    /* Extended results come from full beacon scans, basic from the rest */
+    count += benchmark_fetch(context, cfg, LR1110_WIFI_SCAN_MODE_FULL_BEACON,
+                             cb, user_data);
+    count += benchmark_fetch(context, cfg, LR1110_WIFI_SCAN_MODE_BEACON,
+                             cb, user_data);
+    return count;
+}
+
+
+/*!
+ * @brief               Prints format version and column names of CSV
+ *                      printed by lr1110_benchmark_print_cb
+ */
+void lr1110_benchmark_print_header(void)
+{
+    printk("# lr1110 benchmark, format %d\n",
+           LR1110_BENCHMARK_FORMAT_VERSION);
+    printk("result,name,nb_results,iterations,wall_min_us,wall_avg_us,"
+           "wall_max_us,hal_calls,spi_bytes,busy_us\n");
+}
+
+
+/*!
+ * @brief               Prints conditions of the run, board, radio firmware
+ *                      and SPI clock, as one CSV line
+ *
+ * @param[in] context   Radio abstraction, initialized
+ */
+void lr1110_benchmark_print_meta(void * context)
+{
+    lr1110_system_version_t version = {0};
+
+    lr1110_get_trx_version(context, &version);
+    printk("meta,%s,0x%02X,0x%02X,0x%04X,%u\n",
+           CONFIG_BOARD, version.hw, version.type, version.fw,
+           lr1110_spi_get_frequency(context));
+}
+
+
+/*!
+ * @brief               Benchmark callback that prints each measurement as
+ *                      one CSV line
+ */
+void lr1110_benchmark_print_cb(const struct lr1110_benchmark_result * result,
+                               void * user_data)
+{
+    printk("result,%s,%u,%u,%u,%u,%u,%u,%u,%u\n",
+           result->name, result->nb_results, result->iterations,
+           result->wall_min_us, result->wall_avg_us, result->wall_max_us,
+           result->hal_calls, result->spi_bytes, result->busy_us);
+}
+
+/* -------------------------------------------------------------------------
+ * PRIVATE IMPLEMENTATIONS
+ * ------------------------------------------------------------------------- */
+
+static void benchmark_start(struct benchmark_acc * acc,
+                            const char * name,
+                            uint8_t nb_results)
+{
+    memset(acc, 0, sizeof(*acc));
+    acc->result.name = name;
+    acc->result.nb_results = nb_results;
+    acc->result.wall_min_us = UINT32_MAX;
+}
+
+
+static void benchmark_begin(void * context, struct benchmark_acc * acc)
+{
+    lr1110_hal_traffic_begin(context, &acc->snapshot);
+}
+
+
+/*!
+ * @brief               Adds time and HAL traffic since benchmark_begin.
+ *                      Traffic of the iteration is taken on its own, as
+ *                      its wall time is needed for minimum and maximum.
+ */
+static void benchmark_end(void * context, struct benchmark_acc * acc)
+{
+    struct lr1110_hal_traffic traffic = {0};
+
+    lr1110_hal_traffic_end(context, &acc->snapshot, &traffic);
+
+    acc->result.iterations++;
+    acc->result.wall_min_us = MIN(acc->result.wall_min_us,
+                                  traffic.duration_us);
+    acc->result.wall_max_us = MAX(acc->result.wall_max_us,
+                                  traffic.duration_us);
+    acc->wall_us += traffic.duration_us;
+    acc->hal_calls += traffic.hal_calls;
+    acc->spi_bytes += traffic.spi_bytes;
+    acc->busy_us += traffic.busy_us;
+}
+
+
+static void benchmark_report(struct benchmark_acc * acc,
+                             lr1110_benchmark_cb_t cb,
+                             void * user_data)
+{
+    uint16_t n = acc->result.iterations;
+
+    if (!n) {
+        return;
+    }
+
+    acc->result.wall_avg_us = acc->wall_us / n;
+    acc->result.hal_calls = acc->hal_calls / n;
+    acc->result.spi_bytes = acc->spi_bytes / n;
+    acc->result.busy_us = acc->busy_us / n;
+
+    if (cb) {
+        cb(&acc->result, user_data);
+    }
+}
+
+
+/*!
+ * @brief               Measures scan round trip in given mode, then reads
+ *                      results of last scan in increasing amounts
+ *
+ * @return              Number of reported measurements
+ */
+static int benchmark_fetch(void * context,
+                           const struct lr1110_benchmark_cfg * cfg,
+                           lr1110_wifi_mode_t scan_mode,
+                           lr1110_benchmark_cb_t cb,
+                           void * user_data)
+{
+    bool ext = scan_mode == LR1110_WIFI_SCAN_MODE_FULL_BEACON;
+    struct wifi_settings wifi_settings = cfg->wifi_settings;
+    struct wifi_diagnostics wifi_diagnostics = {0};
+    struct benchmark_acc acc;
+    int count = 0;
+
+    wifi_settings.scan_mode = scan_mode;
+
+    benchmark_start(&acc, ext ? "scan_full_beacon" : "scan_beacon", 0);
+    for (uint16_t i = 0; i < cfg->iterations; i++)
+    {
+        benchmark_begin(context, &acc);
+        wifi_diagnostics = lr1110_execute_wifi_scan(context, wifi_settings);
+        benchmark_end(context, &acc);
+    }
+    benchmark_report(&acc, cb, user_data);
+    count++;
+
+    for (uint8_t s = 0; s < ARRAY_SIZE(fetch_sizes); s++)
+    {
+        uint8_t nb_results = fetch_sizes[s];
+        struct wifi_diagnostics fetch_diagnostics = wifi_diagnostics;
+
+        if (nb_results > wifi_diagnostics.num_wifi_results) {
+            break;
+        }
+        fetch_diagnostics.num_wifi_results = nb_results;
+
+        benchmark_start(&acc, ext ? "fetch_ext" : "fetch_basic", nb_results);
+        for (uint16_t i = 0; i < cfg->iterations; i++)
+        {
+            benchmark_begin(context, &acc);
+            if (ext) {
+                lr1110_get_ext_wifi_scan_results(context, fetch_diagnostics,
+                                                 results.ext);
+            }
+            else {
+                lr1110_get_wifi_scan_results(context, fetch_diagnostics,
+                                             results.basic);
+            }
+            benchmark_end(context, &acc);
+        }
+        benchmark_report(&acc, cb, user_data);
+        count++;
+    }
+    return count;
+}
+
+/*** end of file ***/
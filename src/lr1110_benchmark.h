@@ -0,0 +1,75 @@
+/** @file lr1110_benchmark.h
+ *
+ * @brief       Benchmark of the HAL and wrapper layers. Measures init,
+ *              version read, wifi scan round trip and reading 1 to 32
+ *              basic or extended results. Reports wall time, HAL calls,
+ *              SPI bytes and BUSY wait time of each, as CSV lines that can
+ *              be compared between releases. Runs the same on target and
+ *              against the host simulator.
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 Irnas.  All rights reserved.
+ */
+
+#ifndef LR1110_BENCHMARK_H
+#define LR1110_BENCHMARK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "lr1110_wifi_scan.h"
+
+/* Version of output format, increased when columns change */
+#define LR1110_BENCHMARK_FORMAT_VERSION     1
+
+/*!
+ * @brief Benchmark configuration
+ */
+struct lr1110_benchmark_cfg {
+    uint16_t iterations;                /* Runs of each measurement */
+    bool autotune;                      /* Tune SPI clock after init */
+    struct wifi_settings wifi_settings; /* Scan mode is set per benchmark */
+};
+
+/*!
+ * @brief Result of one measurement, per iteration values are averages
+ */
+struct lr1110_benchmark_result {
+    const char * name;
+    uint8_t nb_results;         /* Results read, 0 if not a fetch */
+    uint16_t iterations;
+    uint32_t wall_min_us;
+    uint32_t wall_avg_us;
+    uint32_t wall_max_us;
+    uint32_t hal_calls;         /* Per iteration */
+    uint32_t spi_bytes;         /* Per iteration */
+    uint32_t busy_us;           /* Per iteration */
+};
+
+/*!
+ * @brief Called for each finished measurement
+ */
+typedef void (*lr1110_benchmark_cb_t)(
+    const struct lr1110_benchmark_result * result,
+    void * user_data);
+
+struct lr1110_benchmark_cfg lr1110_benchmark_default_cfg(void);
+int lr1110_benchmark_run(void * context,
+                         const struct lr1110_benchmark_cfg * cfg,
+                         lr1110_benchmark_cb_t cb,
+                         void * user_data);
+
+void lr1110_benchmark_print_header(void);
+void lr1110_benchmark_print_meta(void * context);
+void lr1110_benchmark_print_cb(const struct lr1110_benchmark_result * result,
+                               void * user_data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LR1110_BENCHMARK_H */
+/*** end of file ***/
@@ -12,6 +12,9 @@
 #include "lr1110.h"
 #include "lr1110_configs.h"
 
+/* Contexts of devicetree builds are defined with LR1110_DT_DEFINE */
+#if !DT_HAS_COMPAT_STATUS_OKAY(semtech_lr1110)
+
 /* -------------------------------------------------------------------------
  * PRIVATE VARIABLES
  * ------------------------------------------------------------------------- */
@@ -181,7 +184,7 @@ static port_pin_t create_port_pin(port_label_t port, gpio_pin_t pin)
             while(1);
         break; 
     }
-    struct device * port_device = (struct device *) device_get_binding(port_label);
+    const struct device * port_device = device_get_binding(port_label);
 
     port_pin_t created_port_pin = {
         .port = port_device, 
@@ -189,4 +192,6 @@ static port_pin_t create_port_pin(port_label_t port, gpio_pin_t pin)
     };
     return created_port_pin;
 }
+
+#endif /* !DT_HAS_COMPAT_STATUS_OKAY(semtech_lr1110) */
 /*** end of file ***/
@@ -15,7 +15,100 @@
 extern "C" {
 #endif
 
+#include <devicetree.h>
+#include <device.h>
+
+/* Hard-coded board configs are only a fallback for builds without
+ * "semtech,lr1110" devicetree node */
+#if !DT_HAS_COMPAT_STATUS_OKAY(semtech_lr1110)
 void lr1110_set_config(void * context, const char * device);
+#endif
+
+/*!
+ * @brief Helpers for LR1110_DT_DEFINE, not to be used directly
+ */
+#define LR1110_DT_PORT_PIN(node_id, prop)                                      \
+    {                                                                          \
+        .port = DEVICE_DT_GET(DT_GPIO_CTLR(node_id, prop)),                    \
+        .pin = DT_GPIO_PIN(node_id, prop),                                     \
+    }
+
+#define LR1110_DT_PORT_PIN_OR_NONE(node_id, prop)                              \
+    COND_CODE_1(DT_NODE_HAS_PROP(node_id, prop),                               \
+                (LR1110_DT_PORT_PIN(node_id, prop)),                           \
+                ({ .port = NULL }))
+
+/* Pins are driven and read by level, port_pin_t has no room for flags */
+#define LR1110_DT_ASSERT_NO_FLAGS(node_id, prop)                               \
+    BUILD_ASSERT(DT_GPIO_FLAGS(node_id, prop) == 0,                            \
+                 "LR1110 " #prop " has to be GPIO_ACTIVE_HIGH without flags")
+
+#define LR1110_DT_ASSERT_NO_FLAGS_OR_NONE(node_id, prop)                       \
+    COND_CODE_1(DT_NODE_HAS_PROP(node_id, prop),                               \
+                (LR1110_DT_ASSERT_NO_FLAGS(node_id, prop);),                   \
+                ())
+
+#define LR1110_DT_RF_SWITCH_DEFINE(node_id, name)                              \
+    COND_CODE_1(DT_NODE_HAS_PROP(node_id, rfswitch_enable),                    \
+        (static const lr1110_system_rfswitch_cfg_t name##_rf_switch_cfg = {    \
+            .enable  = DT_PROP(node_id, rfswitch_enable),                      \
+            .standby = DT_PROP(node_id, rfswitch_standby),                     \
+            .rx      = DT_PROP(node_id, rfswitch_rx),                          \
+            .tx      = DT_PROP(node_id, rfswitch_tx),                          \
+            .tx_hp   = DT_PROP(node_id, rfswitch_tx_hp),                       \
+            .tx_hf   = DT_PROP(node_id, rfswitch_tx_hf),                       \
+            .gnss    = DT_PROP(node_id, rfswitch_gnss),                        \
+            .wifi    = DT_PROP(node_id, rfswitch_wifi),                        \
+        };),                                                                   \
+        ())
+
+#define LR1110_DT_RF_SWITCH_PTR(node_id, name)                                 \
+    COND_CODE_1(DT_NODE_HAS_PROP(node_id, rfswitch_enable),                    \
+                (&name##_rf_switch_cfg),                                       \
+                (NULL))
+
+/*!
+ * @brief Defines radio context with name, built at compile time from
+ *        "semtech,lr1110" devicetree node. No runtime lookup is needed, 
+ *        lr1110_set_device_config should not be called for such context.
+ *        Missing or misconfigured node is reported as build error, as are
+ *        GPIO flags: pins are used by level, event interrupt triggers on
+ *        high level of DIO9, so all of them have to be active high.
+ *
+ * @note  Context also holds runtime state (locks, semaphores, statistics),
+ *        so it is statically initialized instead of const.
+ */
+#define LR1110_DT_DEFINE(node_id, name)                                        \
+    BUILD_ASSERT(DT_NODE_HAS_STATUS(node_id, okay),                            \
+                 "LR1110 devicetree node is not enabled");                     \
+    LR1110_DT_ASSERT_NO_FLAGS(node_id, reset_gpios);                           \
+    LR1110_DT_ASSERT_NO_FLAGS(node_id, nss_gpios);                             \
+    LR1110_DT_ASSERT_NO_FLAGS(node_id, event_gpios);                           \
+    LR1110_DT_ASSERT_NO_FLAGS(node_id, busy_gpios);                            \
+    LR1110_DT_ASSERT_NO_FLAGS_OR_NONE(node_id, lna_gpios)                      \
+    LR1110_DT_RF_SWITCH_DEFINE(node_id, name)                                  \
+    lr1110_t name = {                                                          \
+        .reset = LR1110_DT_PORT_PIN(node_id, reset_gpios),                     \
+        .nss   = LR1110_DT_PORT_PIN(node_id, nss_gpios),                       \
+        .event = LR1110_DT_PORT_PIN(node_id, event_gpios),                     \
+        .busy  = LR1110_DT_PORT_PIN(node_id, busy_gpios),                      \
+        .lna   = LR1110_DT_PORT_PIN_OR_NONE(node_id, lna_gpios),               \
+        .rf_switch_cfg = LR1110_DT_RF_SWITCH_PTR(node_id, name),               \
+        .event_interrupt_cb = NULL,                                            \
+        .event_trigger_type = GPIO_INT_LEVEL_HIGH,                             \
+        .spi_dev = DEVICE_DT_GET(DT_BUS(node_id)),                             \
+        .spi_max_frequency = DT_PROP(node_id, spi_max_frequency),              \
+        .spi_cfg = {                                                           \
+            { .slave = DT_REG_ADDR(node_id) },                                 \
+        },                                                                     \
+    }
+
+/*!
+ * @brief Same as LR1110_DT_DEFINE, for instance number inst of 
+ *        "semtech,lr1110" compatible.
+ */
+#define LR1110_DT_INST_DEFINE(inst, name)                                      \
+    LR1110_DT_DEFINE(DT_INST(inst, semtech_lr1110), name)
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,470 @@
+/** @file lr1110_gnss_scan.c
+ *
+ * @brief       Module containing various function wrappers for GNSS scanning.
+ *
+ *              Scan outcome is a NAV message, which is passed to a solver
+ *              (for example LoRa Cloud) that computes position. First byte
+ *              of the message is its destination, see
+ *              lr1110_gnss_destination_t.
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 Irnas.  All rights reserved.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include "lr1110_gnss_scan.h"
+#include "lr1110.h"
+
+/* -------------------------------------------------------------------------
+ * PRIVATE VARIABLES
+ * ------------------------------------------------------------------------- */
+
+/* Scan duration is decided by the radio, this covers the slowest
+ * autonomous scan */
+#ifndef LR1110_GNSS_SCAN_TIMEOUT_MS
+#define LR1110_GNSS_SCAN_TIMEOUT_MS     30000
+#endif
+
+/* States of lr1110_gnss_scan_async */
+enum {
+    GNSS_ASYNC_IDLE = 0,
+    GNSS_ASYNC_RUNNING,
+    GNSS_ASYNC_FINISHING,
+};
+
+/* -------------------------------------------------------------------------
+ * PRIVATE PROTOTYPES
+ * ------------------------------------------------------------------------- */
+static lr1110_status_t lr1110_gnss_start(void * context,
+                                         struct gnss_settings gnss_settings);
+static int lr1110_gnss_scan_done(void * context,
+                                 uint32_t start_scan,
+                                 struct gnss_diagnostics * gnss_diagnostics);
+static void lr1110_gnss_abort(void * context);
+static void lr1110_gnss_async_done_handler(struct k_work * work);
+static void lr1110_gnss_async_timeout_handler(struct k_work * work);
+static void lr1110_gnss_async_abort(struct lr1110_gnss_scan_async * async,
+                                    int status);
+
+/* -------------------------------------------------------------------------
+ * PUBLIC IMPLEMENTATIONS
+ * ------------------------------------------------------------------------- */
+struct gnss_settings lr1110_get_default_gnss_settings()
+{
+    struct gnss_settings gnss_settings = {
+        .scan_mode              = LR1110_GNSS_SCAN_AUTONOMOUS,
+        .constellations         = LR1110_GNSS_GPS_MASK |
+                                  LR1110_GNSS_BEIDOU_MASK,
+        .search_mode            = LR1110_GNSS_OPTION_DEFAULT,
+        .input_parameters       = 0,    /* Pseudo ranges only */
+        .max_satellites         = 0,
+        .gps_time               = 0,
+        .assistance_position    = { 0 },
+        .timeout_in_ms          = LR1110_GNSS_SCAN_TIMEOUT_MS,
+    };
+    return gnss_settings;
+}
+
+
+/*!
+ * @brief                   Runs GNSS scan, calling thread sleeps until
+ *                          GNSS_SCAN_DONE event interrupt
+ *
+ * @param[in] context       Radio abstraction
+ * @param[in] gnss_settings Scan settings, assisted scan needs valid time
+ *                          and assistance position
+ *
+ * @return                  Diagnostics, zeroed if scan failed
+ *
+ * @note                    Radio stays locked for the whole scan, same as
+ *                          in lr1110_execute_wifi_scan. Applications with
+ *                          several radio users should use 
+ *                          lr1110_start_gnss_scan.
+ */
+struct gnss_diagnostics
+lr1110_execute_gnss_scan(void * context, struct gnss_settings gnss_settings)
+{
+    struct gnss_diagnostics gnss_diagnostics = {0};
+
+    lr1110_lock(context, K_FOREVER);
+
+    lr1110_prepare_event(context, LR1110_SYSTEM_IRQ_GNSS_SCAN_DONE);
+
+    uint32_t start_scan = k_uptime_get();
+
+    if (lr1110_gnss_start(context, gnss_settings)) {
+        printk("Starting GNSS scan failed\n");
+        lr1110_gnss_abort(context);
+    }
+    else if (lr1110_wait_for_event(context, gnss_settings.timeout_in_ms)) {
+        printk("GNSS scan timeout\n");
+        lr1110_gnss_abort(context);
+    }
+    else {
+        lr1110_clear_event(context, LR1110_SYSTEM_IRQ_GNSS_SCAN_DONE);
+        if (lr1110_gnss_scan_done(context, start_scan, &gnss_diagnostics)) {
+            printk("Reading GNSS scan outcome failed\n");
+        }
+    }
+
+    lr1110_unlock(context);
+    return gnss_diagnostics;
+}
+
+
+/*!
+ * @brief                   Starts GNSS scan and returns immediately. Scan
+ *                          outcome is reported through callback, which is
+ *                          called from radio work queue.
+ *
+ * @param[in] context       Radio abstraction
+ * @param[in] gnss_settings Scan settings
+ * @param[in] async         Scan state, has to stay valid until callback
+ * @param[in] cb            Called once with 0, -EIO, -ETIMEDOUT or 
+ *                          -ECANCELED
+ * @param[in] user_data     Passed to callback
+ *
+ * @return                  0 if scan was started, -EBUSY if this async
+ *                          object is already in use, -EIO on radio error.
+ *
+ * @note                    Same locking rules as lr1110_start_wifi_scan.
+ */
+int lr1110_start_gnss_scan(void * context,
+                           struct gnss_settings gnss_settings,
+                           struct lr1110_gnss_scan_async * async,
+                           lr1110_gnss_scan_cb_t cb,
+                           void * user_data)
+{
+    if (!atomic_cas(&async->state, GNSS_ASYNC_IDLE, GNSS_ASYNC_RUNNING)) {
+        return -EBUSY;
+    }
+
+    if (async->context == NULL) {
+        k_work_init(&async->done_work, lr1110_gnss_async_done_handler);
+        k_work_init_delayable(&async->timeout_work,
+                              lr1110_gnss_async_timeout_handler);
+    }
+    async->context = context;
+    async->cb = cb;
+    async->user_data = user_data;
+
+    lr1110_lock(context, K_FOREVER);
+
+    async->start_scan = k_uptime_get();
+
+    if (lr1110_irq_register(context, LR1110_IRQ_SOURCE_GNSS,
+                            LR1110_SYSTEM_IRQ_GNSS_SCAN_DONE,
+                            &async->done_work) ||
+        lr1110_gnss_start(context, gnss_settings)) {
+        lr1110_irq_unregister(context, LR1110_IRQ_SOURCE_GNSS,
+                              &async->done_work);
+        lr1110_gnss_abort(context);
+        lr1110_unlock(context);
+        atomic_set(&async->state, GNSS_ASYNC_IDLE);
+        return -EIO;
+    }
+
+    lr1110_unlock(context);
+
+    k_work_schedule_for_queue(lr1110_irq_work_queue(context),
+                              &async->timeout_work,
+                              K_MSEC(gnss_settings.timeout_in_ms));
+    return 0;
+}
+
+
+/*!
+ * @brief                   Cancels scan started with lr1110_start_gnss_scan.
+ *                          Callback is called with -ECANCELED before this
+ *                          function returns.
+ *
+ * @param[in] async         Scan state
+ *
+ * @return                  0 on success, -EALREADY if scan is not running.
+ */
+int lr1110_cancel_gnss_scan(struct lr1110_gnss_scan_async * async)
+{
+    if (!atomic_cas(&async->state, GNSS_ASYNC_RUNNING, GNSS_ASYNC_FINISHING)) {
+        return -EALREADY;
+    }
+
+    k_work_cancel_delayable(&async->timeout_work);
+    k_work_cancel(&async->done_work);
+    lr1110_gnss_async_abort(async, -ECANCELED);
+    return 0;
+}
+
+
+/*!
+ * @brief                   Reads NAV message of last scan directly into
+ *                          caller buffer
+ *
+ * @param[in] context       Radio abstraction
+ * @param[in] gnss_diagnostics  Diagnostics of finished scan
+ * @param[out] buffer       Buffer for NAV message
+ * @param[in] buffer_size   Size of buffer, LR1110_GNSS_MAX_SIZE_ARRAY fits
+ *                          any message
+ *
+ * @return                  Message size, 0 if there is none, -ENOMEM if
+ *                          buffer is too small, -EIO if reading failed.
+ */
+int lr1110_get_gnss_scan_results(void * context,
+                                 struct gnss_diagnostics gnss_diagnostics,
+                                 uint8_t * buffer,
+                                 uint16_t buffer_size)
+{
+    lr1110_status_t status;
+
+    if (gnss_diagnostics.result_size == 0) {
+        return 0;
+    }
+    if (gnss_diagnostics.result_size > buffer_size) {
+        return -ENOMEM;
+    }
+
+    lr1110_lock(context, K_FOREVER);
+    status = lr1110_gnss_read_results(context, buffer,
+                                      gnss_diagnostics.result_size);
+    lr1110_unlock(context);
+
+    return status ? -EIO : gnss_diagnostics.result_size;
+}
+
+
+/*!
+ * @brief                   Reads satellites detected by last scan, with
+ *                          their C/N0
+ *
+ * @param[in] context       Radio abstraction
+ * @param[in] gnss_diagnostics  Diagnostics of finished scan
+ * @param[out] satellites   Array for satellites
+ * @param[in] max_satellites Size of array
+ *
+ * @return                  Number of satellites read, -EIO if reading
+ *                          failed.
+ */
+int lr1110_get_gnss_detected_satellites(
+    void * context,
+    struct gnss_diagnostics gnss_diagnostics,
+    lr1110_gnss_detected_satellite_t * satellites,
+    uint8_t max_satellites)
+{
+    uint8_t nb = MIN(gnss_diagnostics.nb_detected_satellites, max_satellites);
+    lr1110_status_t status = LR1110_STATUS_OK;
+
+    if (nb) {
+        lr1110_lock(context, K_FOREVER);
+        status = lr1110_gnss_get_detected_satellites(context, nb, satellites);
+        lr1110_unlock(context);
+    }
+
+    return status ? -EIO : nb;
+}
+
+
+void lr1110_print_gnss_diagnostics(struct gnss_diagnostics gnss_diagnostics)
+{
+    printk("*** GNSS scan ***\n"
+           "Scan duration:          %d ms\n"
+           "Radio timing:           radio %d ms, computation %d ms\n"
+           "Satellites:             %d, best C/N0 %d dB, average %d dB\n"
+           "NAV message:            %d bytes\n"
+           "Fetch:                  %d us, %d HAL calls, %d SPI bytes\n",
+           gnss_diagnostics.gnss_scan_duration,
+           gnss_diagnostics.timings.radio_ms,
+           gnss_diagnostics.timings.computation_ms,
+           gnss_diagnostics.nb_detected_satellites,
+           gnss_diagnostics.cnr_max,
+           gnss_diagnostics.cnr_avg,
+           gnss_diagnostics.result_size,
+           gnss_diagnostics.fetch.duration_us,
+           gnss_diagnostics.fetch.hal_calls,
+           gnss_diagnostics.fetch.spi_bytes);
+}
+
+/* -------------------------------------------------------------------------
+ * PRIVATE IMPLEMENTATIONS
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * @brief                   Configures constellations and sends scan command
+ *
+ * @param[in] context       Radio abstraction
+ * @param[in] gnss_settings Scan settings
+ *
+ * @return                  Driver status
+ */
+static lr1110_status_t lr1110_gnss_start(void * context,
+                                         struct gnss_settings gnss_settings)
+{
+    lr1110_status_t status =
+        lr1110_gnss_set_constellations_to_use(context,
+                                              gnss_settings.constellations);
+
+    if (status) {
+        return status;
+    }
+
+    if (gnss_settings.scan_mode == LR1110_GNSS_SCAN_AUTONOMOUS) {
+        return lr1110_gnss_scan_autonomous(context,
+                                           gnss_settings.gps_time,
+                                           gnss_settings.search_mode,
+                                           gnss_settings.input_parameters,
+                                           gnss_settings.max_satellites);
+    }
+
+    status = lr1110_gnss_set_assistance_position(
+        context, &gnss_settings.assistance_position);
+    if (status) {
+        return status;
+    }
+    return lr1110_gnss_scan_assisted(context,
+                                     gnss_settings.gps_time,
+                                     gnss_settings.search_mode,
+                                     gnss_settings.input_parameters,
+                                     gnss_settings.max_satellites);
+}
+
+
+/*!
+ * @brief                   Collects scan outcome after GNSS_SCAN_DONE event
+ *
+ * @param[in] context       Radio abstraction
+ * @param[in] start_scan    Uptime when scan was started
+ * @param[out] gnss_diagnostics  Timing, satellites and NAV message size
+ *
+ * @return                  0 on success, -EIO if outcome could not be read.
+ *                          C/N0 is left at 0 if only satellites could not 
+ *                          be read.
+ */
+static int lr1110_gnss_scan_done(void * context,
+                                 uint32_t start_scan,
+                                 struct gnss_diagnostics * gnss_diagnostics)
+{
+    lr1110_gnss_detected_satellite_t satellites[LR1110_GNSS_MAX_SATELLITES];
+    struct lr1110_hal_snapshot fetch;
+
+    memset(gnss_diagnostics, 0, sizeof(*gnss_diagnostics));
+    gnss_diagnostics->gnss_scan_duration = k_uptime_get() - start_scan;
+
+    lr1110_hal_traffic_begin(context, &fetch);
+
+    if (lr1110_gnss_get_timings(context, &gnss_diagnostics->timings) ||
+        lr1110_gnss_get_result_size(context, 
+                                    &gnss_diagnostics->result_size) ||
+        lr1110_gnss_get_nb_detected_satellites(
+            context, &gnss_diagnostics->nb_detected_satellites)) {
+        /* Nothing may be read from the radio based on partial outcome */
+        gnss_diagnostics->result_size = 0;
+        gnss_diagnostics->nb_detected_satellites = 0;
+        lr1110_hal_traffic_end(context, &fetch, &gnss_diagnostics->fetch);
+        return -EIO;
+    }
+
+    uint8_t nb = MIN(gnss_diagnostics->nb_detected_satellites,
+                     LR1110_GNSS_MAX_SATELLITES);
+
+    if (nb && !lr1110_gnss_get_detected_satellites(context, nb, satellites)) {
+        int16_t cnr_sum = 0;
+
+        gnss_diagnostics->cnr_max = satellites[0].cnr;
+        for (uint8_t i = 0; i < nb; i++)
+        {
+            gnss_diagnostics->cnr_max = MAX(gnss_diagnostics->cnr_max,
+                                            satellites[i].cnr);
+            cnr_sum += satellites[i].cnr;
+        }
+        gnss_diagnostics->cnr_avg = cnr_sum / nb;
+    }
+
+    lr1110_hal_traffic_end(context, &fetch, &gnss_diagnostics->fetch);
+    return 0;
+}
+
+
+/*!
+ * @brief                   Aborts running scan, so radio is usable again
+ */
+static void lr1110_gnss_abort(void * context)
+{
+    lr1110_system_set_standby(context, LR1110_SYSTEM_STANDBY_CFG_RC);
+    lr1110_clear_event(context, LR1110_SYSTEM_IRQ_GNSS_SCAN_DONE);
+}
+
+
+/*!
+ * @brief                   Work handler, submitted from event interrupt
+ */
+static void lr1110_gnss_async_done_handler(struct k_work * work)
+{
+    struct lr1110_gnss_scan_async * async =
+        CONTAINER_OF(work, struct lr1110_gnss_scan_async, done_work);
+
+    if (!atomic_cas(&async->state, GNSS_ASYNC_RUNNING, GNSS_ASYNC_FINISHING)) {
+        return;
+    }
+    k_work_cancel_delayable(&async->timeout_work);
+
+    lr1110_lock(async->context, K_FOREVER);
+    lr1110_irq_unregister(async->context, LR1110_IRQ_SOURCE_GNSS,
+                          &async->done_work);
+    struct gnss_diagnostics gnss_diagnostics;
+    int status = lr1110_gnss_scan_done(async->context, async->start_scan,
+                                       &gnss_diagnostics);
+    lr1110_unlock(async->context);
+
+    /* Callback can start next scan into the same state once it is idle,
+     * so its arguments are taken before */
+    void * context = async->context;
+    lr1110_gnss_scan_cb_t cb = async->cb;
+    void * user_data = async->user_data;
+
+    atomic_set(&async->state, GNSS_ASYNC_IDLE);
+    cb(context, status, gnss_diagnostics, user_data);
+}
+
+
+/*!
+ * @brief                   Delayed work handler, scan did not finish in time
+ */
+static void lr1110_gnss_async_timeout_handler(struct k_work * work)
+{
+    struct k_work_delayable * dwork = k_work_delayable_from_work(work);
+    struct lr1110_gnss_scan_async * async =
+        CONTAINER_OF(dwork, struct lr1110_gnss_scan_async, timeout_work);
+
+    if (!atomic_cas(&async->state, GNSS_ASYNC_RUNNING, GNSS_ASYNC_FINISHING)) {
+        return;
+    }
+    k_work_cancel(&async->done_work);
+    lr1110_gnss_async_abort(async, -ETIMEDOUT);
+}
+
+
+/*!
+ * @brief                   Stops radio and reports unsuccessful scan
+ */
+static void lr1110_gnss_async_abort(struct lr1110_gnss_scan_async * async,
+                                    int status)
+{
+    struct gnss_diagnostics gnss_diagnostics = {0};
+
+    lr1110_lock(async->context, K_FOREVER);
+    lr1110_irq_unregister(async->context, LR1110_IRQ_SOURCE_GNSS,
+                          &async->done_work);
+    lr1110_gnss_abort(async->context);
+    lr1110_unlock(async->context);
+
+    gnss_diagnostics.gnss_scan_duration = k_uptime_get() - async->start_scan;
+
+    /* Same as in done handler, arguments are taken before state is idle */
+    void * context = async->context;
+    lr1110_gnss_scan_cb_t cb = async->cb;
+    void * user_data = async->user_data;
+
+    atomic_set(&async->state, GNSS_ASYNC_IDLE);
+    cb(context, status, gnss_diagnostics, user_data);
+}
+
+/*** end of file ***/
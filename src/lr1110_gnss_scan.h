@@ -0,0 +1,106 @@
+/** @file lr1110_gnss_scan.h
+ *
+ * @brief       Module containing various function wrappers for GNSS scanning.
+ *
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 Irnas.  All rights reserved.
+ */
+
+#ifndef LR1110_GNSS_SCAN_H
+#define LR1110_GNSS_SCAN_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <zephyr.h>
+#include "lr1110_driver/lr1110_gnss.h"
+#include "lr1110_driver/lr1110_gnss_types.h"
+#include "lr1110_trx_board.h"
+
+/* Largest number of satellites reported by the radio */
+#define LR1110_GNSS_MAX_SATELLITES      32
+
+enum lr1110_gnss_scan_mode {
+    /* No prior knowledge, radio searches for satellites in the whole sky */
+    LR1110_GNSS_SCAN_AUTONOMOUS = 0,
+    /* Uses almanac, time and assistance position, shorter and cheaper */
+    LR1110_GNSS_SCAN_ASSISTED,
+};
+
+struct gnss_settings
+{
+    enum lr1110_gnss_scan_mode scan_mode;
+    lr1110_gnss_constellation_mask_t constellations;
+    lr1110_gnss_search_mode_t search_mode;
+    uint8_t input_parameters;       /* Extra NAV message content */
+    uint8_t max_satellites;         /* 0 for no limit */
+    lr1110_gnss_date_t gps_time;    /* Seconds since GPS epoch */
+    /* Used by assisted scan only */
+    lr1110_gnss_solver_assistance_position_t assistance_position;
+    uint32_t timeout_in_ms;
+};
+
+struct gnss_diagnostics {
+    uint32_t gnss_scan_duration;    /* Scan start to GNSS_SCAN_DONE, in ms */
+    /* Time radio spent receiving and computing, read from the radio */
+    lr1110_gnss_timings_t timings;
+    uint16_t result_size;           /* NAV message size, in bytes */
+    uint8_t nb_detected_satellites;
+    int8_t cnr_max;                 /* Best satellite C/N0, in dB */
+    int8_t cnr_avg;
+    /* Radio traffic of reading scan outcome */
+    struct lr1110_hal_traffic fetch;
+};
+
+/*!
+ * @brief Called from radio work queue when asynchronous scan ends.
+ *        Status is 0 on success, -EIO if scan outcome could not be read,
+ *        -ETIMEDOUT or -ECANCELED otherwise.
+ */
+typedef void (*lr1110_gnss_scan_cb_t)(void * context,
+                                      int status,
+                                      struct gnss_diagnostics gnss_diagnostics,
+                                      void * user_data);
+
+/*!
+ * @brief State of asynchronous GNSS scan, owned by caller. Has to be zero
+ *        initialized before first use.
+ */
+struct lr1110_gnss_scan_async {
+    void * context;
+    lr1110_gnss_scan_cb_t cb;
+    void * user_data;
+    struct k_work done_work;
+    struct k_work_delayable timeout_work;
+    atomic_t state;
+    uint32_t start_scan;
+};
+
+struct gnss_settings lr1110_get_default_gnss_settings();
+struct gnss_diagnostics
+lr1110_execute_gnss_scan(void * context, struct gnss_settings gnss_settings);
+int lr1110_start_gnss_scan(void * context,
+                           struct gnss_settings gnss_settings,
+                           struct lr1110_gnss_scan_async * async,
+                           lr1110_gnss_scan_cb_t cb,
+                           void * user_data);
+int lr1110_cancel_gnss_scan(struct lr1110_gnss_scan_async * async);
+int lr1110_get_gnss_scan_results(void * context,
+                                 struct gnss_diagnostics gnss_diagnostics,
+                                 uint8_t * buffer,
+                                 uint16_t buffer_size);
+int lr1110_get_gnss_detected_satellites(
+    void * context,
+    struct gnss_diagnostics gnss_diagnostics,
+    lr1110_gnss_detected_satellite_t * satellites,
+    uint8_t max_satellites);
+void lr1110_print_gnss_diagnostics(struct gnss_diagnostics gnss_diagnostics);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LR1110_GNSS_SCAN_H */
+/*** end of file ***/
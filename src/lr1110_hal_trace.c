@@ -0,0 +1,155 @@
+/** @file lr1110_hal_trace.c
+ *
+ * @brief       Recorder of HAL transactions.
+ *
+ *              Dump is text, header line starting with '#' and one line
+ *              per record, oldest first:
+ *
+ *              seq cycles type opcode command_length data_length busy_us
+ *              duration_us status payload
+ *
+ *              opcode and payload are hex, payload is '-' when empty.
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 Irnas.  All rights reserved.
+ */
+
+#include <zephyr.h>
+#include <string.h>
+#include "lr1110.h"
+#include "lr1110_hal_trace.h"
+
+#if LR1110_HAL_TRACE
+
+/* -------------------------------------------------------------------------
+ * PUBLIC IMPLEMENTATIONS
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * @brief               Starts recording HAL calls of radio into trace.
+ *                      Trace is cleared.
+ *
+ * @param[in] context   Radio abstraction
+ * @param[in] trace     Trace defined with LR1110_HAL_TRACE_DEFINE
+ */
+void lr1110_hal_trace_start(void * context, struct lr1110_hal_trace * trace)
+{
+    lr1110_lock(context, K_FOREVER);
+    trace->count = 0;
+    ((lr1110_t*) context)->hal_trace = trace;
+    lr1110_unlock(context);
+}
+
+
+/*!
+ * @brief               Stops recording, trace keeps its records
+ *
+ * @param[in] context   Radio abstraction
+ */
+void lr1110_hal_trace_stop(void * context)
+{
+    lr1110_lock(context, K_FOREVER);
+    ((lr1110_t*) context)->hal_trace = NULL;
+    lr1110_unlock(context);
+}
+
+
+/*!
+ * @brief               Prints trace in dump format. Trace should be stopped,
+ *                      or radio locked, while it is dumped.
+ *
+ * @param[in] trace     Trace
+ */
+void lr1110_hal_trace_dump(const struct lr1110_hal_trace * trace)
+{
+    uint32_t count = trace->count;
+    uint32_t first = count > trace->size ? count - trace->size : 0;
+
+    printk("# lr1110 hal trace, format %d, cycles_per_sec %d, "
+           "records %u, dropped %u\n",
+           LR1110_HAL_TRACE_FORMAT_VERSION,
+           sys_clock_hw_cycles_per_sec(), count - first, first);
+
+    for (uint32_t seq = first; seq < count; seq++)
+    {
+        const struct lr1110_hal_trace_record * record =
+            &trace->records[seq % trace->size];
+        uint16_t payload_length = MIN(record->command_length +
+                                      record->data_length,
+                                      LR1110_HAL_TRACE_PAYLOAD);
+
+        printk("%u %u %c %04x %u %u %u %u %u ",
+               seq, record->cycles, record->type, record->opcode,
+               record->command_length, record->data_length,
+               record->busy_us, record->duration_us, record->status);
+
+        for (uint16_t i = 0; i < payload_length; i++) {
+            printk("%02x", record->payload[i]);
+        }
+        printk("%s\n", payload_length ? "" : "-");
+    }
+}
+
+
+/*!
+ * @brief               Called by HAL after it takes radio lock
+ */
+void lr1110_hal_trace_begin(const void * context,
+                            struct lr1110_hal_trace_span * span)
+{
+    if (!((lr1110_t*) context)->hal_trace) {
+        return;
+    }
+
+    span->start = k_cycle_get_32();
+    span->busy_us = ((lr1110_t*) context)->hal_stats.busy_wait_total_us;
+}
+
+
+/*!
+ * @brief               Called by HAL before it releases radio lock, stores
+ *                      the call. For reads, data is the response.
+ */
+void lr1110_hal_trace_end(const void * context,
+                          const struct lr1110_hal_trace_span * span,
+                          enum lr1110_hal_trace_type type,
+                          const uint8_t * command,
+                          uint16_t command_length,
+                          const uint8_t * data,
+                          uint16_t data_length,
+                          uint8_t status)
+{
+    lr1110_t * lr1110 = (lr1110_t*) context;
+    struct lr1110_hal_trace * trace = lr1110->hal_trace;
+
+    if (!trace) {
+        return;
+    }
+
+    struct lr1110_hal_trace_record * record =
+        &trace->records[trace->count % trace->size];
+    uint16_t command_part = MIN(command_length, LR1110_HAL_TRACE_PAYLOAD);
+    uint16_t data_part = MIN(data_length,
+                             LR1110_HAL_TRACE_PAYLOAD - command_part);
+
+    record->cycles = span->start;
+    record->duration_us = k_cyc_to_us_floor32(k_cycle_get_32() - span->start);
+    record->busy_us = lr1110->hal_stats.busy_wait_total_us - span->busy_us;
+    record->opcode = command_length >= 2 ?
+                     (command[0] << 8) | command[1] : 0;
+    record->command_length = command_length;
+    record->data_length = data_length;
+    record->type = type;
+    record->status = status;
+
+    memcpy(record->payload, command, command_part);
+    if (data && data_part) {
+        memcpy(&record->payload[command_part], data, data_part);
+    }
+
+    trace->count++;
+}
+
+#endif /* LR1110_HAL_TRACE */
+
+/*** end of file ***/
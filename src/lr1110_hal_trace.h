@@ -0,0 +1,109 @@
+/** @file lr1110_hal_trace.h
+ *
+ * @brief       Recorder of HAL transactions. Each lr1110_hal_write, read
+ *              and write_read call is stored in a ring buffer with its
+ *              opcode, lengths, first payload bytes, BUSY wait time and
+ *              cycle counter timestamp, so command stream of a unit in
+ *              the field can be dumped and replayed on host, see
+ *              host/tools/trace_replay.c.
+ *
+ *              Tracing is compiled in only when LR1110_HAL_TRACE is set
+ *              to 1 from build system. When compiled in but no trace is
+ *              started, HAL only checks for NULL trace pointer.
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 Irnas.  All rights reserved.
+ */
+
+#ifndef LR1110_HAL_TRACE_H
+#define LR1110_HAL_TRACE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifndef LR1110_HAL_TRACE
+#define LR1110_HAL_TRACE            0
+#endif
+
+/* Recorded bytes of each call, command first, then data */
+#ifndef LR1110_HAL_TRACE_PAYLOAD
+#define LR1110_HAL_TRACE_PAYLOAD    16
+#endif
+
+/* Version of dump format, increased when line layout changes */
+#define LR1110_HAL_TRACE_FORMAT_VERSION     1
+
+enum lr1110_hal_trace_type {
+    LR1110_HAL_TRACE_WRITE = 'W',
+    LR1110_HAL_TRACE_READ = 'R',
+    LR1110_HAL_TRACE_WRITE_READ = 'X',
+};
+
+/*!
+ * @brief One HAL call
+ */
+struct lr1110_hal_trace_record {
+    uint32_t cycles;            /* Cycle counter at start of call */
+    uint32_t duration_us;       /* Whole call, including BUSY waits */
+    uint32_t busy_us;           /* Time spent waiting for BUSY */
+    uint16_t opcode;
+    uint16_t command_length;
+    uint16_t data_length;
+    uint8_t type;               /* enum lr1110_hal_trace_type */
+    uint8_t status;             /* lr1110_hal_status_t */
+    uint8_t payload[LR1110_HAL_TRACE_PAYLOAD];
+};
+
+/*!
+ * @brief Ring buffer, storage is provided by LR1110_HAL_TRACE_DEFINE.
+ *        Oldest records are overwritten when it is full.
+ */
+struct lr1110_hal_trace {
+    struct lr1110_hal_trace_record * records;
+    uint16_t size;
+    uint32_t count;             /* Records written since start */
+};
+
+/*!
+ * @brief In-progress call, kept on HAL function stack
+ */
+struct lr1110_hal_trace_span {
+    uint32_t start;
+    uint64_t busy_us;
+};
+
+/*!
+ * @brief Defines trace with n records
+ */
+#define LR1110_HAL_TRACE_DEFINE(name, n)                                       \
+    static struct lr1110_hal_trace_record name##_records[n];                   \
+    struct lr1110_hal_trace name = {                                           \
+        .records = name##_records,                                             \
+        .size = (n),                                                           \
+    }
+
+void lr1110_hal_trace_start(void * context, struct lr1110_hal_trace * trace);
+void lr1110_hal_trace_stop(void * context);
+void lr1110_hal_trace_dump(const struct lr1110_hal_trace * trace);
+
+void lr1110_hal_trace_begin(const void * context,
+                            struct lr1110_hal_trace_span * span);
+void lr1110_hal_trace_end(const void * context,
+                          const struct lr1110_hal_trace_span * span,
+                          enum lr1110_hal_trace_type type,
+                          const uint8_t * command,
+                          uint16_t command_length,
+                          const uint8_t * data,
+                          uint16_t data_length,
+                          uint8_t status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LR1110_HAL_TRACE_H */
+/*** end of file ***/
@@ -0,0 +1,355 @@
+/** @file lr1110_irq.c
+ *
+ * @brief       IRQ dispatcher.
+ *
+ *              Event interrupt submits dispatcher work, which runs in
+ *              radio work queue. Handlers are submitted to the same queue
+ *              after the event line is armed again, so next event is
+ *              caught while they run.
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 Irnas.  All rights reserved.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include "lr1110.h"
+#include "lr1110_irq.h"
+
+/* -------------------------------------------------------------------------
+ * PRIVATE VARIABLES
+ * ------------------------------------------------------------------------- */
+
+/* IRQs that can be registered for each source */
+static const lr1110_system_irq_mask_t irq_source_masks[] = {
+    [LR1110_IRQ_SOURCE_WIFI]    = LR1110_SYSTEM_IRQ_WIFI_SCAN_DONE,
+    [LR1110_IRQ_SOURCE_GNSS]    = LR1110_SYSTEM_IRQ_GNSS_SCAN_DONE,
+    [LR1110_IRQ_SOURCE_RADIO]   = LR1110_SYSTEM_IRQ_TX_DONE |
+                                  LR1110_SYSTEM_IRQ_RX_DONE |
+                                  LR1110_SYSTEM_IRQ_PREAMBLE_DETECTED |
+                                  LR1110_SYSTEM_IRQ_SYNC_WORD_HEADER_VALID |
+                                  LR1110_SYSTEM_IRQ_HEADER_ERROR |
+                                  LR1110_SYSTEM_IRQ_CRC_ERROR |
+                                  LR1110_SYSTEM_IRQ_TIMEOUT |
+                                  LR1110_SYSTEM_IRQ_FSK_LEN_ERROR |
+                                  LR1110_SYSTEM_IRQ_FSK_ADDR_ERROR,
+    [LR1110_IRQ_SOURCE_CAD]     = LR1110_SYSTEM_IRQ_CAD_DONE |
+                                  LR1110_SYSTEM_IRQ_CAD_DETECTED,
+    [LR1110_IRQ_SOURCE_ERROR]   = LR1110_SYSTEM_IRQ_CMD_ERROR |
+                                  LR1110_SYSTEM_IRQ_ERROR,
+};
+
+/* -------------------------------------------------------------------------
+ * PRIVATE PROTOTYPES
+ * ------------------------------------------------------------------------- */
+static void irq_dispatch_handler(struct k_work * work);
+static int irq_route(lr1110_t * lr1110);
+static void irq_set_event_interrupt(lr1110_t * lr1110, bool enable);
+
+/* -------------------------------------------------------------------------
+ * PUBLIC IMPLEMENTATIONS
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * @brief               Initializes dispatcher and starts radio work queue
+ *                      on first call. Dispatcher is suspended until radio
+ *                      is configured, handlers stay registered through
+ *                      radio re-initialization and their IRQs are routed
+ *                      again by lr1110_irq_resume.
+ *
+ * @param[in] context   Radio abstraction
+ */
+void lr1110_irq_init(void * context)
+{
+    struct lr1110_irq * irq = &((lr1110_t*) context)->irq;
+    const struct k_work_queue_config workq_cfg = { .name = "lr1110" };
+
+    if (!irq->initialized) {
+        /* Work is never reinitialized, as it could still be queued */
+        k_work_init(&irq->work, irq_dispatch_handler);
+        k_work_queue_init(&irq->workq);
+        k_work_queue_start(&irq->workq, irq->workq_stack,
+                           K_KERNEL_STACK_SIZEOF(irq->workq_stack),
+                           LR1110_WORKQ_PRIORITY, &workq_cfg);
+        irq->initialized = true;
+    }
+    irq->suspended = true;
+}
+
+
+/*!
+ * @brief               Returns radio work queue, where dispatcher, IRQ
+ *                      handlers and timeouts of radio operations run
+ *
+ * @param[in] context   Radio abstraction, initialized with lr1110_init
+ *
+ * @return              Work queue of the context
+ */
+struct k_work_q * lr1110_irq_work_queue(const void * context)
+{
+    return &((lr1110_t*) context)->irq.workq;
+}
+
+
+/*!
+ * @brief               Registers work that is submitted when any of the
+ *                      IRQs of the source is set. IRQs are routed to event
+ *                      line and event interrupt is armed. Handler that was
+ *                      registered for the source before is replaced.
+ *
+ * @param[in] context   Radio abstraction
+ * @param[in] source    IRQ source
+ * @param[in] irq_mask  IRQs of the source to handle
+ * @param[in] work      Handler work, has to be initialized
+ *
+ * @return              0 on success, -EINVAL if IRQs do not belong to the
+ *                      source, -EIO on radio error.
+ */
+int lr1110_irq_register(void * context,
+                        enum lr1110_irq_source source,
+                        lr1110_system_irq_mask_t irq_mask,
+                        struct k_work * work)
+{
+    lr1110_t * lr1110 = (lr1110_t*) context;
+    struct lr1110_irq * irq = &lr1110->irq;
+    int err = 0;
+
+    if (source >= LR1110_IRQ_SOURCE_COUNT || !irq_mask ||
+        (irq_mask & ~irq_source_masks[source])) {
+        return -EINVAL;
+    }
+
+    lr1110_lock(context, K_FOREVER);
+
+    if (irq->handlers[source] != work || irq->masks[source] != irq_mask) {
+        irq->handlers[source] = work;
+        irq->masks[source] = irq_mask;
+        atomic_clear(&irq->pending[source]);
+        err = irq_route(lr1110);
+    }
+
+    lr1110_unlock(context);
+    return err;
+}
+
+
+/*!
+ * @brief               Removes handler of the source, if it is still
+ *                      registered. Its IRQs are no longer routed to event
+ *                      line.
+ *
+ * @param[in] context   Radio abstraction
+ * @param[in] source    IRQ source
+ * @param[in] work      Handler work
+ */
+void lr1110_irq_unregister(void * context,
+                           enum lr1110_irq_source source,
+                           struct k_work * work)
+{
+    lr1110_t * lr1110 = (lr1110_t*) context;
+    struct lr1110_irq * irq = &lr1110->irq;
+
+    lr1110_lock(context, K_FOREVER);
+
+    if (source < LR1110_IRQ_SOURCE_COUNT && irq->handlers[source] == work) {
+        irq->handlers[source] = NULL;
+        irq->masks[source] = 0;
+        atomic_clear(&irq->pending[source]);
+        irq_route(lr1110);
+    }
+
+    lr1110_unlock(context);
+}
+
+
+/*!
+ * @brief               Takes IRQs dispatched to handler since last call
+ *
+ * @param[in] context   Radio abstraction
+ * @param[in] source    IRQ source
+ * @param[in] work      Handler work, IRQs are given only to registered one
+ * @param[out] cycles   Last event interrupt of the source, in hardware
+ *                      cycles, can be NULL
+ *
+ * @return              IRQs set, 0 if there were none or handler is no
+ *                      longer registered
+ */
+lr1110_system_irq_mask_t lr1110_irq_take(void * context,
+                                         enum lr1110_irq_source source,
+                                         struct k_work * work,
+                                         uint32_t * cycles)
+{
+    struct lr1110_irq * irq = &((lr1110_t*) context)->irq;
+    lr1110_system_irq_mask_t irq_status = 0;
+
+    lr1110_lock(context, K_FOREVER);
+
+    if (source < LR1110_IRQ_SOURCE_COUNT && irq->handlers[source] == work) {
+        irq_status = atomic_clear(&irq->pending[source]);
+        if (cycles) {
+            *cycles = irq->cycles[source];
+        }
+    }
+
+    lr1110_unlock(context);
+    return irq_status;
+}
+
+
+void lr1110_irq_get_stats(void * context, struct lr1110_irq_stats * stats)
+{
+    lr1110_lock(context, K_FOREVER);
+    *stats = ((lr1110_t*) context)->irq.stats;
+    lr1110_unlock(context);
+}
+
+
+/*!
+ * @brief               Called from event interrupt, submits dispatcher
+ *                      work if any handler is registered
+ *
+ * @param[in] context   Radio abstraction
+ */
+void lr1110_irq_event(void * context)
+{
+    struct lr1110_irq * irq = &((lr1110_t*) context)->irq;
+
+    if (!irq->suspended && irq->mask) {
+        k_work_submit_to_queue(&irq->workq, &irq->work);
+    }
+}
+
+
+/*!
+ * @brief               Hands event line over to a blocking operation,
+ *                      radio has to be locked
+ *
+ * @param[in] context   Radio abstraction
+ */
+void lr1110_irq_suspend(void * context)
+{
+    ((lr1110_t*) context)->irq.suspended = true;
+}
+
+
+/*!
+ * @brief               Takes event line back after a blocking operation or
+ *                      after lr1110_clear_event, registered IRQs are routed
+ *                      to it again and event interrupt is armed. Without
+ *                      registered handlers event interrupt is disarmed.
+ *                      Radio has to be locked.
+ *
+ * @param[in] context   Radio abstraction
+ */
+void lr1110_irq_resume(void * context)
+{
+    lr1110_t * lr1110 = (lr1110_t*) context;
+
+    if (lr1110->irq.suspended) {
+        lr1110->irq.suspended = false;
+        irq_route(lr1110);
+    }
+    else {
+        /* Routing is unchanged, only interrupt could have been disarmed */
+        irq_set_event_interrupt(lr1110, lr1110->irq.mask != 0);
+    }
+}
+
+/* -------------------------------------------------------------------------
+ * PRIVATE IMPLEMENTATIONS
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * @brief               Dispatcher work, submitted from event interrupt.
+ *                      Each registered source gets IRQs that were set,
+ *                      IRQ status is cleared for all of them at once.
+ */
+static void irq_dispatch_handler(struct k_work * work)
+{
+    struct lr1110_irq * irq = CONTAINER_OF(work, struct lr1110_irq, work);
+    lr1110_t * lr1110 = CONTAINER_OF(irq, lr1110_t, irq);
+    uint32_t cycles = lr1110->event_cycles;
+    lr1110_system_irq_mask_t irq_status;
+    bool handled = false;
+
+    lr1110_lock(lr1110, K_FOREVER);
+
+    /* Blocking operation took event line after interrupt */
+    if (irq->suspended || !irq->mask) {
+        lr1110_unlock(lr1110);
+        return;
+    }
+
+    if (lr1110_hal_clear_irq_status(lr1110, irq->mask, &irq_status)) {
+        irq->stats.spi_errors++;
+        irq_status = 0;
+    }
+
+    /* Event line is level triggered, it is low again after clear */
+    irq_set_event_interrupt(lr1110, true);
+
+    irq->stats.events++;
+    for (uint8_t i = 0; i < LR1110_IRQ_SOURCE_COUNT; i++)
+    {
+        lr1110_system_irq_mask_t bits = irq_status & irq->masks[i];
+
+        if (bits && irq->handlers[i]) {
+            irq->cycles[i] = cycles;
+            atomic_or(&irq->pending[i], bits);
+            k_work_submit_to_queue(&irq->workq, irq->handlers[i]);
+            irq->stats.dispatched[i]++;
+            handled = true;
+        }
+    }
+
+    if (!handled) {
+        irq->stats.unhandled++;
+    }
+
+    uint32_t latency_us = k_cyc_to_us_floor32(k_cycle_get_32() - cycles);
+
+    irq->stats.latency_us_last = latency_us;
+    irq->stats.latency_us_max = MAX(irq->stats.latency_us_max, latency_us);
+
+    lr1110_unlock(lr1110);
+}
+
+
+/*!
+ * @brief               Routes registered IRQs to event line and arms or
+ *                      disarms event interrupt, radio has to be locked
+ *
+ * @return              0 on success, -EIO on radio error
+ */
+static int irq_route(lr1110_t * lr1110)
+{
+    lr1110_status_t status = LR1110_STATUS_OK;
+
+    lr1110->irq.mask = 0;
+    for (uint8_t i = 0; i < LR1110_IRQ_SOURCE_COUNT; i++) {
+        lr1110->irq.mask |= lr1110->irq.masks[i];
+    }
+
+    /* Blocking operation owns event line, routing is done on resume */
+    if (lr1110->irq.suspended) {
+        return 0;
+    }
+
+    if (lr1110->irq.mask) {
+        status = lr1110_system_set_dio_irq_params(lr1110, lr1110->irq.mask, 0);
+    }
+    irq_set_event_interrupt(lr1110, lr1110->irq.mask != 0);
+
+    return status ? -EIO : 0;
+}
+
+
+static void irq_set_event_interrupt(lr1110_t * lr1110, bool enable)
+{
+    gpio_pin_interrupt_configure(lr1110->event.port,
+                                 lr1110->event.pin,
+                                 enable ? lr1110->event_trigger_type :
+                                          GPIO_INT_DISABLE);
+}
+
+/*** end of file ***/
@@ -0,0 +1,101 @@
+/** @file lr1110_irq.h
+ *
+ * @brief       IRQ dispatcher. All IRQ sources share one event line: on
+ *              each event interrupt, dispatcher work reads and clears IRQ
+ *              status with one SPI transaction, arms the event line again
+ *              and submits work registered for each source that has IRQs
+ *              set. Handlers take their IRQs with lr1110_irq_take.
+ *
+ *              One handler is registered per source, registering another
+ *              one takes the source over. Blocking operations that use
+ *              lr1110_prepare_event own the event line until
+ *              lr1110_clear_event, dispatcher is suspended meanwhile.
+ *
+ *              Dispatcher, handlers and timeouts of radio operations run
+ *              in radio work queue of the context. They lock the radio,
+ *              so while a blocking scan holds it they wait there instead
+ *              of stalling system work queue.
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 Irnas.  All rights reserved.
+ */
+
+#ifndef LR1110_IRQ_H
+#define LR1110_IRQ_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <zephyr.h>
+#include "lr1110_driver/lr1110_system_types.h"
+
+/* Radio work queue thread, one per context. By default it has priority of
+ * system work queue, which radio handlers used before. */
+#ifndef LR1110_WORKQ_STACK_SIZE
+#define LR1110_WORKQ_STACK_SIZE         2048
+#endif
+#ifndef LR1110_WORKQ_PRIORITY
+#define LR1110_WORKQ_PRIORITY           CONFIG_SYSTEM_WORKQUEUE_PRIORITY
+#endif
+
+enum lr1110_irq_source {
+    LR1110_IRQ_SOURCE_WIFI = 0,     /* Wifi scan done */
+    LR1110_IRQ_SOURCE_GNSS,         /* GNSS scan done */
+    LR1110_IRQ_SOURCE_RADIO,        /* TX, RX, header, CRC and timeout */
+    LR1110_IRQ_SOURCE_CAD,
+    LR1110_IRQ_SOURCE_ERROR,        /* Command and chip errors */
+    LR1110_IRQ_SOURCE_COUNT,
+};
+
+struct lr1110_irq_stats {
+    uint32_t events;            /* Event interrupts dispatched */
+    uint32_t dispatched[LR1110_IRQ_SOURCE_COUNT];
+    uint32_t unhandled;         /* Events without registered IRQ set */
+    uint32_t spi_errors;        /* IRQ status could not be read */
+    uint32_t latency_us_last;   /* Event interrupt to handlers submitted */
+    uint32_t latency_us_max;
+};
+
+/*!
+ * @brief Dispatcher state, part of radio context
+ */
+struct lr1110_irq {
+    struct k_work work;
+    struct k_work * handlers[LR1110_IRQ_SOURCE_COUNT];
+    lr1110_system_irq_mask_t masks[LR1110_IRQ_SOURCE_COUNT];
+    lr1110_system_irq_mask_t mask;  /* Routed to event line */
+    atomic_t pending[LR1110_IRQ_SOURCE_COUNT];
+    uint32_t cycles[LR1110_IRQ_SOURCE_COUNT];   /* Last event of source */
+    bool suspended;
+    bool initialized;
+    struct lr1110_irq_stats stats;
+    struct k_work_q workq;
+    K_KERNEL_STACK_MEMBER(workq_stack, LR1110_WORKQ_STACK_SIZE);
+};
+
+void lr1110_irq_init(void * context);
+struct k_work_q * lr1110_irq_work_queue(const void * context);
+int lr1110_irq_register(void * context,
+                        enum lr1110_irq_source source,
+                        lr1110_system_irq_mask_t irq_mask,
+                        struct k_work * work);
+void lr1110_irq_unregister(void * context,
+                           enum lr1110_irq_source source,
+                           struct k_work * work);
+lr1110_system_irq_mask_t lr1110_irq_take(void * context,
+                                         enum lr1110_irq_source source,
+                                         struct k_work * work,
+                                         uint32_t * cycles);
+void lr1110_irq_get_stats(void * context, struct lr1110_irq_stats * stats);
+
+void lr1110_irq_event(void * context);
+void lr1110_irq_suspend(void * context);
+void lr1110_irq_resume(void * context);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LR1110_IRQ_H */
+/*** end of file ***/
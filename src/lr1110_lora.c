@@ -0,0 +1,504 @@
+/** @file lr1110_lora.c
+ *
+ * @brief       LoRa packet radio.
+ *
+ *              Radio IRQs are registered with IRQ dispatcher, which
+ *              submits event work. Event work reads received packet into
+ *              ring and finishes send.
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 Irnas.  All rights reserved.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include "lr1110.h"
+#include "lr1110_lora.h"
+#include "lr1110_driver/lr1110_radio.h"
+#include "lr1110_driver/lr1110_regmem.h"
+
+/* -------------------------------------------------------------------------
+ * PRIVATE VARIABLES
+ * ------------------------------------------------------------------------- */
+
+#define LORA_IRQ_MASK   (LR1110_SYSTEM_IRQ_TX_DONE | \
+                         LR1110_SYSTEM_IRQ_RX_DONE | \
+                         LR1110_SYSTEM_IRQ_HEADER_ERROR | \
+                         LR1110_SYSTEM_IRQ_CRC_ERROR | \
+                         LR1110_SYSTEM_IRQ_TIMEOUT)
+
+/* RX timeout in RTC steps that keeps radio receiving after each packet */
+#define LORA_RX_CONTINUOUS          0xFFFFFF
+
+/* Added to radio TX timeout, before send is aborted by host */
+#define LORA_TX_TIMEOUT_MARGIN_MS   100
+
+enum lora_tx_state {
+    LORA_TX_IDLE = 0,
+    LORA_TX_RUNNING,
+    LORA_TX_FINISHING,  /* Claimed by event, timeout or cancel */
+};
+
+/* -------------------------------------------------------------------------
+ * PRIVATE PROTOTYPES
+ * ------------------------------------------------------------------------- */
+static void lora_event_handler(struct k_work * work);
+static void lora_tx_timeout_handler(struct k_work * work);
+static void lora_tx_abort(struct lr1110_lora * lora, int status);
+static void lora_tx_finish(struct lr1110_lora * lora, int status);
+static struct lr1110_lora_packet * lora_rx_read(struct lr1110_lora * lora,
+                                                uint32_t timestamp);
+static lr1110_status_t lora_rx_enter(struct lr1110_lora * lora);
+static lr1110_status_t lora_set_pkt_params(struct lr1110_lora * lora,
+                                           uint8_t length);
+static void lora_take_event(struct lr1110_lora * lora);
+
+/* -------------------------------------------------------------------------
+ * PUBLIC IMPLEMENTATIONS
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * @brief               Returns default LoRa settings: 868.1 MHz, SF7,
+ *                      125 kHz, CR 4/5, private sync word, 14 dBm on low
+ *                      power PA
+ */
+struct lora_settings lr1110_get_default_lora_settings(void)
+{
+    struct lora_settings lora_settings = {
+        .frequency_hz       = 868100000,
+        .mod_params         = {
+            .sf             = LR1110_RADIO_LORA_SF7,
+            .bw             = LR1110_RADIO_LORA_BW_125,
+            .cr             = LR1110_RADIO_LORA_CR_4_5,
+            .ldro           = 0,
+        },
+        .preamble_length    = 8,
+        .header_type        = LR1110_RADIO_LORA_PKT_EXPLICIT,
+        .crc                = LR1110_RADIO_LORA_CRC_ON,
+        .iq                 = LR1110_RADIO_LORA_IQ_STANDARD,
+        .sync_word          = 0x12,
+        .pa_cfg             = {
+            .pa_sel         = LR1110_RADIO_PA_SEL_LP,
+            .pa_reg_supply  = LR1110_RADIO_PA_REG_SUPPLY_VREG,
+            .pa_duty_cycle  = 0x04,
+            .pa_hp_sel      = 0x00,
+        },
+        .tx_power_dbm       = 14,
+        .ramp_time          = LR1110_RADIO_RAMP_48_US,
+        .tx_timeout_ms      = 3000,
+    };
+    return lora_settings;
+}
+
+
+/*!
+ * @brief                   Configures radio for LoRa packets and takes
+ *                          over event line. Radio is left in standby,
+ *                          receive ring is emptied.
+ *
+ * @param[in] context       Radio abstraction
+ * @param[in] lora          LoRa state
+ * @param[in] lora_settings Modulation, packet and TX settings
+ *
+ * @return                  0 on success, -EBUSY if send is in progress,
+ *                          -EIO on radio error.
+ */
+int lr1110_lora_init(void * context,
+                     struct lr1110_lora * lora,
+                     struct lora_settings lora_settings)
+{
+    lr1110_status_t status;
+
+    if (atomic_get(&lora->tx_state) != LORA_TX_IDLE) {
+        return -EBUSY;
+    }
+
+    if (lora->context == NULL) {
+        /* First use, works are never reinitialized as they could still be
+         * queued. */
+        k_work_init(&lora->event_work, lora_event_handler);
+        k_work_init_delayable(&lora->tx_timeout_work,
+                              lora_tx_timeout_handler);
+        lr1110_packet_ring_init(&lora->rx_ring, lora->rx_packets,
+                                LR1110_LORA_RX_RING_SIZE);
+    }
+    lora->context = context;
+    lora->lora_settings = lora_settings;
+    lora->receiving = false;
+    lr1110_packet_ring_reset(&lora->rx_ring);
+    memset(&lora->stats, 0, sizeof(lora->stats));
+
+    lr1110_lock(context, K_FOREVER);
+
+    status  = lr1110_system_set_standby(context, LR1110_SYSTEM_STANDBY_CFG_RC);
+    status |= lr1110_radio_set_pkt_type(context, LR1110_RADIO_PKT_TYPE_LORA);
+    status |= lr1110_radio_set_rf_freq(context, lora_settings.frequency_hz);
+    status |= lr1110_radio_set_lora_mod_params(context,
+                                               &lora_settings.mod_params);
+    status |= lora_set_pkt_params(lora, LR1110_LORA_MAX_PAYLOAD);
+    status |= lr1110_radio_set_lora_sync_word(context, lora_settings.sync_word);
+    status |= lr1110_radio_set_pa_cfg(context, &lora_settings.pa_cfg);
+    status |= lr1110_radio_set_tx_params(context,
+                                         lora_settings.tx_power_dbm,
+                                         lora_settings.ramp_time);
+    lora_take_event(lora);
+
+    lr1110_unlock(context);
+    return status ? -EIO : 0;
+}
+
+
+/*!
+ * @brief               Sends packet and returns immediately. Data is written
+ *                      to radio buffer before return, so buffer can be
+ *                      reused right away.
+ *
+ * @param[in] lora      LoRa state
+ * @param[in] data      Payload
+ * @param[in] length    Payload length
+ * @param[in] cb        Called once with 0, -ETIMEDOUT or -ECANCELED, can
+ *                      be NULL
+ * @param[in] user_data Passed to callback
+ *
+ * @return              0 if send was started, -EINVAL on empty payload,
+ *                      -EBUSY if previous send is not done, -EIO on radio
+ *                      error.
+ */
+int lr1110_lora_send(struct lr1110_lora * lora,
+                     const uint8_t * data,
+                     uint8_t length,
+                     lr1110_lora_tx_cb_t cb,
+                     void * user_data)
+{
+    void * context = lora->context;
+    lr1110_status_t status;
+
+    if (length == 0) {
+        return -EINVAL;
+    }
+    if (!atomic_cas(&lora->tx_state, LORA_TX_IDLE, LORA_TX_RUNNING)) {
+        return -EBUSY;
+    }
+    lora->tx_cb = cb;
+    lora->tx_user_data = user_data;
+
+    lr1110_lock(context, K_FOREVER);
+
+    lora_take_event(lora);
+    status  = lora_set_pkt_params(lora, length);
+    status |= lr1110_regmem_write_buffer8(context, data, length);
+    status |= lr1110_radio_set_tx(context, lora->lora_settings.tx_timeout_ms);
+
+    if (status) {
+        lr1110_system_set_standby(context, LR1110_SYSTEM_STANDBY_CFG_RC);
+        if (lora->receiving) {
+            lora_rx_enter(lora);
+        }
+        lr1110_unlock(context);
+        atomic_set(&lora->tx_state, LORA_TX_IDLE);
+        return -EIO;
+    }
+
+    /* Scheduled under lock, so event work can not finish send before */
+    k_work_schedule_for_queue(lr1110_irq_work_queue(context),
+                              &lora->tx_timeout_work,
+                              K_MSEC(lora->lora_settings.tx_timeout_ms +
+                                     LORA_TX_TIMEOUT_MARGIN_MS));
+    lr1110_unlock(context);
+    return 0;
+}
+
+
+/*!
+ * @brief               Cancels send started with lr1110_lora_send.
+ *                      Callback is called with -ECANCELED before this
+ *                      function returns.
+ *
+ * @param[in] lora      LoRa state
+ *
+ * @return              0 on success, -EALREADY if send is not running.
+ */
+int lr1110_lora_cancel_send(struct lr1110_lora * lora)
+{
+    if (!atomic_cas(&lora->tx_state, LORA_TX_RUNNING, LORA_TX_FINISHING)) {
+        return -EALREADY;
+    }
+
+    k_work_cancel_delayable(&lora->tx_timeout_work);
+    lora_tx_abort(lora, -ECANCELED);
+    return 0;
+}
+
+
+/*!
+ * @brief               Starts continuous receive. Radio goes back to
+ *                      receive after each packet and after each send.
+ *
+ * @param[in] lora      LoRa state
+ * @param[in] cb        Called for each packet put into ring, can be NULL
+ * @param[in] user_data Passed to callback
+ *
+ * @return              0 on success, -EIO on radio error.
+ */
+int lr1110_lora_receive_start(struct lr1110_lora * lora,
+                              lr1110_lora_rx_cb_t cb,
+                              void * user_data)
+{
+    lr1110_status_t status = LR1110_STATUS_OK;
+
+    lr1110_lock(lora->context, K_FOREVER);
+
+    lora->rx_cb = cb;
+    lora->rx_user_data = user_data;
+    lora->receiving = true;
+
+    /* While sending, receive is entered when send is done */
+    if (atomic_get(&lora->tx_state) == LORA_TX_IDLE) {
+        lora_take_event(lora);
+        status = lora_rx_enter(lora);
+    }
+
+    lr1110_unlock(lora->context);
+    return status ? -EIO : 0;
+}
+
+
+/*!
+ * @brief               Stops receiving, packets already in ring can still
+ *                      be read
+ *
+ * @param[in] lora      LoRa state
+ *
+ * @return              0 on success, -EALREADY if not receiving, -EIO on
+ *                      radio error.
+ */
+int lr1110_lora_receive_stop(struct lr1110_lora * lora)
+{
+    lr1110_status_t status = LR1110_STATUS_OK;
+
+    lr1110_lock(lora->context, K_FOREVER);
+
+    if (!lora->receiving) {
+        lr1110_unlock(lora->context);
+        return -EALREADY;
+    }
+    lora->receiving = false;
+
+    if (atomic_get(&lora->tx_state) == LORA_TX_IDLE) {
+        status = lr1110_system_set_standby(lora->context,
+                                           LR1110_SYSTEM_STANDBY_CFG_RC);
+    }
+
+    lr1110_unlock(lora->context);
+    return status ? -EIO : 0;
+}
+
+
+/*!
+ * @brief               Takes oldest packet out of receive ring
+ *
+ * @param[in] lora      LoRa state
+ * @param[out] packet   Received packet
+ * @param[in] timeout   How long to wait for a packet, K_NO_WAIT to poll
+ *
+ * @return              0 on success, -EAGAIN if there was no packet
+ */
+int lr1110_lora_read(struct lr1110_lora * lora,
+                     struct lr1110_lora_packet * packet,
+                     k_timeout_t timeout)
+{
+    return lr1110_packet_ring_read(&lora->rx_ring, packet, timeout);
+}
+
+
+void lr1110_lora_get_stats(struct lr1110_lora * lora,
+                           struct lr1110_lora_stats * stats)
+{
+    lr1110_lock(lora->context, K_FOREVER);
+    *stats = lora->stats;
+    lr1110_unlock(lora->context);
+}
+
+/* -------------------------------------------------------------------------
+ * PRIVATE IMPLEMENTATIONS
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * @brief               Work handler, submitted by IRQ dispatcher with all
+ *                      radio IRQs set since last run
+ */
+static void lora_event_handler(struct k_work * work)
+{
+    struct lr1110_lora * lora =
+        CONTAINER_OF(work, struct lr1110_lora, event_work);
+    void * context = lora->context;
+    struct lr1110_lora_packet * packet = NULL;
+    uint32_t timestamp = 0;
+    int tx_status = 0;
+    bool tx_done = false;
+
+    lr1110_lock(context, K_FOREVER);
+
+    lr1110_system_irq_mask_t irq = lr1110_irq_take(context, 
+                                                   LR1110_IRQ_SOURCE_RADIO,
+                                                   &lora->event_work,
+                                                   &timestamp);
+
+    if (irq & LR1110_SYSTEM_IRQ_HEADER_ERROR) {
+        lora->stats.rx_header_errors++;
+    }
+    if (irq & LR1110_SYSTEM_IRQ_RX_DONE) {
+        if (irq & LR1110_SYSTEM_IRQ_CRC_ERROR) {
+            lora->stats.rx_crc_errors++;
+        }
+        else {
+            packet = lora_rx_read(lora, timestamp);
+        }
+    }
+
+    if ((irq & (LR1110_SYSTEM_IRQ_TX_DONE | LR1110_SYSTEM_IRQ_TIMEOUT)) &&
+        atomic_cas(&lora->tx_state, LORA_TX_RUNNING, LORA_TX_FINISHING)) {
+        k_work_cancel_delayable(&lora->tx_timeout_work);
+        tx_status = (irq & LR1110_SYSTEM_IRQ_TX_DONE) ? 0 : -ETIMEDOUT;
+        tx_done = true;
+        if (lora->receiving) {
+            lora_rx_enter(lora);
+        }
+    }
+
+    lr1110_unlock(context);
+
+    if (packet && lora->rx_cb) {
+        lora->rx_cb(lora, packet, lora->rx_user_data);
+    }
+    if (tx_done) {
+        lora_tx_finish(lora, tx_status);
+    }
+}
+
+
+/*!
+ * @brief               Delayed work handler, radio did not report end of
+ *                      send in time
+ */
+static void lora_tx_timeout_handler(struct k_work * work)
+{
+    struct k_work_delayable * dwork = k_work_delayable_from_work(work);
+    struct lr1110_lora * lora =
+        CONTAINER_OF(dwork, struct lr1110_lora, tx_timeout_work);
+
+    if (!atomic_cas(&lora->tx_state, LORA_TX_RUNNING, LORA_TX_FINISHING)) {
+        return;
+    }
+    lora_tx_abort(lora, -ETIMEDOUT);
+}
+
+
+/*!
+ * @brief               Stops send, receive is entered again if it was on
+ */
+static void lora_tx_abort(struct lr1110_lora * lora, int status)
+{
+    lr1110_lock(lora->context, K_FOREVER);
+    lr1110_system_set_standby(lora->context, LR1110_SYSTEM_STANDBY_CFG_RC);
+    if (lora->receiving) {
+        lora_rx_enter(lora);
+    }
+    lr1110_unlock(lora->context);
+
+    lora_tx_finish(lora, status);
+}
+
+
+/*!
+ * @brief               Counts finished send and reports it
+ */
+static void lora_tx_finish(struct lr1110_lora * lora, int status)
+{
+    if (!status) {
+        lora->stats.tx_packets++;
+    }
+    else if (status == -ETIMEDOUT) {
+        lora->stats.tx_timeouts++;
+    }
+
+    /* Callback can send next packet once state is idle, as can any other
+     * thread, which overwrites callback, so it is taken before */
+    lr1110_lora_tx_cb_t tx_cb = lora->tx_cb;
+    void * tx_user_data = lora->tx_user_data;
+
+    atomic_set(&lora->tx_state, LORA_TX_IDLE);
+    if (tx_cb) {
+        tx_cb(lora, status, tx_user_data);
+    }
+}
+
+
+/*!
+ * @brief               Reads received packet into ring head, radio has to
+ *                      be locked
+ *
+ * @return              Packet in ring, NULL if ring is full or on radio
+ *                      error
+ */
+static struct lr1110_lora_packet * lora_rx_read(struct lr1110_lora * lora,
+                                                uint32_t timestamp)
+{
+    struct lr1110_lora_packet * packet = NULL;
+    int err = lr1110_packet_ring_receive(lora->context, &lora->rx_ring,
+                                         timestamp, &packet);
+
+    if (err == -ENOBUFS) {
+        lora->stats.rx_dropped++;
+    }
+    else if (!err) {
+        lora->stats.rx_packets++;
+    }
+    return packet;
+}
+
+
+/*!
+ * @brief               Enters continuous receive, radio has to be locked
+ */
+static lr1110_status_t lora_rx_enter(struct lr1110_lora * lora)
+{
+    lr1110_status_t status;
+
+    status  = lora_set_pkt_params(lora, LR1110_LORA_MAX_PAYLOAD);
+    status |= lr1110_radio_set_rx_with_timeout_in_rtc_step(lora->context,
+                                                           LORA_RX_CONTINUOUS);
+    return status;
+}
+
+
+/*!
+ * @brief               Sets packet parameters, length is payload length for
+ *                      send and maximal length for receive
+ */
+static lr1110_status_t lora_set_pkt_params(struct lr1110_lora * lora,
+                                           uint8_t length)
+{
+    lr1110_radio_pkt_params_lora_t pkt_params = {
+        .preamble_len_in_symb   = lora->lora_settings.preamble_length,
+        .header_type            = lora->lora_settings.header_type,
+        .pld_len_in_bytes       = length,
+        .crc                    = lora->lora_settings.crc,
+        .iq                     = lora->lora_settings.iq,
+    };
+
+    return lr1110_radio_set_lora_pkt_params(lora->context, &pkt_params);
+}
+
+
+/*!
+ * @brief               Registers event work for radio IRQs, needed after
+ *                      RX capture took them over
+ */
+static void lora_take_event(struct lr1110_lora * lora)
+{
+    lr1110_irq_register(lora->context, LR1110_IRQ_SOURCE_RADIO,
+                        LORA_IRQ_MASK, &lora->event_work);
+}
+
+/*** end of file ***/
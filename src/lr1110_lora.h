@@ -0,0 +1,123 @@
+/** @file lr1110_lora.h
+ *
+ * @brief       LoRa packet radio. Packets are sent straight from caller
+ *              buffer into radio buffer, received packets are read on
+ *              RX_DONE interrupt into a ring of packets with RSSI, SNR and
+ *              timestamp. Send and receive do not block, outcome is
+ *              reported through callbacks from radio work queue.
+ *
+ *              Radio is half duplex: while receiving, send switches to TX
+ *              and continuous RX is entered again when TX is done.
+ *
+ *              Radio IRQs are handled by this module from
+ *              lr1110_lora_init on, until RX capture takes them over. Wifi
+ *              and GNSS scans stop the radio, so receiving has to be
+ *              started again after them.
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 Irnas.  All rights reserved.
+ */
+
+#ifndef LR1110_LORA_H
+#define LR1110_LORA_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <zephyr.h>
+#include "lr1110_driver/lr1110_radio_types.h"
+#include "lr1110_packet_ring.h"
+
+/* Received packets kept until read, older packets are not overwritten */
+#ifndef LR1110_LORA_RX_RING_SIZE
+#define LR1110_LORA_RX_RING_SIZE    8
+#endif
+
+struct lora_settings {
+    uint32_t frequency_hz;
+    lr1110_radio_mod_params_lora_t mod_params;
+    uint16_t preamble_length;
+    lr1110_radio_lora_pkt_len_modes_t header_type;
+    lr1110_radio_lora_crc_t crc;
+    lr1110_radio_lora_iq_t iq;
+    uint8_t sync_word;
+    lr1110_radio_pa_cfg_t pa_cfg;
+    int8_t tx_power_dbm;
+    lr1110_radio_ramp_time_t ramp_time;
+    uint32_t tx_timeout_ms;
+};
+
+struct lr1110_lora_stats {
+    uint32_t tx_packets;
+    uint32_t tx_timeouts;
+    uint32_t rx_packets;        /* Put into ring */
+    uint32_t rx_crc_errors;
+    uint32_t rx_header_errors;
+    uint32_t rx_dropped;        /* Ring was full */
+};
+
+struct lr1110_lora;
+
+/*!
+ * @brief Called from radio work queue when send is done. Status is 0 on
+ *        success, -ETIMEDOUT or -ECANCELED otherwise.
+ */
+typedef void (*lr1110_lora_tx_cb_t)(struct lr1110_lora * lora,
+                                    int status,
+                                    void * user_data);
+
+/*!
+ * @brief Called from radio work queue for each packet put into ring.
+ *        Packet stays in ring until it is read with lr1110_lora_read.
+ */
+typedef void (*lr1110_lora_rx_cb_t)(struct lr1110_lora * lora,
+                                    const struct lr1110_lora_packet * packet,
+                                    void * user_data);
+
+/*!
+ * @brief LoRa radio state, owned by caller. Has to be zero initialized
+ *        before first use.
+ */
+struct lr1110_lora {
+    void * context;
+    struct lora_settings lora_settings;
+    struct k_work event_work;
+    struct k_work_delayable tx_timeout_work;
+    atomic_t tx_state;
+    lr1110_lora_tx_cb_t tx_cb;
+    void * tx_user_data;
+    bool receiving;
+    lr1110_lora_rx_cb_t rx_cb;
+    void * rx_user_data;
+    struct lr1110_lora_packet rx_packets[LR1110_LORA_RX_RING_SIZE];
+    struct lr1110_packet_ring rx_ring;
+    struct lr1110_lora_stats stats;
+};
+
+struct lora_settings lr1110_get_default_lora_settings(void);
+int lr1110_lora_init(void * context,
+                     struct lr1110_lora * lora,
+                     struct lora_settings lora_settings);
+int lr1110_lora_send(struct lr1110_lora * lora,
+                     const uint8_t * data,
+                     uint8_t length,
+                     lr1110_lora_tx_cb_t cb,
+                     void * user_data);
+int lr1110_lora_cancel_send(struct lr1110_lora * lora);
+int lr1110_lora_receive_start(struct lr1110_lora * lora,
+                              lr1110_lora_rx_cb_t cb,
+                              void * user_data);
+int lr1110_lora_receive_stop(struct lr1110_lora * lora);
+int lr1110_lora_read(struct lr1110_lora * lora,
+                     struct lr1110_lora_packet * packet,
+                     k_timeout_t timeout);
+void lr1110_lora_get_stats(struct lr1110_lora * lora,
+                           struct lr1110_lora_stats * stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LR1110_LORA_H */
+/*** end of file ***/
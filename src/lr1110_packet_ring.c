@@ -0,0 +1,133 @@
+/** @file lr1110_packet_ring.c
+ *
+ * @brief       Ring of received packets.
+ *
+ *              Single writer, the work that handles RX_DONE, advances
+ *              head. Readers are serialized with read lock and advance
+ *              tail, semaphore counts packets in ring.
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 Irnas.  All rights reserved.
+ */
+
+#include <errno.h>
+#include "lr1110.h"
+#include "lr1110_packet_ring.h"
+#include "lr1110_driver/lr1110_radio.h"
+#include "lr1110_driver/lr1110_regmem.h"
+
+/* -------------------------------------------------------------------------
+ * PUBLIC IMPLEMENTATIONS
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * @brief               Initializes empty ring, called once by owner before
+ *                      first use
+ *
+ * @param[out] ring     Packet ring
+ * @param[in] packets   Packet storage
+ * @param[in] size      Number of packets in storage
+ */
+void lr1110_packet_ring_init(struct lr1110_packet_ring * ring,
+                             struct lr1110_lora_packet * packets,
+                             uint8_t size)
+{
+    ring->packets = packets;
+    ring->size = size;
+    k_sem_init(&ring->sem, 0, size);
+    k_mutex_init(&ring->read_lock);
+    lr1110_packet_ring_reset(ring);
+}
+
+
+/*!
+ * @brief               Drops all packets in ring
+ *
+ * @param[in] ring      Packet ring
+ */
+void lr1110_packet_ring_reset(struct lr1110_packet_ring * ring)
+{
+    k_sem_reset(&ring->sem);
+    atomic_set(&ring->head, 0);
+    atomic_set(&ring->tail, 0);
+}
+
+
+/*!
+ * @brief               Reads received packet from radio into ring head,
+ *                      radio has to be locked
+ *
+ * @param[in] context   Radio abstraction
+ * @param[in] ring      Packet ring
+ * @param[in] timestamp Event interrupt of packet, in hardware cycles
+ * @param[out] packet   Packet in ring, can be NULL
+ *
+ * @return              0 on success, -ENOBUFS if ring is full, -EIO on
+ *                      radio error
+ */
+int lr1110_packet_ring_receive(void * context,
+                               struct lr1110_packet_ring * ring,
+                               uint32_t timestamp,
+                               struct lr1110_lora_packet ** packet)
+{
+    atomic_val_t head = atomic_get(&ring->head);
+    lr1110_radio_rx_buffer_status_t buffer_status;
+    lr1110_radio_pkt_status_lora_t pkt_status;
+
+    if (head - atomic_get(&ring->tail) >= ring->size) {
+        return -ENOBUFS;
+    }
+
+    struct lr1110_lora_packet * slot = &ring->packets[head % ring->size];
+
+    if (lr1110_radio_get_rx_buffer_status(context, &buffer_status) ||
+        lr1110_radio_get_lora_pkt_status(context, &pkt_status) ||
+        lr1110_regmem_read_buffer8(context, slot->data,
+                                   buffer_status.buffer_start_pointer,
+                                   buffer_status.pld_len_in_bytes)) {
+        return -EIO;
+    }
+
+    slot->timestamp = timestamp;
+    slot->rssi = pkt_status.rssi_pkt_in_dbm;
+    slot->snr = pkt_status.snr_pkt_in_db;
+    slot->signal_rssi = pkt_status.signal_rssi_pkt_in_dbm;
+    slot->length = buffer_status.pld_len_in_bytes;
+
+    atomic_set(&ring->head, head + 1);
+    k_sem_give(&ring->sem);
+
+    if (packet) {
+        *packet = slot;
+    }
+    return 0;
+}
+
+
+/*!
+ * @brief               Takes oldest packet
+ *
+ * @param[in] ring      Packet ring
+ * @param[out] packet   Packet, timestamp is in hardware cycles
+ * @param[in] timeout   How long to wait for a packet, K_NO_WAIT to poll
+ *
+ * @return              0 on success, -EAGAIN if there was no packet
+ */
+int lr1110_packet_ring_read(struct lr1110_packet_ring * ring,
+                            struct lr1110_lora_packet * packet,
+                            k_timeout_t timeout)
+{
+    if (k_sem_take(&ring->sem, timeout)) {
+        return -EAGAIN;
+    }
+
+    k_mutex_lock(&ring->read_lock, K_FOREVER);
+    atomic_val_t tail = atomic_get(&ring->tail);
+
+    *packet = ring->packets[tail % ring->size];
+    atomic_set(&ring->tail, tail + 1);
+    k_mutex_unlock(&ring->read_lock);
+    return 0;
+}
+
+/*** end of file ***/
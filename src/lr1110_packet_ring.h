@@ -0,0 +1,67 @@
+/** @file lr1110_packet_ring.h
+ *
+ * @brief       Ring of received packets, shared by LoRa radio and RX
+ *              capture. Packet is read from radio straight into ring head
+ *              in radio work queue, with three commands: buffer status,
+ *              packet status and payload. Readers take packets from tail.
+ *              Older packets are not overwritten, packet that does not fit
+ *              is not read from radio.
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 Irnas.  All rights reserved.
+ */
+
+#ifndef LR1110_PACKET_RING_H
+#define LR1110_PACKET_RING_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <zephyr.h>
+
+#define LR1110_LORA_MAX_PAYLOAD     255
+
+/*!
+ * @brief Received packet
+ */
+struct lr1110_lora_packet {
+    uint32_t timestamp;         /* Event interrupt, in hardware cycles */
+    int8_t rssi;                /* Packet RSSI, dBm */
+    int8_t snr;                 /* dB */
+    int8_t signal_rssi;         /* RSSI after despreading, dBm */
+    uint8_t length;
+    uint8_t data[LR1110_LORA_MAX_PAYLOAD];
+};
+
+/*!
+ * @brief Packet ring, part of its owner state. Packet storage is provided
+ *        by owner with lr1110_packet_ring_init.
+ */
+struct lr1110_packet_ring {
+    struct lr1110_lora_packet * packets;
+    uint8_t size;
+    atomic_t head;              /* Written by work queue */
+    atomic_t tail;              /* Written by readers */
+    struct k_sem sem;
+    struct k_mutex read_lock;
+};
+
+void lr1110_packet_ring_init(struct lr1110_packet_ring * ring,
+                             struct lr1110_lora_packet * packets,
+                             uint8_t size);
+void lr1110_packet_ring_reset(struct lr1110_packet_ring * ring);
+int lr1110_packet_ring_receive(void * context,
+                               struct lr1110_packet_ring * ring,
+                               uint32_t timestamp,
+                               struct lr1110_lora_packet ** packet);
+int lr1110_packet_ring_read(struct lr1110_packet_ring * ring,
+                            struct lr1110_lora_packet * packet,
+                            k_timeout_t timeout);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LR1110_PACKET_RING_H */
+/*** end of file ***/
@@ -8,6 +8,8 @@
  * COPYRIGHT NOTICE: (c) 2021 Irnas. All rights reserved.
  */ 
 
+#include <errno.h>
+#include <string.h>
 #include <zephyr.h>
 #include <device.h>
 #include <drivers/gpio.h>
@@ -18,13 +20,89 @@
 #include "lr1110_driver/lr1110_hal.h"
 #include "lr1110_driver/lr1110_system.h"
 #include "lr1110_driver/lr1110_system_types.h"
+#include "lr1110_driver/lr1110_regmem.h"
+#include "lr1110_driver/lr1110_radio.h"
 
 
 /* -------------------------------------------------------------------------
  * PRIVATE VARIABLES
  * ------------------------------------------------------------------------- */
-static const struct device * spi_dev;
-static struct spi_config spi_cfg;
+/* BUSY waits shorter than this are spun on, longer ones sleep on the BUSY 
+ * falling edge interrupt. Can be overridden from build system. */
+#ifndef LR1110_BUSY_SPIN_US
+#define LR1110_BUSY_SPIN_US     100
+#endif
+
+/* Reset timing, pulse width is the datasheet minimum */
+#ifndef LR1110_RESET_PULSE_US
+#define LR1110_RESET_PULSE_US           100
+#endif
+#define LR1110_RESET_BUSY_ASSERT_US     1000
+#ifndef LR1110_BOOT_TIMEOUT_MS
+#define LR1110_BOOT_TIMEOUT_MS          500
+#endif
+
+/* SPI clock used after init, and upper limit for contexts that do not set
+ * spi_max_frequency. LR1110 supports up to 16 MHz. */
+#ifndef LR1110_SPI_START_FREQUENCY
+#define LR1110_SPI_START_FREQUENCY      4000000
+#endif
+#ifndef LR1110_SPI_MAX_FREQUENCY
+#define LR1110_SPI_MAX_FREQUENCY        16000000
+#endif
+
+/* Number of read-back checks done at each auto tune step. Memory write/read
+ * check uses two words at LR1110_SPI_TUNE_SCRATCH_ADDRESS, which are 
+ * restored after tuning. Address has to be RAM not used by radio firmware.
+ * With default address 0 memory check is skipped and only version is read
+ * back, as radio data buffer can not be used: WriteBuffer8 fills TX buffer
+ * and ReadBuffer8 reads RX buffer. */
+#define LR1110_SPI_TUNE_ITERATIONS      16
+#ifndef LR1110_SPI_TUNE_SCRATCH_ADDRESS
+#define LR1110_SPI_TUNE_SCRATCH_ADDRESS 0
+#endif
+
+/* ClearIrq command, its status bytes carry IRQ status before clearing */
+#define LR1110_CLEAR_IRQ_OPCODE         0x0114
+#define LR1110_CLEAR_IRQ_LENGTH         6
+
+/* IRQs of continuous RX capture, RX timeout that keeps radio in RX */
+#define LR1110_RX_CAPTURE_IRQ_MASK      (LR1110_SYSTEM_IRQ_RX_DONE | \
+                                         LR1110_SYSTEM_IRQ_HEADER_ERROR | \
+                                         LR1110_SYSTEM_IRQ_CRC_ERROR)
+#define LR1110_RX_CONTINUOUS            0xFFFFFF
+
+/* Radio is put into idle state after this long without HAL calls, 0 keeps
+ * it awake. Idle state is sleep with retention, unless 
+ * LR1110_POWER_IDLE_STANDBY is set. Both can be changed at runtime with 
+ * lr1110_power_set_idle. */
+#ifndef LR1110_POWER_IDLE_TIMEOUT_MS
+#define LR1110_POWER_IDLE_TIMEOUT_MS    0
+#endif
+#ifndef LR1110_POWER_IDLE_STANDBY
+#define LR1110_POWER_IDLE_STANDBY       0
+#endif
+#ifndef LR1110_WAKEUP_TIMEOUT_MS
+#define LR1110_WAKEUP_TIMEOUT_MS        10
+#endif
+
+/* GetStatus command, chip mode is in bits 3:1 of Stat2 */
+#define LR1110_GET_STATUS_OPCODE        0x0100
+#define LR1110_GET_STATUS_LENGTH        6
+#define LR1110_SET_SLEEP_OPCODE         0x011B
+#define LR1110_CHIP_MODE_STBY_RC        1
+#define LR1110_CHIP_MODE_STBY_XOSC      2
+
+/* Longest response read with lr1110_hal_read, block of wifi results. Read
+ * is clocked with zeros up to this length, past it with the over-read
+ * character of SPI peripheral, which is 0xFF on nRF SPIM. */
+#ifndef LR1110_HAL_READ_MAX_LENGTH
+#define LR1110_HAL_READ_MAX_LENGTH      1020
+#endif
+
+/* Clocked out during reads, status byte included. Not const, so it stays
+ * in RAM, where SPI DMA can take it from without a copy. */
+static uint8_t read_zeros[1 + LR1110_HAL_READ_MAX_LENGTH];
 
 
 /* -------------------------------------------------------------------------
@@ -33,26 +111,32 @@ static struct spi_config spi_cfg;
 static void lr1110_set_nss(const void * context, uint8_t level);
 static lr1110_hal_status_t lr1110_hal_wait_busy(const void * context, 
                                                 uint32_t timeout_ms);
-static void lr1110_spi_write(const void * context,
-                             const uint8_t * command, 
-                             const uint16_t command_length);
-static void lr1110_spi_read(const void * context,
-                            uint8_t * data, 
-                            uint16_t data_length);
-
-
-//static void lr1110_spi_read(const void * context,
-//                            uint8_t *command, 
-//                            uint8_t size_command,
-//                            uint8_t * data, 
-//                            uint16_t data_length);
-
-
-static void lr1110_spi_write_read(const void * context, 
-                                  const uint8_t * command, 
-                                  uint8_t * data,
-                                  const uint16_t data_length);
+static lr1110_hal_status_t lr1110_hal_block_on_busy(const void * context, 
+                                                    uint32_t timeout_ms);
+static bool lr1110_busy_is_set(const void * context);
+static void lr1110_busy_isr(const struct device * port,
+                            struct gpio_callback * cb,
+                            gpio_port_pins_t pins);
+static lr1110_hal_status_t lr1110_spi_transfer(const void * context,
+                                               const struct spi_buf * tx_bufs,
+                                               size_t tx_count,
+                                               const struct spi_buf * rx_bufs,
+                                               size_t rx_count);
 static lr1110_system_rfswitch_cfg_t create_evk_shield_rf_switch();
+static void lr1110_spi_set_frequency(const void * context, uint32_t frequency);
+static uint32_t lr1110_spi_verify(const void * context, 
+                                  const lr1110_system_version_t * expected);
+static void lr1110_rx_capture_handler(struct k_work * work);
+static void lr1110_rx_capture_read_packet(struct lr1110_rx_capture * capture,
+                                          uint32_t cycles);
+static void lr1110_power_wake(const void * context);
+static void lr1110_power_touch(const void * context,
+                               const uint8_t * command,
+                               uint16_t command_length,
+                               lr1110_hal_status_t status);
+static void lr1110_power_set_state(lr1110_t * lr1110, 
+                                   enum lr1110_power_state state);
+static void lr1110_power_idle_handler(struct k_work * work);
 
 lr1110_hal_status_t lr1110_hal_wakeup(const void * context);
 /* -------------------------------------------------------------------------
@@ -74,14 +158,22 @@ void lr1110_gpio_init(const void * context)
 	gpio_pin_configure(((lr1110_t*) context)->reset.port, 
                        ((lr1110_t*) context)->reset.pin,
                        GPIO_OUTPUT_HIGH);
-    /* Busy pin, input */
+    /* Busy pin, input, falling edge interrupt is armed only while waiting */
 	gpio_pin_configure(((lr1110_t*) context)->busy.port, 
                        ((lr1110_t*) context)->busy.pin,
                        GPIO_INPUT);
-    /* LNA pin, output */
-	gpio_pin_configure(((lr1110_t*) context)->lna.port, 
-                       ((lr1110_t*) context)->lna.pin,
-                       GPIO_OUTPUT_LOW);
+    k_sem_init(&((lr1110_t*) context)->busy_sem, 0, 1);
+    gpio_init_callback(&((lr1110_t*) context)->busy_cb_data,
+                       lr1110_busy_isr,
+                       BIT(((lr1110_t*) context)->busy.pin));
+    gpio_add_callback(((lr1110_t*) context)->busy.port,
+                      &((lr1110_t*) context)->busy_cb_data);
+    /* LNA pin, output, optional */
+    if (((lr1110_t*) context)->lna.port != NULL) {
+        gpio_pin_configure(((lr1110_t*) context)->lna.port, 
+                           ((lr1110_t*) context)->lna.pin,
+                           GPIO_OUTPUT_LOW);
+    }
 
 	gpio_pin_configure(((lr1110_t*) context)->event.port, 
                        ((lr1110_t*) context)->event.pin,
@@ -94,23 +186,47 @@ void lr1110_gpio_init(const void * context)
  *
  * @param[in] context   Radio abstraction
  * @note                Nss pin has to be controlled manually, as automatic 
- *                      control thourgh spi_cs_ctrl does not work
+ *                      control thourgh spi_cs_ctrl does not work.
+ *                      Bus state and lock are kept in the context, so 
+ *                      multiple LR1110 instances can be used at once.
+ *                      Bus starts at LR1110_SPI_START_FREQUENCY, higher 
+ *                      clock can be selected with lr1110_spi_autotune.
  */
 void lr1110_spi_init(const void * context)
 {
-    spi_dev = device_get_binding(((lr1110_t*) context)->spi_dev_label);
+    lr1110_t * lr1110 = (lr1110_t*) context;
 
-    if (!spi_dev){
-        printk("spi device not found: %s\n", 
-                ((lr1110_t*) context)->spi_dev_label);
+    /* Lock could be held or waited on, if radio is initialized again */
+    if (!lr1110->lock_initialized) {
+        k_mutex_init(&lr1110->lock);
+        lr1110->lock_initialized = true;
     }
 
-    spi_cfg.operation = (SPI_OP_MODE_MASTER | 
-                         SPI_TRANSFER_MSB | 
-                         SPI_WORD_SET(8));
+    /* Context built from devicetree already has its bus and frequency */
+    if (!lr1110->spi_dev) {
+        lr1110->spi_dev = device_get_binding(lr1110->spi_dev_label);
+    }
 
-    spi_cfg.frequency = 4000000;
-    spi_cfg.slave = 0;
+    if (!lr1110->spi_dev){
+        printk("spi device not found: %s\n", lr1110->spi_dev_label);
+    }
+
+    if (!lr1110->spi_max_frequency) {
+        lr1110->spi_max_frequency = LR1110_SPI_MAX_FREQUENCY;
+    }
+
+    /* Spare config becomes active, as on each clock change, so driver
+     * does not keep bus setup of the active one on re-init */
+    struct spi_config * spi_cfg = &lr1110->spi_cfg[lr1110->spi_cfg_idx ^ 1];
+
+    /* Keeps slave and other fields set by context definition */
+    *spi_cfg = lr1110->spi_cfg[lr1110->spi_cfg_idx];
+    spi_cfg->operation = (SPI_OP_MODE_MASTER | 
+                          SPI_TRANSFER_MSB | 
+                          SPI_WORD_SET(8));
+    spi_cfg->frequency = MIN(LR1110_SPI_START_FREQUENCY, 
+                             lr1110->spi_max_frequency);
+    lr1110->spi_cfg_idx ^= 1;
 }
 
 
@@ -131,16 +247,35 @@ lr1110_hal_status_t lr1110_hal_write(const void * context,
                                      const uint8_t * data, 
                                      const uint16_t data_length)
 {
-    if(lr1110_hal_wait_busy(context, 2000)) {
-        return LR1110_HAL_STATUS_ERROR;
-    }
+    const struct spi_buf tx_bufs[] = {
+        { .buf = (uint8_t*) command, .len = command_length },
+        { .buf = (uint8_t*) data,    .len = data_length },
+    };
 
-    lr1110_set_nss(context, 0);
-    lr1110_spi_write(context, command, command_length);
-    lr1110_spi_write(context, data, data_length);
-    lr1110_set_nss(context, 1);
+    k_mutex_lock(&((lr1110_t*) context)->lock, K_FOREVER);
+    ((lr1110_t*) context)->hal_stats.hal_calls++;
+    lr1110_power_wake(context);
+#if LR1110_HAL_TRACE
+    struct lr1110_hal_trace_span span;
+    lr1110_hal_trace_begin(context, &span);
+#endif
+
+    lr1110_hal_status_t status = lr1110_hal_wait_busy(context, 2000);
+
+    /* Command and data go out in one transaction, empty data is skipped */
+    if (status == LR1110_HAL_STATUS_OK) {
+        status = lr1110_spi_transfer(context, 
+                                     tx_bufs, (data_length > 0) ? 2 : 1, 
+                                     NULL, 0);
+    }
 
-    return LR1110_HAL_STATUS_OK;
+#if LR1110_HAL_TRACE
+    lr1110_hal_trace_end(context, &span, LR1110_HAL_TRACE_WRITE,
+                         command, command_length, data, data_length, status);
+#endif
+    lr1110_power_touch(context, command, command_length, status);
+    k_mutex_unlock(&((lr1110_t*) context)->lock);
+    return status;
 }
 
 
@@ -161,28 +296,56 @@ lr1110_hal_status_t lr1110_hal_read(const void * context,
                                     uint8_t * data, 
                                     const uint16_t data_length)
 {
-    uint8_t dummy = 0x00;
+    const struct spi_buf cmd_buf = { 
+        .buf = (uint8_t*) command, 
+        .len = command_length 
+    };
+    /* First received byte is status, it is discarded. Whole transaction,
+     * status byte and data, is clocked with zeros (NOP). */
+    const struct spi_buf zeros_buf = { 
+        .buf = read_zeros, 
+        .len = MIN(1 + data_length, sizeof(read_zeros))
+    };
+    const struct spi_buf rx_bufs[] = {
+        { .buf = NULL, .len = 1 },
+        { .buf = data, .len = data_length },
+    };
 
-    if(lr1110_hal_wait_busy(context, 2000)) {
-        return LR1110_HAL_STATUS_ERROR;
-    }
+    /* Both transactions are done under the lock, so no other command can
+     * get in between them */
+    k_mutex_lock(&((lr1110_t*) context)->lock, K_FOREVER);
+    ((lr1110_t*) context)->hal_stats.hal_calls++;
+    lr1110_power_wake(context);
+#if LR1110_HAL_TRACE
+    struct lr1110_hal_trace_span span;
+    lr1110_hal_trace_begin(context, &span);
+#endif
+
+    lr1110_hal_status_t status = lr1110_hal_wait_busy(context, 2000);
 
     /* 1st SPI transaction */
-    lr1110_set_nss(context, 0);
-    lr1110_spi_write(context, command, command_length);
-    lr1110_set_nss(context, 1);
+    if (status == LR1110_HAL_STATUS_OK) {
+        status = lr1110_spi_transfer(context, &cmd_buf, 1, NULL, 0);
+    }
 
-    if(lr1110_hal_wait_busy(context, 2000)) {
-        return LR1110_HAL_STATUS_ERROR;
+    if (status == LR1110_HAL_STATUS_OK) {
+        status = lr1110_hal_wait_busy(context, 2000);
     }
 
     /* 2nd SPI transaction */
-    lr1110_set_nss(context, 0);
-    lr1110_spi_write(context, &dummy, 1);
-    lr1110_spi_read(context, data, data_length);
-    lr1110_set_nss(context, 1);
+    if (status == LR1110_HAL_STATUS_OK) {
+        status = lr1110_spi_transfer(context, 
+                                     &zeros_buf, 1, 
+                                     rx_bufs, (data_length > 0) ? 2 : 1);
+    }
 
-    return LR1110_HAL_STATUS_OK;
+#if LR1110_HAL_TRACE
+    lr1110_hal_trace_end(context, &span, LR1110_HAL_TRACE_READ,
+                         command, command_length, data, data_length, status);
+#endif
+    lr1110_power_touch(context, command, command_length, status);
+    k_mutex_unlock(&((lr1110_t*) context)->lock);
+    return status;
 }
 
 
@@ -201,15 +364,36 @@ lr1110_hal_status_t lr1110_hal_write_read(const void * context,
                                           uint8_t * data, 
                                           const uint16_t data_length)
 {
-    if(lr1110_hal_wait_busy(context, 2000)) {
-        return LR1110_HAL_STATUS_ERROR;
-    }
+    const struct spi_buf tx_buf = {
+        .buf = (uint8_t*) command,
+        .len = data_length
+    };
+    const struct spi_buf rx_buf = {
+        .buf = data,
+        .len = data_length
+    };
 
-    lr1110_set_nss(context, 0);
-    lr1110_spi_write_read(context, command, data, data_length);
-    lr1110_set_nss(context, 1);
+    k_mutex_lock(&((lr1110_t*) context)->lock, K_FOREVER);
+    ((lr1110_t*) context)->hal_stats.hal_calls++;
+    lr1110_power_wake(context);
+#if LR1110_HAL_TRACE
+    struct lr1110_hal_trace_span span;
+    lr1110_hal_trace_begin(context, &span);
+#endif
+
+    lr1110_hal_status_t status = lr1110_hal_wait_busy(context, 2000);
+
+    if (status == LR1110_HAL_STATUS_OK) {
+        status = lr1110_spi_transfer(context, &tx_buf, 1, &rx_buf, 1);
+    }
 
-    return LR1110_HAL_STATUS_OK;
+#if LR1110_HAL_TRACE
+    lr1110_hal_trace_end(context, &span, LR1110_HAL_TRACE_WRITE_READ,
+                         command, data_length, data, data_length, status);
+#endif
+    lr1110_power_touch(context, command, data_length, status);
+    k_mutex_unlock(&((lr1110_t*) context)->lock);
+    return status;
 }
 
 
@@ -235,6 +419,382 @@ lr1110_status_t lr1110_rf_switch_init(const void * context)
 }
 
 
+/*!
+ * @brief               Returns SPI clock currently in use
+ *
+ * @param[in] context   Radio abstraction
+ *
+ * @return              Frequency in Hz
+ */
+uint32_t lr1110_spi_get_frequency(const void * context)
+{
+    lr1110_t * lr1110 = (lr1110_t*) context;
+
+    return lr1110->spi_cfg[lr1110->spi_cfg_idx].frequency;
+}
+
+
+/*!
+ * @brief               Finds highest reliable SPI clock. Clock is doubled,
+ *                      up to spi_max_frequency, and at each step link is 
+ *                      verified with read-back commands. Highest clock that
+ *                      passed all checks is kept.
+ *
+ * @param[in] context   Radio abstraction, radio has to be initialized
+ * @param[out] result   Selected clock and error counts
+ *
+ * @return              0 on success, -EIO if radio does not respond at 
+ *                      start clock.
+ */
+int lr1110_spi_autotune(const void * context, 
+                        struct lr1110_spi_tune_result * result)
+{
+    lr1110_t * lr1110 = (lr1110_t*) context;
+    lr1110_system_version_t expected;
+    uint32_t scratch[2] = { 0 };
+    uint32_t frequency = MIN(LR1110_SPI_START_FREQUENCY, 
+                             lr1110->spi_max_frequency);
+
+    memset(result, 0, sizeof(*result));
+
+    k_mutex_lock(&lr1110->lock, K_FOREVER);
+
+    /* Reference values are read at start clock, which is known to work */
+    lr1110_spi_set_frequency(context, frequency);
+    if (lr1110_system_get_version(context, &expected) ||
+        (LR1110_SPI_TUNE_SCRATCH_ADDRESS &&
+         lr1110_regmem_read_regmem32(context, 
+                                     LR1110_SPI_TUNE_SCRATCH_ADDRESS,
+                                     scratch, 2))) {
+        k_mutex_unlock(&lr1110->lock);
+        return -EIO;
+    }
+    if (lr1110_spi_verify(context, &expected)) {
+        if (LR1110_SPI_TUNE_SCRATCH_ADDRESS) {
+            lr1110_regmem_write_regmem32(context, 
+                                         LR1110_SPI_TUNE_SCRATCH_ADDRESS,
+                                         scratch, 2);
+        }
+        k_mutex_unlock(&lr1110->lock);
+        return -EIO;
+    }
+    result->frequency = frequency;
+
+    while (frequency < lr1110->spi_max_frequency) {
+        frequency = MIN(frequency * 2, lr1110->spi_max_frequency);
+
+        lr1110_spi_set_frequency(context, frequency);
+        result->steps++;
+
+        uint32_t errors = lr1110_spi_verify(context, &expected);
+
+        if (errors) {
+            result->errors += errors;
+            result->failed_frequency = frequency;
+            break;
+        }
+        result->frequency = frequency;
+    }
+
+    lr1110_spi_set_frequency(context, result->frequency);
+    if (LR1110_SPI_TUNE_SCRATCH_ADDRESS) {
+        lr1110_regmem_write_regmem32(context, 
+                                     LR1110_SPI_TUNE_SCRATCH_ADDRESS,
+                                     scratch, 2);
+    }
+
+    k_mutex_unlock(&lr1110->lock);
+    return 0;
+}
+
+
+/*!
+ * @brief               Copies HAL statistics collected since the last reset
+ *
+ * @param[in] context   Radio abstraction
+ * @param[out] stats    Statistics
+ */
+void lr1110_hal_get_stats(const void * context, struct lr1110_hal_stats * stats)
+{
+    *stats = ((lr1110_t*) context)->hal_stats;
+}
+
+
+/*!
+ * @brief               Resets HAL statistics
+ *
+ * @param[in] context   Radio abstraction
+ */
+void lr1110_hal_reset_stats(const void * context)
+{
+    memset(&((lr1110_t*) context)->hal_stats, 0, 
+           sizeof(struct lr1110_hal_stats));
+}
+
+
+/*!
+ * @brief               Takes snapshot of HAL statistics before a sequence
+ *                      of commands
+ *
+ * @param[in] context   Radio abstraction, has to be locked
+ * @param[out] snapshot Snapshot
+ */
+void lr1110_hal_traffic_begin(const void * context,
+                              struct lr1110_hal_snapshot * snapshot)
+{
+    lr1110_hal_get_stats(context, &snapshot->stats);
+    snapshot->start = k_cycle_get_32();
+}
+
+
+/*!
+ * @brief               Adds time and HAL traffic since 
+ *                      lr1110_hal_traffic_begin
+ *
+ * @param[in] context   Radio abstraction, has to be locked
+ * @param[in] snapshot  Snapshot taken by lr1110_hal_traffic_begin
+ * @param[in,out] traffic   Traffic that is accumulated
+ */
+void lr1110_hal_traffic_end(const void * context,
+                            const struct lr1110_hal_snapshot * snapshot,
+                            struct lr1110_hal_traffic * traffic)
+{
+    struct lr1110_hal_stats stats;
+    uint32_t duration_us = k_cyc_to_us_floor32(k_cycle_get_32() - 
+                                               snapshot->start);
+
+    lr1110_hal_get_stats(context, &stats);
+
+    traffic->duration_us += duration_us;
+    traffic->hal_calls += stats.hal_calls - snapshot->stats.hal_calls;
+    traffic->spi_bytes += stats.spi_bytes - snapshot->stats.spi_bytes;
+    traffic->busy_us += stats.busy_wait_total_us - 
+                        snapshot->stats.busy_wait_total_us;
+}
+
+
+/*!
+ * @brief               Initializes power manager, radio is considered
+ *                      active. On first call idle timeout and state are 
+ *                      taken from LR1110_POWER_IDLE_TIMEOUT_MS and
+ *                      LR1110_POWER_IDLE_STANDBY, on re-initialization
+ *                      configured ones and statistics are kept and pending
+ *                      idle timeout is cancelled. Next HAL call starts it 
+ *                      again.
+ *
+ * @param[in] context   Radio abstraction
+ */
+void lr1110_power_init(const void * context)
+{
+    lr1110_t * lr1110 = (lr1110_t*) context;
+    struct lr1110_power * power = &lr1110->power;
+
+    k_mutex_lock(&lr1110->lock, K_FOREVER);
+
+    if (!power->initialized) {
+        k_work_init_delayable(&power->idle_work, lr1110_power_idle_handler);
+        power->idle_timeout_ms = LR1110_POWER_IDLE_TIMEOUT_MS;
+        power->idle_state = LR1110_POWER_IDLE_STANDBY ? 
+                            LR1110_POWER_STANDBY : LR1110_POWER_SLEEP;
+        power->state = LR1110_POWER_ACTIVE;
+        power->state_since = k_uptime_get();
+        power->initialized = true;
+    }
+    else {
+        /* Idle handler that is already running gives up on the lock */
+        k_work_cancel_delayable(&power->idle_work);
+        lr1110_power_set_state(lr1110, LR1110_POWER_ACTIVE);
+    }
+
+    k_mutex_unlock(&lr1110->lock);
+}
+
+
+/*!
+ * @brief               Sets how long radio can stay idle before it is put
+ *                      into idle state. Radio is woken up by the next HAL 
+ *                      call, so drivers and callers do not have to handle
+ *                      sleep themselves.
+ *
+ * @param[in] context   Radio abstraction
+ * @param[in] timeout_ms Idle time, 0 disables automatic idle
+ * @param[in] idle_state LR1110_POWER_STANDBY or LR1110_POWER_SLEEP
+ */
+void lr1110_power_set_idle(const void * context,
+                           uint32_t timeout_ms,
+                           enum lr1110_power_state idle_state)
+{
+    lr1110_t * lr1110 = (lr1110_t*) context;
+
+    k_mutex_lock(&lr1110->lock, K_FOREVER);
+    lr1110->power.idle_timeout_ms = timeout_ms;
+    lr1110->power.idle_state = (idle_state == LR1110_POWER_STANDBY) ? 
+                               LR1110_POWER_STANDBY : LR1110_POWER_SLEEP;
+    if (timeout_ms) {
+        k_work_reschedule(&lr1110->power.idle_work, K_MSEC(timeout_ms));
+    }
+    else {
+        k_work_cancel_delayable(&lr1110->power.idle_work);
+    }
+    k_mutex_unlock(&lr1110->lock);
+}
+
+
+/*!
+ * @brief               Returns power state as tracked by HAL
+ *
+ * @param[in] context   Radio abstraction
+ */
+enum lr1110_power_state lr1110_power_get_state(const void * context)
+{
+    return ((lr1110_t*) context)->power.state;
+}
+
+
+/*!
+ * @brief               Copies power statistics, time in current state is
+ *                      included up to now
+ *
+ * @param[in] context   Radio abstraction
+ * @param[out] stats    Statistics
+ */
+void lr1110_power_get_stats(const void * context,
+                            struct lr1110_power_stats * stats)
+{
+    lr1110_t * lr1110 = (lr1110_t*) context;
+
+    k_mutex_lock(&lr1110->lock, K_FOREVER);
+    lr1110_power_set_state(lr1110, lr1110->power.state);
+    *stats = lr1110->power.stats;
+    k_mutex_unlock(&lr1110->lock);
+}
+
+
+/*!
+ * @brief               Clears IRQs and returns IRQ status from before the
+ *                      clear, with one SPI transaction instead of separate
+ *                      GetStatus and ClearIrq commands
+ *
+ * @param[in] context   Radio abstraction
+ * @param[in] irq_mask  IRQs to clear
+ * @param[out] irq_status IRQ status before clearing
+ *
+ * @return              HAL status
+ */
+lr1110_hal_status_t
+lr1110_hal_clear_irq_status(const void * context,
+                            lr1110_system_irq_mask_t irq_mask,
+                            lr1110_system_irq_mask_t * irq_status)
+{
+    const uint8_t command[LR1110_CLEAR_IRQ_LENGTH] = {
+        LR1110_CLEAR_IRQ_OPCODE >> 8, LR1110_CLEAR_IRQ_OPCODE & 0xFF,
+        irq_mask >> 24, irq_mask >> 16, irq_mask >> 8, irq_mask,
+    };
+    /* Stat1, Stat2, then IRQ status, big endian */
+    uint8_t status[LR1110_CLEAR_IRQ_LENGTH];
+
+    lr1110_hal_status_t hal_status = 
+        lr1110_hal_write_read(context, command, status, sizeof(status));
+
+    *irq_status = ((uint32_t) status[2] << 24) | 
+                  ((uint32_t) status[3] << 16) | 
+                  ((uint32_t) status[4] << 8) | 
+                  status[5];
+    return hal_status;
+}
+
+
+/*!
+ * @brief               Starts continuous LoRa RX capture. Radio has to be
+ *                      configured with lr1110_lora_init first. Capture
+ *                      takes radio IRQs over, each RX_DONE is handled in
+ *                      radio work queue with as few SPI transactions as
+ *                      possible and packet is put into capture ring.
+ *
+ * @param[in] context   Radio abstraction
+ * @param[in] capture   Capture state
+ *
+ * @return              0 on success, -EIO on radio error
+ */
+int lr1110_rx_capture_start(void * context, struct lr1110_rx_capture * capture)
+{
+    if (capture->context == NULL) {
+        /* First use, work is never reinitialized as it could be queued */
+        k_work_init(&capture->work, lr1110_rx_capture_handler);
+        lr1110_packet_ring_init(&capture->ring, capture->packets,
+                                LR1110_RX_CAPTURE_RING_SIZE);
+    }
+    capture->context = context;
+    lr1110_packet_ring_reset(&capture->ring);
+    memset(&capture->stats, 0, sizeof(capture->stats));
+
+    lr1110_lock(context, K_FOREVER);
+
+    int err = lr1110_irq_register(context, LR1110_IRQ_SOURCE_RADIO,
+                                  LR1110_RX_CAPTURE_IRQ_MASK, &capture->work);
+
+    if (!err && lr1110_radio_set_rx_with_timeout_in_rtc_step(
+                    context, LR1110_RX_CONTINUOUS)) {
+        err = -EIO;
+    }
+    lr1110_unlock(context);
+
+    return err;
+}
+
+
+/*!
+ * @brief               Stops capture and puts radio into standby. Packets
+ *                      in ring can still be read.
+ *
+ * @param[in] capture   Capture state
+ *
+ * @return              0 on success, -EIO on radio error
+ */
+int lr1110_rx_capture_stop(struct lr1110_rx_capture * capture)
+{
+    lr1110_t * lr1110 = (lr1110_t*) capture->context;
+    lr1110_status_t status;
+
+    lr1110_lock(lr1110, K_FOREVER);
+
+    lr1110_irq_unregister(lr1110, LR1110_IRQ_SOURCE_RADIO, &capture->work);
+    status = lr1110_system_set_standby(lr1110, LR1110_SYSTEM_STANDBY_CFG_RC);
+    lr1110_clear_event(lr1110, LR1110_RX_CAPTURE_IRQ_MASK);
+
+    lr1110_unlock(lr1110);
+    k_work_cancel(&capture->work);
+
+    return status ? -EIO : 0;
+}
+
+
+/*!
+ * @brief               Takes oldest captured packet
+ *
+ * @param[in] capture   Capture state
+ * @param[out] packet   Packet, timestamp is in hardware cycles
+ * @param[in] timeout   How long to wait for a packet, K_NO_WAIT to poll
+ *
+ * @return              0 on success, -EAGAIN if there was no packet
+ */
+int lr1110_rx_capture_read(struct lr1110_rx_capture * capture,
+                           struct lr1110_lora_packet * packet,
+                           k_timeout_t timeout)
+{
+    return lr1110_packet_ring_read(&capture->ring, packet, timeout);
+}
+
+
+void lr1110_rx_capture_get_stats(struct lr1110_rx_capture * capture,
+                                 struct lr1110_rx_capture_stats * stats)
+{
+    lr1110_lock(capture->context, K_FOREVER);
+    *stats = capture->stats;
+    lr1110_unlock(capture->context);
+}
+
+
 /*!
  * @brief               Function returns rf switch configuration for 
  *                      LR1110 EVK shield
@@ -272,6 +832,75 @@ static lr1110_system_rfswitch_cfg_t create_evk_shield_rf_switch()
  * ------------------------------------------------------------------------- */
 
 
+/*!
+ * @brief                       Changes SPI clock
+ *
+ * @param[in] context           Radio abstraction
+ * @param[in] frequency         Clock in Hz
+ *
+ * @note                        Zephyr SPI drivers reconfigure the bus only 
+ *                              when a different spi_config pointer is 
+ *                              passed, so new clock is written to the spare
+ *                              config, which then becomes active.
+ */
+static void lr1110_spi_set_frequency(const void * context, uint32_t frequency)
+{
+    lr1110_t * lr1110 = (lr1110_t*) context;
+    uint8_t next = lr1110->spi_cfg_idx ^ 1;
+
+    lr1110->spi_cfg[next] = lr1110->spi_cfg[lr1110->spi_cfg_idx];
+    lr1110->spi_cfg[next].frequency = frequency;
+    lr1110->spi_cfg_idx = next;
+}
+
+
+/*!
+ * @brief                       Checks SPI link at current clock
+ *
+ * @param[in] context           Radio abstraction
+ * @param[in] expected          Version read at known good clock
+ *
+ * @return                      Number of failed checks
+ */
+static uint32_t lr1110_spi_verify(const void * context, 
+                                  const lr1110_system_version_t * expected)
+{
+    uint32_t errors = 0;
+
+    for (int i = 0; i < LR1110_SPI_TUNE_ITERATIONS; i++)
+    {
+        lr1110_system_version_t version;
+
+        if (lr1110_system_get_version(context, &version) ||
+            version.hw != expected->hw ||
+            version.type != expected->type ||
+            version.fw != expected->fw) {
+            errors++;
+        }
+
+        if (!LR1110_SPI_TUNE_SCRATCH_ADDRESS) {
+            continue;
+        }
+
+        /* Alternating and walking bit patterns */
+        uint32_t pattern[2] = { 0x55AA55AA ^ (i & 1 ? 0xFFFFFFFF : 0), 
+                                1UL << (i % 32) };
+        uint32_t read_back[2] = { 0 };
+
+        if (lr1110_regmem_write_regmem32(context, 
+                                         LR1110_SPI_TUNE_SCRATCH_ADDRESS,
+                                         pattern, 2) ||
+            lr1110_regmem_read_regmem32(context, 
+                                        LR1110_SPI_TUNE_SCRATCH_ADDRESS,
+                                        read_back, 2) ||
+            memcmp(pattern, read_back, sizeof(pattern))) {
+            errors++;
+        }
+    }
+    return errors;
+}
+
+
 /*!
  * @brief                       Set slave select line
  *
@@ -286,24 +915,40 @@ static void lr1110_set_nss(const void * context, uint8_t level)
 
 
 /*!
- * @brief                       Perform reset of LR1110 chip
+ * @brief                       Perform reset of LR1110 chip. Returns once 
+ *                              chip finished its startup sequence and 
+ *                              released BUSY line.
  *
  * @param[in] context           Radio abstraction
+ *
+ * @return status               HAL status
  */
 lr1110_hal_status_t lr1110_hal_reset(const void * context)
 {
 	gpio_pin_set(((lr1110_t*) context)->reset.port, 
                  ((lr1110_t*) context)->reset.pin, 0);
-    k_sleep(K_MSEC(500));
+    k_busy_wait(LR1110_RESET_PULSE_US);
 	gpio_pin_set(((lr1110_t*) context)->reset.port, 
                  ((lr1110_t*) context)->reset.pin, 1);
 
-    return LR1110_HAL_STATUS_OK;
+    /* BUSY is raised shortly after reset is released, waiting for it to go
+     * low before that would return immediately */
+    uint32_t start = k_cycle_get_32();
+    uint32_t assert_cycles = k_us_to_cyc_ceil32(LR1110_RESET_BUSY_ASSERT_US);
+
+    while (!lr1110_busy_is_set(context) && 
+           (k_cycle_get_32() - start) < assert_cycles);
+
+    lr1110_power_set_state((lr1110_t*) context, LR1110_POWER_ACTIVE);
+    return lr1110_hal_wait_busy(context, LR1110_BOOT_TIMEOUT_MS);
 }
 
 
 /*!
- * @brief                       Perform wakeup sequence of LR1110 chip
+ * @brief                       Perform wakeup sequence of LR1110 chip. NSS
+ *                              is held low until chip releases BUSY, so 
+ *                              wakeup takes as long as the chip needs 
+ *                              instead of a fixed delay.
  *
  * @param[in] context           Radio abstraction
  *
@@ -311,15 +956,32 @@ lr1110_hal_status_t lr1110_hal_reset(const void * context)
  */
 lr1110_hal_status_t lr1110_hal_wakeup(const void * context)
 {
+    lr1110_t * lr1110 = (lr1110_t*) context;
+    struct lr1110_power_stats * stats = &lr1110->power.stats;
+    uint32_t start = k_cycle_get_32();
+
     lr1110_set_nss(context, 0);
-    k_sleep(K_MSEC(1));
+    lr1110_hal_status_t status = 
+        lr1110_hal_wait_busy(context, LR1110_WAKEUP_TIMEOUT_MS);
     lr1110_set_nss(context, 1);
 
-    return LR1110_HAL_STATUS_OK;
+    uint32_t wakeup_us = k_cyc_to_us_floor32(k_cycle_get_32() - start);
+
+    stats->wakeups++;
+    stats->wakeup_us_last = wakeup_us;
+    if (wakeup_us > stats->wakeup_us_max) {
+        stats->wakeup_us_max = wakeup_us;
+    }
+
+    lr1110_power_set_state(lr1110, LR1110_POWER_ACTIVE);
+    return status;
 }
 
+
 /*!
- * @brief                       Perform wakeup sequence of LR1110 chip
+ * @brief                       Wait until LR1110 releases BUSY line. Short 
+ *                              waits are spun on, longer ones sleep until 
+ *                              BUSY falling edge interrupt.
  *
  * @param[in] context           Radio abstraction
  * @param[in] timeout_ms        Timeout in milliseconds
@@ -329,114 +991,359 @@ lr1110_hal_status_t lr1110_hal_wakeup(const void * context)
 static lr1110_hal_status_t lr1110_hal_wait_busy(const void * context, 
                                                 uint32_t timeout_ms)
 {
-    uint32_t start = k_uptime_get();
+    struct lr1110_hal_stats * stats = &((lr1110_t*) context)->hal_stats;
+    lr1110_hal_status_t status = LR1110_HAL_STATUS_OK;
+    uint32_t spin_cycles = k_us_to_cyc_ceil32(LR1110_BUSY_SPIN_US);
+    uint32_t start = k_cycle_get_32();
 
     /* Wait while busy is HIGH */
-	while (1 == gpio_pin_get(((lr1110_t*) context)->busy.port, 
-                             ((lr1110_t*) context)->busy.pin))
+    while (lr1110_busy_is_set(context))
     {
-        if ((k_uptime_get() - start) > timeout_ms)
+        if ((k_cycle_get_32() - start) > spin_cycles)
         {
-            printk("------------------------------------------------------\n");
-            printk("WAIT BUSY TIMEOUTED\n");
-            printk("THIS SHOULD NOT HAPPEN\n");
-            printk("------------------------------------------------------\n");
-            return LR1110_HAL_STATUS_ERROR;
+            status = lr1110_hal_block_on_busy(context, timeout_ms);
+            break;
         }
     }
-    return LR1110_HAL_STATUS_OK;
+
+    uint32_t wait_us = k_cyc_to_us_floor32(k_cycle_get_32() - start);
+
+    stats->busy_waits++;
+    stats->busy_wait_last_us = wait_us;
+    stats->busy_wait_total_us += wait_us;
+    if (wait_us > stats->busy_wait_max_us) {
+        stats->busy_wait_max_us = wait_us;
+    }
+
+    if (status != LR1110_HAL_STATUS_OK)
+    {
+        stats->busy_timeouts++;
+        printk("------------------------------------------------------\n");
+        printk("WAIT BUSY TIMEOUTED\n");
+        printk("THIS SHOULD NOT HAPPEN\n");
+        printk("------------------------------------------------------\n");
+    }
+    return status;
 }
 
 
 /*!
- * @brief                       Wrapper for SPI write communication
+ * @brief                       Sleep until BUSY line goes low
  *
  * @param[in] context           Radio abstraction
- * @param[in] command           Pointer to command bytes
- * @param[in] command_length
+ * @param[in] timeout_ms        Timeout in milliseconds
  *
- * @note                        NSS line is toggled manually.
+ * @return status               HAL status
+ *
+ * @note                        HAL is used from threads only, every 
+ *                              transaction takes the radio mutex first, 
+ *                              which can not be done in ISR either.
  */
-static void lr1110_spi_write(const void * context,
-                             const uint8_t * command,
-                             uint16_t command_length)
+static lr1110_hal_status_t lr1110_hal_block_on_busy(const void * context, 
+                                                    uint32_t timeout_ms)
 {
-    struct spi_buf tx_buf = {
-        .buf = (uint8_t*) command,
-        .len = command_length
-    };
+    lr1110_t * lr1110 = (lr1110_t*) context;
 
-    const struct spi_buf_set tx = {
-        .buffers = &tx_buf,
-        .count = 1
-    };
+    __ASSERT_NO_MSG(!k_is_in_isr());
+
+    lr1110->hal_stats.busy_blocked++;
+
+    k_sem_reset(&lr1110->busy_sem);
+    gpio_pin_interrupt_configure(lr1110->busy.port, 
+                                 lr1110->busy.pin,
+                                 GPIO_INT_EDGE_TO_INACTIVE);
 
-    spi_write(spi_dev, &spi_cfg, &tx);
+    /* BUSY could have fallen before the interrupt was armed */
+    if (lr1110_busy_is_set(context)) {
+        k_sem_take(&lr1110->busy_sem, K_MSEC(timeout_ms));
+    }
+
+    gpio_pin_interrupt_configure(lr1110->busy.port, 
+                                 lr1110->busy.pin,
+                                 GPIO_INT_DISABLE);
+
+    return lr1110_busy_is_set(context) ? LR1110_HAL_STATUS_ERROR : 
+                                         LR1110_HAL_STATUS_OK;
 }
 
 
 /*!
- * @brief                       Wrapper for SPI read communication
+ * @brief                       Read BUSY line
  *
  * @param[in] context           Radio abstraction
- * @param[out] data             Pointer to data array, that comes from LR1110
- * @param[in] data_length       
  *
- * @note                        NSS line is toggled manually.
+ * @return                      True if LR1110 is busy
  */
-static void lr1110_spi_read(const void * context,
-                            //uint8_t *command, 
-                            //uint8_t size_command,
-                            uint8_t * data, 
-                            uint16_t data_length)
+static bool lr1110_busy_is_set(const void * context)
 {
-    struct spi_buf rx_buf = {
-        .buf = data,
-        .len = data_length
-    };
+    return 1 == gpio_pin_get(((lr1110_t*) context)->busy.port, 
+                             ((lr1110_t*) context)->busy.pin);
+}
 
-    const struct spi_buf_set rx = {
-        .buffers = &rx_buf,
-        .count = 1
-    };
 
-    spi_read(spi_dev, &spi_cfg, &rx);
+/*!
+ * @brief                       BUSY falling edge interrupt handler
+ */
+static void lr1110_busy_isr(const struct device * port,
+                            struct gpio_callback * cb,
+                            gpio_port_pins_t pins)
+{
+    lr1110_t * lr1110 = CONTAINER_OF(cb, lr1110_t, busy_cb_data);
+
+    k_sem_give(&lr1110->busy_sem);
 }
 
+
 /*!
- * @brief                       Wrapper for SPI read communication
+ * @brief                       Performs one NSS framed SPI transfer, made of 
+ *                              multiple buffers
  *
  * @param[in] context           Radio abstraction
- * @param[in] command           
- * @param[out] data             Pointer to data array, that comes from LR1110
- * @param[in] data_length       Length of command and data
+ * @param[in] tx_bufs           Buffers that are transmitted, back to back
+ * @param[in] tx_count          Number of tx buffers
+ * @param[out] rx_bufs          Buffers that are received, back to back, 
+ *                              buffer with NULL pointer is discarded
+ * @param[in] rx_count          Number of rx buffers, can be 0
+ *
+ * @return status               HAL status
  *
  * @note                        NSS line is toggled manually.
  */
-static void lr1110_spi_write_read(const void * context, 
-                                  const uint8_t * command, 
-                                  uint8_t * data,
-                                  const uint16_t data_length)
+static lr1110_hal_status_t lr1110_spi_transfer(const void * context,
+                                               const struct spi_buf * tx_bufs,
+                                               size_t tx_count,
+                                               const struct spi_buf * rx_bufs,
+                                               size_t rx_count)
 {
-    const struct spi_buf tx_buf = {
-        .buf = (uint8_t*) command,
-        .len = data_length
-    };
-    struct spi_buf rx_buf = {
-        .buf = data,
-        .len = data_length
-    };
+    lr1110_t * lr1110 = (lr1110_t*) context;
+    struct lr1110_hal_stats * stats = &lr1110->hal_stats;
+    size_t tx_bytes = 0;
+    size_t rx_bytes = 0;
 
     const struct spi_buf_set tx = {
-      .buffers = &tx_buf,
-      .count = 1
+        .buffers = tx_bufs,
+        .count = tx_count
+    };
+    const struct spi_buf_set rx = {
+        .buffers = rx_bufs,
+        .count = rx_count
     };
-    struct spi_buf_set rx = {
-      .buffers = &rx_buf,
-      .count = 1
+
+    for (size_t i = 0; i < tx_count; i++) {
+        tx_bytes += tx_bufs[i].len;
+    }
+    for (size_t i = 0; i < rx_count; i++) {
+        rx_bytes += rx_bufs[i].len;
+    }
+
+    lr1110_set_nss(context, 0);
+    int err = spi_transceive(lr1110->spi_dev, 
+                             &lr1110->spi_cfg[lr1110->spi_cfg_idx], 
+                             &tx, rx_count ? &rx : NULL);
+    lr1110_set_nss(context, 1);
+
+    stats->spi_transactions++;
+    stats->spi_bytes += MAX(tx_bytes, rx_bytes);
+
+    return err ? LR1110_HAL_STATUS_ERROR : LR1110_HAL_STATUS_OK;
+}
+
+
+
+/*!
+ * @brief               RX capture work, submitted by IRQ dispatcher. 
+ *                      Dispatcher has already cleared IRQs and armed event
+ *                      interrupt, so next RX_DONE is caught while this 
+ *                      packet is read. Radio itself stays in continuous RX.
+ */
+static void lr1110_rx_capture_handler(struct k_work * work)
+{
+    struct lr1110_rx_capture * capture =
+        CONTAINER_OF(work, struct lr1110_rx_capture, work);
+    lr1110_t * lr1110 = (lr1110_t*) capture->context;
+    uint32_t cycles = 0;
+
+    lr1110_lock(lr1110, K_FOREVER);
+
+    /* Nothing is taken if capture was stopped meanwhile */
+    lr1110_system_irq_mask_t irq = lr1110_irq_take(lr1110,
+                                                   LR1110_IRQ_SOURCE_RADIO,
+                                                   &capture->work,
+                                                   &cycles);
+
+    if (irq & LR1110_SYSTEM_IRQ_HEADER_ERROR) {
+        capture->stats.header_errors++;
+    }
+    else if (irq & LR1110_SYSTEM_IRQ_CRC_ERROR) {
+        capture->stats.crc_errors++;
+    }
+    else if (irq & LR1110_SYSTEM_IRQ_RX_DONE) {
+        lr1110_rx_capture_read_packet(capture, cycles);
+    }
+
+    lr1110_unlock(lr1110);
+}
+
+
+/*!
+ * @brief               Reads received packet into ring, payload is not
+ *                      read when ring is full
+ */
+static void lr1110_rx_capture_read_packet(struct lr1110_rx_capture * capture,
+                                          uint32_t cycles)
+{
+    int err = lr1110_packet_ring_receive(capture->context, &capture->ring,
+                                         cycles, NULL);
+
+    if (err == -ENOBUFS) {
+        capture->stats.dropped++;
+        return;
+    }
+    if (err) {
+        capture->stats.spi_errors++;
+        return;
+    }
+
+    capture->stats.packets++;
+    capture->stats.service_cycles_last = k_cycle_get_32() - cycles;
+    capture->stats.service_cycles_max = MAX(capture->stats.service_cycles_max,
+                                            capture->stats.service_cycles_last);
+}
+
+
+
+/*!
+ * @brief                       Wakes radio up if power manager put it 
+ *                              into idle state, called by HAL under the 
+ *                              lock
+ *
+ * @param[in] context           Radio abstraction
+ */
+static void lr1110_power_wake(const void * context)
+{
+    lr1110_t * lr1110 = (lr1110_t*) context;
+
+    if (lr1110->power.state == LR1110_POWER_SLEEP) {
+        lr1110_hal_wakeup(context);
+    }
+    else if (lr1110->power.state == LR1110_POWER_STANDBY) {
+        lr1110_power_set_state(lr1110, LR1110_POWER_ACTIVE);
+    }
+}
+
+
+/*!
+ * @brief                       Tracks state after each HAL call. SetSleep
+ *                              puts radio to sleep, any other command 
+ *                              restarts idle timeout.
+ *
+ * @param[in] context           Radio abstraction
+ * @param[in] command           Command that was sent
+ * @param[in] command_length    Command length
+ * @param[in] status            HAL status of the call
+ */
+static void lr1110_power_touch(const void * context,
+                               const uint8_t * command,
+                               uint16_t command_length,
+                               lr1110_hal_status_t status)
+{
+    lr1110_t * lr1110 = (lr1110_t*) context;
+    uint16_t opcode = (command_length >= 2) ? 
+                      ((command[0] << 8) | command[1]) : 0;
+
+    if (status == LR1110_HAL_STATUS_OK && 
+        opcode == LR1110_SET_SLEEP_OPCODE) {
+        lr1110->power.stats.sleeps++;
+        lr1110_power_set_state(lr1110, LR1110_POWER_SLEEP);
+        k_work_cancel_delayable(&lr1110->power.idle_work);
+    }
+    else if (lr1110->power.idle_timeout_ms) {
+        k_work_reschedule(&lr1110->power.idle_work, 
+                          K_MSEC(lr1110->power.idle_timeout_ms));
+    }
+}
+
+
+/*!
+ * @brief                       Adds time spent in current state to its 
+ *                              counter and switches to new state
+ */
+static void lr1110_power_set_state(lr1110_t * lr1110, 
+                                   enum lr1110_power_state state)
+{
+    int64_t now = k_uptime_get();
+
+    lr1110->power.stats.time_ms[lr1110->power.state] += 
+        now - lr1110->power.state_since;
+    lr1110->power.state_since = now;
+    lr1110->power.state = state;
+}
+
+
+/*!
+ * @brief                       Idle timeout handler, runs in system work 
+ *                              queue. Radio is put into idle state only if
+ *                              it is in standby with no pending event, so 
+ *                              running scans and RX are never interrupted.
+ */
+static void lr1110_power_idle_handler(struct k_work * work)
+{
+    struct k_work_delayable * dwork = k_work_delayable_from_work(work);
+    lr1110_t * lr1110 = CONTAINER_OF(dwork, lr1110_t, power.idle_work);
+    const void * context = lr1110;
+
+    /* Lock holder is using the radio, idle time starts over */
+    if (k_mutex_lock(&lr1110->lock, K_NO_WAIT)) {
+        if (lr1110->power.idle_timeout_ms) {
+            k_work_reschedule(&lr1110->power.idle_work, 
+                              K_MSEC(lr1110->power.idle_timeout_ms));
+        }
+        return;
+    }
+
+    /* BUSY is held during scans, pending event means results wait to be
+     * read. Next HAL call of their handlers restarts idle timeout. */
+    if (lr1110->power.state != LR1110_POWER_ACTIVE || 
+        !lr1110->power.idle_timeout_ms ||
+        lr1110_busy_is_set(context) ||
+        gpio_pin_get(lr1110->event.port, lr1110->event.pin) == 1) {
+        k_mutex_unlock(&lr1110->lock);
+        return;
+    }
+
+    const uint8_t command[LR1110_GET_STATUS_LENGTH] = {
+        LR1110_GET_STATUS_OPCODE >> 8, LR1110_GET_STATUS_OPCODE & 0xFF,
     };
+    uint8_t status[LR1110_GET_STATUS_LENGTH];
+
+    if (lr1110_hal_write_read(context, command, status, sizeof(status)) == 
+            LR1110_HAL_STATUS_OK) {
+        uint8_t chip_mode = (status[1] >> 1) & 0x07;
+        bool standby = chip_mode == LR1110_CHIP_MODE_STBY_RC || 
+                       chip_mode == LR1110_CHIP_MODE_STBY_XOSC;
+
+        /* Other modes are RX or TX, their handlers restart timeout */
+        if (standby && lr1110->power.idle_state == LR1110_POWER_SLEEP) {
+            const lr1110_system_sleep_cfg_t sleep_cfg = {
+                .is_warm_start = true,
+                .is_rtc_timeout = false,
+            };
+
+            lr1110_system_set_sleep(context, sleep_cfg, 0);
+        }
+        else if (standby) {
+            /* XOSC is kept running in its standby, RC one saves more */
+            if (chip_mode == LR1110_CHIP_MODE_STBY_RC ||
+                !lr1110_system_set_standby(context, 
+                                           LR1110_SYSTEM_STANDBY_CFG_RC)) {
+                lr1110_power_set_state(lr1110, LR1110_POWER_STANDBY);
+            }
+        }
+    }
 
-    spi_transceive(spi_dev, &spi_cfg, &tx, &rx);
+    /* Own commands above restarted idle timeout */
+    k_work_cancel_delayable(&lr1110->power.idle_work);
+    k_mutex_unlock(&lr1110->lock);
 }
 
 /*** end of file ***/
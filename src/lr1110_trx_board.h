@@ -15,12 +15,155 @@
 extern "C" {
 #endif
 
+#include <stdint.h>
+#include <zephyr.h>
 #include "lr1110_types.h"
+#include "lr1110_driver/lr1110_hal.h"
+#include "lr1110_driver/lr1110_system_types.h"
+#include "lr1110_packet_ring.h"
+
+/* Packets kept by continuous RX capture until read */
+#ifndef LR1110_RX_CAPTURE_RING_SIZE
+#define LR1110_RX_CAPTURE_RING_SIZE     16
+#endif
+
+/*!
+ * @brief Time spent by the host inside HAL, collected per radio context
+ */
+struct lr1110_hal_stats {
+    uint32_t busy_waits;        /* Number of BUSY waits */
+    uint32_t busy_blocked;      /* Waits that did not finish while spinning */
+    uint32_t busy_timeouts;     /* Waits that ended in timeout */
+    uint32_t busy_wait_last_us; /* Duration of the most recent wait */
+    uint32_t busy_wait_max_us;  /* Longest wait */
+    uint64_t busy_wait_total_us;/* Sum of all waits */
+    uint32_t hal_calls;         /* Calls to lr1110_hal_write/read/write_read */
+    uint32_t spi_transactions;  /* NSS framed SPI transactions */
+    uint32_t spi_bytes;         /* Bytes clocked over SPI */
+};
+
+/*!
+ * @brief Radio traffic of a sequence of commands, for example reading of
+ *        scan outcome, see lr1110_hal_traffic_begin
+ */
+struct lr1110_hal_traffic {
+    uint32_t duration_us;
+    uint32_t hal_calls;
+    uint32_t spi_bytes;
+    uint32_t busy_us;           /* Time spent waiting for BUSY */
+};
+
+/*!
+ * @brief HAL statistics snapshot taken by lr1110_hal_traffic_begin
+ */
+struct lr1110_hal_snapshot {
+    struct lr1110_hal_stats stats;
+    uint32_t start;             /* In hardware cycles */
+};
+
+/*!
+ * @brief Radio power state, as tracked by HAL
+ */
+enum lr1110_power_state {
+    LR1110_POWER_ACTIVE = 0,    /* Awake, possibly running an operation */
+    LR1110_POWER_STANDBY,       /* Put into standby after idle time */
+    LR1110_POWER_SLEEP,         /* Sleeping with retention */
+    LR1110_POWER_STATE_COUNT,
+};
+
+struct lr1110_power_stats {
+    uint64_t time_ms[LR1110_POWER_STATE_COUNT];
+    uint32_t sleeps;
+    uint32_t wakeups;
+    uint32_t wakeup_us_last;    /* NSS low until BUSY released */
+    uint32_t wakeup_us_max;
+};
+
+/*!
+ * @brief Power manager state, part of radio context
+ */
+struct lr1110_power {
+    struct k_work_delayable idle_work;
+    uint32_t idle_timeout_ms;   /* 0 disables automatic idle */
+    uint8_t idle_state;         /* Standby or sleep */
+    uint8_t state;
+    int64_t state_since;
+    bool initialized;
+    struct lr1110_power_stats stats;
+};
+
+/*!
+ * @brief Outcome of SPI clock auto tuning
+ */
+struct lr1110_spi_tune_result {
+    uint32_t frequency;         /* Selected SPI clock in Hz */
+    uint32_t failed_frequency;  /* Lowest clock that failed, 0 if none did */
+    uint32_t steps;             /* Number of clocks tried */
+    uint32_t errors;            /* Failed verifications, over all steps */
+};
+
+/*!
+ * @brief Continuous RX capture counters
+ */
+struct lr1110_rx_capture_stats {
+    uint32_t packets;           /* Put into ring */
+    uint32_t dropped;           /* Ring was full, consumer fell behind */
+    uint32_t crc_errors;
+    uint32_t header_errors;
+    uint32_t spi_errors;        /* Packet could not be read */
+    uint32_t service_cycles_last;   /* Event interrupt to packet in ring */
+    uint32_t service_cycles_max;
+};
+
+/*!
+ * @brief Continuous RX capture state, owned by caller. Has to be zero
+ *        initialized before first use.
+ */
+struct lr1110_rx_capture {
+    void * context;
+    struct k_work work;
+    struct lr1110_lora_packet packets[LR1110_RX_CAPTURE_RING_SIZE];
+    struct lr1110_packet_ring ring;
+    struct lr1110_rx_capture_stats stats;
+};
 
 void lr1110_gpio_init(const void * context);
 void lr1110_spi_init(const void * context);
 lr1110_status_t lr1110_rf_switch_init(const void * context);
 
+uint32_t lr1110_spi_get_frequency(const void * context);
+int lr1110_spi_autotune(const void * context, 
+                        struct lr1110_spi_tune_result * result);
+
+void lr1110_hal_get_stats(const void * context, struct lr1110_hal_stats * stats);
+void lr1110_hal_reset_stats(const void * context);
+void lr1110_hal_traffic_begin(const void * context,
+                              struct lr1110_hal_snapshot * snapshot);
+void lr1110_hal_traffic_end(const void * context,
+                            const struct lr1110_hal_snapshot * snapshot,
+                            struct lr1110_hal_traffic * traffic);
+
+void lr1110_power_init(const void * context);
+void lr1110_power_set_idle(const void * context,
+                           uint32_t timeout_ms,
+                           enum lr1110_power_state idle_state);
+enum lr1110_power_state lr1110_power_get_state(const void * context);
+void lr1110_power_get_stats(const void * context,
+                            struct lr1110_power_stats * stats);
+
+lr1110_hal_status_t
+lr1110_hal_clear_irq_status(const void * context,
+                            lr1110_system_irq_mask_t irq_mask,
+                            lr1110_system_irq_mask_t * irq_status);
+
+int lr1110_rx_capture_start(void * context, struct lr1110_rx_capture * capture);
+int lr1110_rx_capture_stop(struct lr1110_rx_capture * capture);
+int lr1110_rx_capture_read(struct lr1110_rx_capture * capture,
+                           struct lr1110_lora_packet * packet,
+                           k_timeout_t timeout);
+void lr1110_rx_capture_get_stats(struct lr1110_rx_capture * capture,
+                                 struct lr1110_rx_capture_stats * stats);
+
 #ifdef __cplusplus
 }
 #endif
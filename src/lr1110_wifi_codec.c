@@ -0,0 +1,309 @@
+/** @file lr1110_wifi_codec.c
+ *
+ * @brief       Compact bit-packed encoding of wifi scan results, sized for
+ *              LoRaWAN uplinks. Format is described in lr1110_wifi_codec.h.
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 Irnas.  All rights reserved.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include "lr1110_wifi_codec.h"
+
+/* -------------------------------------------------------------------------
+ * PRIVATE VARIABLES
+ * ------------------------------------------------------------------------- */
+
+/* Fields of info bytes, as described in LR1110 user manual */
+#define WIFI_CHANNEL_INFO_CHANNEL_MASK      0x0F
+#define WIFI_DATA_RATE_INFO_TYPE_MASK       0x03
+
+#define WIFI_CODEC_RSSI_BITS                7
+#define WIFI_CODEC_CHANNEL_BITS             4
+#define WIFI_CODEC_TYPE_BITS                2
+#define WIFI_CODEC_COUNT_MASK               0x3F
+
+/* -------------------------------------------------------------------------
+ * PRIVATE PROTOTYPES
+ * ------------------------------------------------------------------------- */
+static uint8_t select_strongest(const struct lr1110_wifi_ap * aps,
+                                uint8_t nb_aps,
+                                uint8_t max_aps,
+                                uint8_t * order);
+static void put_bits(uint8_t * buf, uint32_t * bit_pos,
+                     uint32_t value, uint8_t nb_bits);
+static uint32_t get_bits(const uint8_t * buf, uint32_t * bit_pos,
+                         uint8_t nb_bits);
+
+/* -------------------------------------------------------------------------
+ * PUBLIC IMPLEMENTATIONS
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * @brief               Extracts fields that are encoded from basic result
+ *
+ * @param[in] result    Basic complete result
+ * @param[out] ap       Access point
+ */
+void lr1110_wifi_ap_from_basic(const lr1110_wifi_basic_complete_result_t * result,
+                               struct lr1110_wifi_ap * ap)
+{
+    memcpy(ap->mac, result->mac_address, LR1110_WIFI_MAC_ADDRESS_LENGTH);
+    ap->rssi = result->rssi;
+    ap->channel = result->channel_info_byte & WIFI_CHANNEL_INFO_CHANNEL_MASK;
+    ap->signal_type = result->data_rate_info_byte &
+                      WIFI_DATA_RATE_INFO_TYPE_MASK;
+}
+
+
+/*!
+ * @brief               Extracts fields that are encoded from extended
+ *                      result. BSSID (address 3) is used as MAC address.
+ *
+ * @param[in] result    Extended full result
+ * @param[out] ap       Access point
+ */
+void lr1110_wifi_ap_from_ext(const lr1110_wifi_extended_full_result_t * result,
+                             struct lr1110_wifi_ap * ap)
+{
+    memcpy(ap->mac, result->mac_address_3, LR1110_WIFI_MAC_ADDRESS_LENGTH);
+    ap->rssi = result->rssi;
+    ap->channel = result->channel_info_byte & WIFI_CHANNEL_INFO_CHANNEL_MASK;
+    ap->signal_type = result->data_rate_info_byte &
+                      WIFI_DATA_RATE_INFO_TYPE_MASK;
+}
+
+
+/*!
+ * @brief               Encodes strongest access points
+ *
+ * @param[in] aps       Access points
+ * @param[in] nb_aps    Number of access points
+ * @param[in] max_aps   Encode at most this many strongest APs, 0 for all
+ * @param[in] truncate  If buffer is too small for selected APs, encode as
+ *                      many strongest ones as fit instead of failing
+ * @param[out] buf      Output buffer
+ * @param[in] buf_size  Size of output buffer
+ *
+ * @return              Encoded length in bytes, -ENOMEM if buffer is too
+ *                      small and truncate is not set.
+ */
+int lr1110_wifi_encode(const struct lr1110_wifi_ap * aps,
+                       uint8_t nb_aps,
+                       uint8_t max_aps,
+                       bool truncate,
+                       uint8_t * buf,
+                       size_t buf_size)
+{
+    uint8_t order[LR1110_WIFI_CODEC_MAX_APS];
+    uint32_t bit_pos = 0;
+
+    if (max_aps == 0 || max_aps > LR1110_WIFI_CODEC_MAX_APS) {
+        max_aps = LR1110_WIFI_CODEC_MAX_APS;
+    }
+
+    uint8_t count = select_strongest(aps, nb_aps, max_aps, order);
+
+    if (LR1110_WIFI_CODEC_SIZE(count) > buf_size) {
+        if (!truncate || buf_size < LR1110_WIFI_CODEC_SIZE(0)) {
+            return -ENOMEM;
+        }
+        /* APs are ordered by RSSI, weakest ones are dropped */
+        while (LR1110_WIFI_CODEC_SIZE(count) > buf_size) {
+            count--;
+        }
+    }
+
+    memset(buf, 0, LR1110_WIFI_CODEC_SIZE(count));
+
+    put_bits(buf, &bit_pos, LR1110_WIFI_CODEC_VERSION, 2);
+    put_bits(buf, &bit_pos, count, 6);
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+        const struct lr1110_wifi_ap * ap = &aps[order[i]];
+        int rssi = -ap->rssi;
+
+        for (int j = 0; j < LR1110_WIFI_MAC_ADDRESS_LENGTH; j++) {
+            put_bits(buf, &bit_pos, ap->mac[j], 8);
+        }
+
+        rssi = rssi < 0 ? 0 : (rssi > 127 ? 127 : rssi);
+        put_bits(buf, &bit_pos, rssi, WIFI_CODEC_RSSI_BITS);
+        put_bits(buf, &bit_pos, ap->channel, WIFI_CODEC_CHANNEL_BITS);
+        put_bits(buf, &bit_pos, ap->signal_type, WIFI_CODEC_TYPE_BITS);
+    }
+
+    return LR1110_WIFI_CODEC_SIZE(count);
+}
+
+
+/*!
+ * @brief               Same as lr1110_wifi_encode, for basic results
+ */
+int lr1110_wifi_encode_basic(const lr1110_wifi_basic_complete_result_t * results,
+                             uint8_t nb_results,
+                             uint8_t max_aps,
+                             bool truncate,
+                             uint8_t * buf,
+                             size_t buf_size)
+{
+    struct lr1110_wifi_ap aps[LR1110_WIFI_MAX_RESULTS];
+
+    nb_results = nb_results > LR1110_WIFI_MAX_RESULTS ?
+                 LR1110_WIFI_MAX_RESULTS : nb_results;
+
+    for (uint8_t i = 0; i < nb_results; i++) {
+        lr1110_wifi_ap_from_basic(&results[i], &aps[i]);
+    }
+    return lr1110_wifi_encode(aps, nb_results, max_aps, truncate,
+                              buf, buf_size);
+}
+
+
+/*!
+ * @brief               Same as lr1110_wifi_encode, for extended results
+ */
+int lr1110_wifi_encode_ext(const lr1110_wifi_extended_full_result_t * results,
+                           uint8_t nb_results,
+                           uint8_t max_aps,
+                           bool truncate,
+                           uint8_t * buf,
+                           size_t buf_size)
+{
+    struct lr1110_wifi_ap aps[LR1110_WIFI_MAX_RESULTS];
+
+    nb_results = nb_results > LR1110_WIFI_MAX_RESULTS ?
+                 LR1110_WIFI_MAX_RESULTS : nb_results;
+
+    for (uint8_t i = 0; i < nb_results; i++) {
+        lr1110_wifi_ap_from_ext(&results[i], &aps[i]);
+    }
+    return lr1110_wifi_encode(aps, nb_results, max_aps, truncate,
+                              buf, buf_size);
+}
+
+
+/*!
+ * @brief               Decodes message created by lr1110_wifi_encode
+ *
+ * @param[in] buf       Encoded message
+ * @param[in] buf_size  Length of encoded message
+ * @param[out] aps      Decoded access points, strongest first
+ * @param[in] max_aps   Size of aps array
+ *
+ * @return              Number of decoded APs, -EINVAL if message is
+ *                      malformed, -ENOMEM if aps array is too small.
+ */
+int lr1110_wifi_decode(const uint8_t * buf,
+                       size_t buf_size,
+                       struct lr1110_wifi_ap * aps,
+                       uint8_t max_aps)
+{
+    uint32_t bit_pos = 0;
+
+    if (buf_size < LR1110_WIFI_CODEC_SIZE(0)) {
+        return -EINVAL;
+    }
+
+    uint8_t version = get_bits(buf, &bit_pos, 2);
+    uint8_t count = get_bits(buf, &bit_pos, 6);
+
+    if (version != LR1110_WIFI_CODEC_VERSION ||
+        buf_size < LR1110_WIFI_CODEC_SIZE(count)) {
+        return -EINVAL;
+    }
+    if (count > max_aps) {
+        return -ENOMEM;
+    }
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+        for (int j = 0; j < LR1110_WIFI_MAC_ADDRESS_LENGTH; j++) {
+            aps[i].mac[j] = get_bits(buf, &bit_pos, 8);
+        }
+        aps[i].rssi = -(int8_t) get_bits(buf, &bit_pos, WIFI_CODEC_RSSI_BITS);
+        aps[i].channel = get_bits(buf, &bit_pos, WIFI_CODEC_CHANNEL_BITS);
+        aps[i].signal_type = get_bits(buf, &bit_pos, WIFI_CODEC_TYPE_BITS);
+    }
+    return count;
+}
+
+/* -------------------------------------------------------------------------
+ * PRIVATE IMPLEMENTATIONS
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * @brief               Orders APs by RSSI, strongest first
+ *
+ * @param[in] aps       Access points
+ * @param[in] nb_aps    Number of access points
+ * @param[in] max_aps   Maximal number of selected APs
+ * @param[out] order    Indexes of selected APs
+ *
+ * @return              Number of selected APs
+ */
+static uint8_t select_strongest(const struct lr1110_wifi_ap * aps,
+                                uint8_t nb_aps,
+                                uint8_t max_aps,
+                                uint8_t * order)
+{
+    uint64_t picked = 0;
+    uint8_t count = nb_aps < max_aps ? nb_aps : max_aps;
+
+    nb_aps = nb_aps > 64 ? 64 : nb_aps;
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+        int best = -1;
+
+        for (uint8_t j = 0; j < nb_aps; j++)
+        {
+            if (!(picked & (1ULL << j)) &&
+                (best < 0 || aps[j].rssi > aps[best].rssi)) {
+                best = j;
+            }
+        }
+        picked |= 1ULL << best;
+        order[i] = best;
+    }
+    return count;
+}
+
+
+/*!
+ * @brief               Writes value into bit stream, MSB first. Buffer has
+ *                      to be zeroed.
+ */
+static void put_bits(uint8_t * buf, uint32_t * bit_pos,
+                     uint32_t value, uint8_t nb_bits)
+{
+    while (nb_bits--)
+    {
+        if (value & (1UL << nb_bits)) {
+            buf[*bit_pos / 8] |= 0x80 >> (*bit_pos % 8);
+        }
+        (*bit_pos)++;
+    }
+}
+
+
+/*!
+ * @brief               Reads value from bit stream, MSB first
+ */
+static uint32_t get_bits(const uint8_t * buf, uint32_t * bit_pos,
+                         uint8_t nb_bits)
+{
+    uint32_t value = 0;
+
+    while (nb_bits--)
+    {
+        value = (value << 1) |
+                ((buf[*bit_pos / 8] >> (7 - (*bit_pos % 8))) & 0x01);
+        (*bit_pos)++;
+    }
+    return value;
+}
+
+/*** end of file ***/
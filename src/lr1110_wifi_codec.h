@@ -0,0 +1,88 @@
+/** @file lr1110_wifi_codec.h
+ *
+ * @brief       Compact bit-packed encoding of wifi scan results, sized for
+ *              LoRaWAN uplinks. Encoder and decoder have no Zephyr
+ *              dependencies, so this module can also be built on host to
+ *              decode received uplinks.
+ *
+ *              Encoded message:
+ *
+ *              byte 0      bits 7..6 format version, bits 5..0 number of APs
+ *              AP records, 61 bits each, packed MSB first, no padding
+ *              between records, last byte padded with zeros:
+ *                  48 bits MAC address
+ *                   7 bits RSSI, stored as -RSSI in dBm, clamped to 0..127
+ *                   4 bits channel, 0 if unknown
+ *                   2 bits signal type (1 - B, 2 - G, 3 - N), 0 if unknown
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 Irnas.  All rights reserved.
+ */
+
+#ifndef LR1110_WIFI_CODEC_H
+#define LR1110_WIFI_CODEC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "lr1110_driver/lr1110_wifi_types.h"
+
+#define LR1110_WIFI_CODEC_VERSION       0
+#define LR1110_WIFI_CODEC_AP_BITS       61
+#define LR1110_WIFI_CODEC_MAX_APS       63
+
+/*!
+ * @brief Size in bytes of encoded message with n APs
+ */
+#define LR1110_WIFI_CODEC_SIZE(n) \
+    ((size_t) (1 + (((n) * LR1110_WIFI_CODEC_AP_BITS) + 7) / 8))
+
+/*!
+ * @brief Access point, as stored in encoded message
+ */
+struct lr1110_wifi_ap {
+    uint8_t mac[LR1110_WIFI_MAC_ADDRESS_LENGTH];
+    int8_t rssi;
+    uint8_t channel;
+    uint8_t signal_type;
+};
+
+void lr1110_wifi_ap_from_basic(const lr1110_wifi_basic_complete_result_t * result,
+                               struct lr1110_wifi_ap * ap);
+void lr1110_wifi_ap_from_ext(const lr1110_wifi_extended_full_result_t * result,
+                             struct lr1110_wifi_ap * ap);
+
+int lr1110_wifi_encode(const struct lr1110_wifi_ap * aps,
+                       uint8_t nb_aps,
+                       uint8_t max_aps,
+                       bool truncate,
+                       uint8_t * buf,
+                       size_t buf_size);
+int lr1110_wifi_encode_basic(const lr1110_wifi_basic_complete_result_t * results,
+                             uint8_t nb_results,
+                             uint8_t max_aps,
+                             bool truncate,
+                             uint8_t * buf,
+                             size_t buf_size);
+int lr1110_wifi_encode_ext(const lr1110_wifi_extended_full_result_t * results,
+                           uint8_t nb_results,
+                           uint8_t max_aps,
+                           bool truncate,
+                           uint8_t * buf,
+                           size_t buf_size);
+
+int lr1110_wifi_decode(const uint8_t * buf,
+                       size_t buf_size,
+                       struct lr1110_wifi_ap * aps,
+                       uint8_t max_aps);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LR1110_WIFI_CODEC_H */
+/*** end of file ***/
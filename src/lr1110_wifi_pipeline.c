@@ -0,0 +1,362 @@
+/** @file lr1110_wifi_pipeline.c
+ *
+ * @brief       Back to back wifi scans with two result slots.
+ *
+ *              Built on asynchronous scan, so runner itself runs in radio
+ *              work queue: scan done callback reads results into scanning
+ *              slot, starts next scan and hands the slot over.
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 Irnas.  All rights reserved.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include "lr1110.h"
+#include "lr1110_wifi_pipeline.h"
+
+/* -------------------------------------------------------------------------
+ * PRIVATE PROTOTYPES
+ * ------------------------------------------------------------------------- */
+static int pipeline_scan(struct lr1110_wifi_pipeline * pipeline);
+static void pipeline_next(struct lr1110_wifi_pipeline * pipeline);
+static void pipeline_scan_cb(void * context,
+                             int status,
+                             struct wifi_diagnostics wifi_diagnostics,
+                             void * user_data);
+static void pipeline_account(struct lr1110_wifi_pipeline * pipeline);
+
+/* -------------------------------------------------------------------------
+ * PUBLIC IMPLEMENTATIONS
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * @brief                   Starts first scan of the pipeline
+ *
+ * @param[in] context       Radio abstraction
+ * @param[in] pipeline      Pipeline state
+ * @param[in] wifi_settings Settings of all scans, max_results is limited to
+ *                          LR1110_WIFI_PIPELINE_MAX_RESULTS
+ * @param[in] cb            Called for each ready slot, can be NULL
+ * @param[in] user_data     Passed to callback
+ *
+ * @return                  0 on success, -EALREADY if pipeline is running,
+ *                          -EBUSY if scan done callback of stopped pipeline
+ *                          is still in progress, scan start error otherwise.
+ */
+int lr1110_wifi_pipeline_start(void * context,
+                               struct lr1110_wifi_pipeline * pipeline,
+                               struct wifi_settings wifi_settings,
+                               lr1110_wifi_pipeline_cb_t cb,
+                               void * user_data)
+{
+    int err;
+
+    /* Lock and semaphore could still be used by previous run. Async scan
+     * state is kept too, its works may still be queued. */
+    if (!pipeline->initialized) {
+        k_mutex_init(&pipeline->lock);
+        k_sem_init(&pipeline->ready_sem, 0, LR1110_WIFI_PIPELINE_SLOTS);
+        pipeline->initialized = true;
+    }
+
+    k_mutex_lock(&pipeline->lock, K_FOREVER);
+
+    if (pipeline->running) {
+        k_mutex_unlock(&pipeline->lock);
+        return -EALREADY;
+    }
+    /* Callback of previous run could still hold a slot */
+    if (pipeline->callbacks) {
+        k_mutex_unlock(&pipeline->lock);
+        return -EBUSY;
+    }
+
+    k_sem_reset(&pipeline->ready_sem);
+    memset(pipeline->slots, 0, sizeof(pipeline->slots));
+    memset(&pipeline->stats, 0, sizeof(pipeline->stats));
+
+    wifi_settings.max_results = MIN(wifi_settings.max_results,
+                                    LR1110_WIFI_PIPELINE_MAX_RESULTS);
+
+    pipeline->context = context;
+    pipeline->wifi_settings = wifi_settings;
+    pipeline->cb = cb;
+    pipeline->user_data = user_data;
+    pipeline->scanning = NULL;
+    pipeline->stalled = false;
+    pipeline->account_time = k_uptime_get();
+
+    pipeline->running = true;
+    err = pipeline_scan(pipeline);
+    if (err) {
+        pipeline->running = false;
+    }
+    k_mutex_unlock(&pipeline->lock);
+    return err;
+}
+
+
+/*!
+ * @brief                   Stops pipeline, running scan is cancelled. Ready
+ *                          slots can still be taken. Scan done callback
+ *                          that is already in progress is not waited for,
+ *                          so this can be called from pipeline callback;
+ *                          lr1110_wifi_pipeline_start fails with -EBUSY
+ *                          until it is done.
+ *
+ * @param[in] pipeline      Pipeline state
+ */
+void lr1110_wifi_pipeline_stop(struct lr1110_wifi_pipeline * pipeline)
+{
+    k_mutex_lock(&pipeline->lock, K_FOREVER);
+    pipeline->running = false;
+    k_mutex_unlock(&pipeline->lock);
+
+    lr1110_cancel_wifi_scan(&pipeline->async);
+}
+
+
+/*!
+ * @brief                   Takes oldest ready slot
+ *
+ * @param[in] pipeline      Pipeline state
+ * @param[in] timeout       How long to wait for a slot
+ *
+ * @return                  Slot owned by caller until it is released, NULL
+ *                          on timeout or when pipeline was stopped by scan
+ *                          start error
+ */
+struct lr1110_wifi_slot *
+lr1110_wifi_pipeline_take(struct lr1110_wifi_pipeline * pipeline,
+                          k_timeout_t timeout)
+{
+    struct lr1110_wifi_slot * slot = NULL;
+
+    if (k_sem_take(&pipeline->ready_sem, timeout)) {
+        return NULL;
+    }
+
+    k_mutex_lock(&pipeline->lock, K_FOREVER);
+    for (uint8_t i = 0; i < LR1110_WIFI_PIPELINE_SLOTS; i++)
+    {
+        struct lr1110_wifi_slot * candidate = &pipeline->slots[i];
+
+        if (candidate->state == LR1110_WIFI_SLOT_READY &&
+            (!slot || (int32_t) (candidate->seq - slot->seq) < 0)) {
+            slot = candidate;
+        }
+    }
+    if (slot) {
+        pipeline_account(pipeline);
+        slot->state = LR1110_WIFI_SLOT_OWNED;
+    }
+    k_mutex_unlock(&pipeline->lock);
+    return slot;
+}
+
+
+/*!
+ * @brief                   Returns slot to the pipeline. If a scan was
+ *                          waiting for a free slot, it is started.
+ *
+ * @param[in] pipeline      Pipeline state
+ * @param[in] slot          Slot taken by application
+ */
+void lr1110_wifi_pipeline_release(struct lr1110_wifi_pipeline * pipeline,
+                                  struct lr1110_wifi_slot * slot)
+{
+    k_mutex_lock(&pipeline->lock, K_FOREVER);
+    pipeline_account(pipeline);
+    slot->state = LR1110_WIFI_SLOT_FREE;
+
+    if (pipeline->running && pipeline->stalled && !pipeline->scanning) {
+        pipeline_next(pipeline);
+    }
+    k_mutex_unlock(&pipeline->lock);
+}
+
+
+void lr1110_wifi_pipeline_get_stats(struct lr1110_wifi_pipeline * pipeline,
+                                    struct lr1110_wifi_pipeline_stats * stats)
+{
+    k_mutex_lock(&pipeline->lock, K_FOREVER);
+    pipeline_account(pipeline);
+    *stats = pipeline->stats;
+    k_mutex_unlock(&pipeline->lock);
+}
+
+/* -------------------------------------------------------------------------
+ * PRIVATE IMPLEMENTATIONS
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * @brief                   Starts scan into a free slot, pipeline has to be
+ *                          locked
+ *
+ * @return                  0 on success, -ENOBUFS if no slot is free (scan
+ *                          is started on next release), scan start error
+ *                          otherwise.
+ */
+static int pipeline_scan(struct lr1110_wifi_pipeline * pipeline)
+{
+    struct lr1110_wifi_slot * slot = NULL;
+
+    for (uint8_t i = 0; i < LR1110_WIFI_PIPELINE_SLOTS && !slot; i++)
+    {
+        if (pipeline->slots[i].state == LR1110_WIFI_SLOT_FREE) {
+            slot = &pipeline->slots[i];
+        }
+    }
+
+    pipeline_account(pipeline);
+
+    if (!slot) {
+        if (!pipeline->stalled) {
+            pipeline->stalled = true;
+            pipeline->stats.stalls++;
+        }
+        return -ENOBUFS;
+    }
+    pipeline->stalled = false;
+
+    slot->state = LR1110_WIFI_SLOT_SCANNING;
+    pipeline->scanning = slot;
+
+    int err = lr1110_start_wifi_scan(pipeline->context,
+                                     pipeline->wifi_settings,
+                                     &pipeline->async,
+                                     pipeline_scan_cb,
+                                     pipeline);
+    if (err) {
+        slot->state = LR1110_WIFI_SLOT_FREE;
+        pipeline->scanning = NULL;
+    }
+    return err;
+}
+
+
+/*!
+ * @brief                   Starts next scan, pipeline has to be locked. On
+ *                          scan start error pipeline is stopped and waiting
+ *                          lr1110_wifi_pipeline_take is woken up.
+ */
+static void pipeline_next(struct lr1110_wifi_pipeline * pipeline)
+{
+    int err = pipeline_scan(pipeline);
+
+    if (err && err != -ENOBUFS) {
+        pipeline->running = false;
+        pipeline->stats.start_errors++;
+        k_sem_give(&pipeline->ready_sem);
+    }
+}
+
+
+/*!
+ * @brief                   Scan done callback, reads results, starts next
+ *                          scan and hands slot over
+ */
+static void pipeline_scan_cb(void * context,
+                             int status,
+                             struct wifi_diagnostics wifi_diagnostics,
+                             void * user_data)
+{
+    struct lr1110_wifi_pipeline * pipeline = user_data;
+    bool taken = false;
+
+    k_mutex_lock(&pipeline->lock, K_FOREVER);
+    pipeline->callbacks++;
+
+    struct lr1110_wifi_slot * slot = pipeline->scanning;
+
+    if (!status) {
+        wifi_diagnostics.num_wifi_results =
+            MIN(wifi_diagnostics.num_wifi_results,
+                LR1110_WIFI_PIPELINE_MAX_RESULTS);
+        slot->ext = pipeline->wifi_settings.scan_mode ==
+                    LR1110_WIFI_SCAN_MODE_FULL_BEACON;
+
+        if (slot->ext) {
+            wifi_diagnostics = lr1110_get_ext_wifi_scan_results(
+                context, wifi_diagnostics, slot->ext_results);
+        }
+        else {
+            wifi_diagnostics = lr1110_get_wifi_scan_results(
+                context, wifi_diagnostics, slot->basic_results);
+        }
+        slot->wifi_diagnostics = wifi_diagnostics;
+    }
+
+    pipeline_account(pipeline);
+    pipeline->scanning = NULL;
+
+    if (status) {
+        slot->state = LR1110_WIFI_SLOT_FREE;
+        if (status != -ECANCELED) {
+            pipeline->stats.scan_errors++;
+        }
+    }
+    else {
+        slot->seq = pipeline->seq++;
+        pipeline->stats.scans++;
+        /* Callback gets the slot as owned, so it can release it inside */
+        slot->state = pipeline->cb ? LR1110_WIFI_SLOT_OWNED :
+                                     LR1110_WIFI_SLOT_READY;
+    }
+
+    /* Radio goes on with next scan while slot is processed */
+    if (pipeline->running) {
+        pipeline_next(pipeline);
+    }
+
+    k_mutex_unlock(&pipeline->lock);
+
+    if (!status && pipeline->cb) {
+        taken = pipeline->cb(pipeline, slot, pipeline->user_data);
+    }
+
+    k_mutex_lock(&pipeline->lock, K_FOREVER);
+    if (!status && !taken) {
+        if (slot->state == LR1110_WIFI_SLOT_OWNED) {
+            pipeline_account(pipeline);
+            slot->state = LR1110_WIFI_SLOT_READY;
+        }
+        k_sem_give(&pipeline->ready_sem);
+    }
+    pipeline->callbacks--;
+    k_mutex_unlock(&pipeline->lock);
+}
+
+
+/*!
+ * @brief                   Adds time since last state change to statistics,
+ *                          called before each change
+ */
+static void pipeline_account(struct lr1110_wifi_pipeline * pipeline)
+{
+    int64_t now = k_uptime_get();
+    uint32_t elapsed = now - pipeline->account_time;
+    bool radio = pipeline->scanning != NULL;
+    bool app = false;
+
+    for (uint8_t i = 0; i < LR1110_WIFI_PIPELINE_SLOTS; i++) {
+        app |= pipeline->slots[i].state == LR1110_WIFI_SLOT_OWNED;
+    }
+
+    if (radio) {
+        pipeline->stats.radio_ms += elapsed;
+    }
+    if (app) {
+        pipeline->stats.app_ms += elapsed;
+    }
+    if (radio && app) {
+        pipeline->stats.overlap_ms += elapsed;
+    }
+    if (pipeline->stalled) {
+        pipeline->stats.stall_ms += elapsed;
+    }
+    pipeline->account_time = now;
+}
+
+/*** end of file ***/
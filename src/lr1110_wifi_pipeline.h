@@ -0,0 +1,129 @@
+/** @file lr1110_wifi_pipeline.h
+ *
+ * @brief       Back to back wifi scans with two result slots. When a scan
+ *              ends, its results are read into one slot and next scan is
+ *              started right away, while application encodes or sends the
+ *              results from the other slot.
+ *
+ *              Slot hand-off: runner fills a free slot and marks it ready.
+ *              Application takes ready slot with lr1110_wifi_pipeline_take
+ *              (or gets it in callback), owns it until it calls
+ *              lr1110_wifi_pipeline_release. If both slots are owned or
+ *              ready when a scan ends, next scan waits for a release
+ *              (a stall).
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 Irnas.  All rights reserved.
+ */
+
+#ifndef LR1110_WIFI_PIPELINE_H
+#define LR1110_WIFI_PIPELINE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <zephyr.h>
+#include "lr1110_wifi_scan.h"
+
+#define LR1110_WIFI_PIPELINE_SLOTS          2
+
+/* Results kept per slot, sets slot size */
+#ifndef LR1110_WIFI_PIPELINE_MAX_RESULTS
+#define LR1110_WIFI_PIPELINE_MAX_RESULTS    LR1110_WIFI_MAX_RESULTS
+#endif
+
+enum lr1110_wifi_slot_state {
+    LR1110_WIFI_SLOT_FREE = 0,
+    LR1110_WIFI_SLOT_SCANNING,
+    LR1110_WIFI_SLOT_READY,
+    LR1110_WIFI_SLOT_OWNED,     /* Taken by application */
+};
+
+/*!
+ * @brief Results of one scan. Full beacon scans give extended results,
+ *        other scan modes basic ones.
+ */
+struct lr1110_wifi_slot {
+    uint32_t seq;               /* Scan number, increasing */
+    uint8_t state;
+    bool ext;
+    struct wifi_diagnostics wifi_diagnostics;
+    union {
+        lr1110_wifi_basic_complete_result_t
+            basic_results[LR1110_WIFI_PIPELINE_MAX_RESULTS];
+        lr1110_wifi_extended_full_result_t
+            ext_results[LR1110_WIFI_PIPELINE_MAX_RESULTS];
+    };
+};
+
+/*!
+ * @brief Pipeline statistics. Overlap is time when radio was scanning or
+ *        reading results while application held a slot.
+ */
+struct lr1110_wifi_pipeline_stats {
+    uint32_t scans;             /* Scans with results delivered */
+    uint32_t scan_errors;       /* Timed out scans */
+    uint32_t start_errors;      /* Scans that failed to start, each one
+                                 * stops the pipeline */
+    uint32_t stalls;            /* Scans delayed by no free slot */
+    uint32_t radio_ms;          /* Scanning and reading results */
+    uint32_t app_ms;            /* At least one slot owned */
+    uint32_t overlap_ms;
+    uint32_t stall_ms;
+};
+
+struct lr1110_wifi_pipeline;
+
+/*!
+ * @brief Called from radio work queue when slot becomes ready. Returning
+ *        true takes the slot, it has to be released later. Returning false
+ *        leaves it for lr1110_wifi_pipeline_take.
+ */
+typedef bool (*lr1110_wifi_pipeline_cb_t)(struct lr1110_wifi_pipeline * pipeline,
+                                          struct lr1110_wifi_slot * slot,
+                                          void * user_data);
+
+/*!
+ * @brief Pipeline state, owned by caller. Has to be zero initialized
+ *        before first use.
+ */
+struct lr1110_wifi_pipeline {
+    void * context;
+    struct wifi_settings wifi_settings;
+    lr1110_wifi_pipeline_cb_t cb;
+    void * user_data;
+    struct lr1110_wifi_slot slots[LR1110_WIFI_PIPELINE_SLOTS];
+    struct lr1110_wifi_scan_async async;
+    struct k_mutex lock;
+    struct k_sem ready_sem;
+    struct lr1110_wifi_slot * scanning;     /* NULL when radio is idle */
+    uint8_t callbacks;          /* Scan done callbacks in progress */
+    bool running;
+    bool stalled;
+    bool initialized;
+    uint32_t seq;
+    struct lr1110_wifi_pipeline_stats stats;
+    int64_t account_time;
+};
+
+int lr1110_wifi_pipeline_start(void * context,
+                               struct lr1110_wifi_pipeline * pipeline,
+                               struct wifi_settings wifi_settings,
+                               lr1110_wifi_pipeline_cb_t cb,
+                               void * user_data);
+void lr1110_wifi_pipeline_stop(struct lr1110_wifi_pipeline * pipeline);
+struct lr1110_wifi_slot *
+lr1110_wifi_pipeline_take(struct lr1110_wifi_pipeline * pipeline,
+                          k_timeout_t timeout);
+void lr1110_wifi_pipeline_release(struct lr1110_wifi_pipeline * pipeline,
+                                  struct lr1110_wifi_slot * slot);
+void lr1110_wifi_pipeline_get_stats(struct lr1110_wifi_pipeline * pipeline,
+                                    struct lr1110_wifi_pipeline_stats * stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LR1110_WIFI_PIPELINE_H */
+/*** end of file ***/
@@ -7,6 +7,7 @@
  * COPYRIGHT NOTICE: (c) 2021 Irnas.  All rights reserved.
  */
 
+#include <errno.h>
 #include "lr1110_wifi_scan.h"
 #include "lr1110.h"
 
@@ -14,23 +15,52 @@
  * PRIVATE VARIABLES
  * ------------------------------------------------------------------------- */
 
+/* Extra time given to the radio on top of the worst case scan duration */
+#define WIFI_SCAN_TIMEOUT_MARGIN_MS     1000
+
+/* Maximal number of results read at once by streaming readers, sets the 
+ * size of their stack buffer. Can be overridden from build system. */
+#ifndef LR1110_WIFI_STREAM_CHUNK_MAX
+#define LR1110_WIFI_STREAM_CHUNK_MAX    4
+#endif
+
+/* States of lr1110_wifi_scan_async */
+enum {
+    WIFI_ASYNC_IDLE = 0,
+    WIFI_ASYNC_RUNNING,
+    WIFI_ASYNC_FINISHING,
+};
+
 /* -------------------------------------------------------------------------
  * PRIVATE PROTOTYPES
  * ------------------------------------------------------------------------- */
+static uint32_t lr1110_wifi_scan_timeout_ms(struct wifi_settings wifi_settings);
+static lr1110_status_t lr1110_wifi_start(void * context, 
+                                         struct wifi_settings wifi_settings);
+static struct wifi_diagnostics lr1110_wifi_scan_done(void * context, 
+                                                     uint32_t start_scan);
+static void lr1110_wifi_fetch_end(void * context, 
+                                  const struct lr1110_hal_snapshot * fetch,
+                                  struct wifi_diagnostics * wifi_diagnostics);
+static void lr1110_wifi_abort(void * context);
+static void lr1110_print_wifi_diagnostics(const char * title,
+                                          struct wifi_diagnostics wifi_diagnostics);
+static void lr1110_wifi_async_done_handler(struct k_work * work);
+static void lr1110_wifi_async_timeout_handler(struct k_work * work);
+static void lr1110_wifi_async_abort(struct lr1110_wifi_scan_async * async,
+                                    int status);
 
 /* -------------------------------------------------------------------------
  * PUBLIC IMPLEMENTATIONS
  * ------------------------------------------------------------------------- */
 void lr1110_init_wifi_scan(void * context)
 {
+    lr1110_lock(context, K_FOREVER);
     lr1110_wifi_reset_cumulative_timing(context);
     lr1110_wifi_cfg_hardware_debarker(context, true);
+    lr1110_unlock(context);
 }
 
-#define DEMO_WIFI_CHANNELS_DEFAULT                                       \
-    ( ( 1 << LR1110_WIFI_CHANNEL_11 ) + ( 1 << LR1110_WIFI_CHANNEL_6 ) + \
-      ( 1 << LR1110_WIFI_CHANNEL_1 ) )
-
 struct wifi_settings lr1110_get_default_wifi_settings()
 {
     struct wifi_settings wifi_settings = {
@@ -46,153 +76,556 @@ struct wifi_settings lr1110_get_default_wifi_settings()
 }
 
 
+/*!
+ * @brief                   Runs wifi scan, calling thread sleeps until
+ *                          WIFI_SCAN_DONE event interrupt
+ *
+ * @param[in] context       Radio abstraction
+ * @param[in] wifi_settings Scan settings
+ *
+ * @return                  Diagnostics, zeroed if scan failed
+ *
+ * @note                    Radio stays locked for the whole scan, up to 
+ *                          lr1110_wifi_scan_timeout_ms. Other threads and 
+ *                          IRQ handlers in radio work queue that use the
+ *                          radio wait meanwhile, so this is meant for 
+ *                          applications with a single radio user. Others 
+ *                          should use lr1110_start_wifi_scan.
+ */
 struct wifi_diagnostics
 lr1110_execute_wifi_scan(void * context, struct wifi_settings wifi_settings)
 {
     struct wifi_diagnostics wifi_diagnostics = {0};
 
+    /* Radio is owned for the whole scan, other threads wait until 
+     * number of results is known */
+    lr1110_lock(context, K_FOREVER);
+
     /* Prepare event intterupt line */
     lr1110_prepare_event(context, LR1110_SYSTEM_IRQ_WIFI_SCAN_DONE);
 
     uint32_t start_scan = k_uptime_get();
 
     /* Start up wifi scan, function itself is not blocking,
-     * however, we wait for WIFI_SCAN_DONE event,
-     * as it currently does not make sense to implement interrupt. */
-    lr1110_wifi_scan(context,
-                     wifi_settings.signal_type,
-                     wifi_settings.channels,
-                     wifi_settings.scan_mode,
-                     wifi_settings.max_results,
-                     wifi_settings.nb_scan_per_channel,
-                     wifi_settings.timeout_in_ms,
-                     wifi_settings.abort_on_timeout);
-
+     * calling thread sleeps until WIFI_SCAN_DONE event interrupt. */
+    if (lr1110_wifi_start(context, wifi_settings)) {
+        printk("Starting wifi scan failed\n");
+        lr1110_wifi_abort(context);
+    }
     /* Blocking wait */
-    lr1110_wait_for_event(context);
-    uint32_t end_scan = k_uptime_get();
+    else if (lr1110_wait_for_event(context, 
+                                   lr1110_wifi_scan_timeout_ms(wifi_settings))) {
+        printk("Wifi scan timeout\n");
+        lr1110_wifi_abort(context);
+    }
+    else {
+        /* Clear event interrupt line */
+        lr1110_clear_event(context, LR1110_SYSTEM_IRQ_WIFI_SCAN_DONE);
+        wifi_diagnostics = lr1110_wifi_scan_done(context, start_scan);
+    }
 
-    wifi_diagnostics.wifi_scan_duration = end_scan - start_scan;
+    lr1110_unlock(context);
+    return wifi_diagnostics;
+}
 
-    /* Clear event interrupt line */
-    lr1110_clear_event(context, LR1110_SYSTEM_IRQ_WIFI_SCAN_DONE);
 
-    /* Get number of wifi scan results */
-    start_scan = k_uptime_get();
-    lr1110_wifi_get_nb_results(context, &wifi_diagnostics.num_wifi_results);
-    printk("Number of resutls: %d\n", wifi_diagnostics.num_wifi_results);
-    end_scan = k_uptime_get();
+/*!
+ * @brief                   Starts wifi scan and returns immediately. Scan 
+ *                          outcome is reported through callback, which is 
+ *                          called from radio work queue.
+ *
+ * @param[in] context       Radio abstraction
+ * @param[in] wifi_settings Scan settings
+ * @param[in] async         Scan state, has to stay valid until callback
+ * @param[in] cb            Called once with 0, -ETIMEDOUT or -ECANCELED
+ * @param[in] user_data     Passed to callback
+ *
+ * @return                  0 if scan was started, -EBUSY if this async 
+ *                          object is already in use, -EIO on radio error.
+ *
+ * @note                    Radio is locked only while starting the scan and 
+ *                          while collecting its outcome, as mutex can not be 
+ *                          handed over to work queue thread. Use 
+ *                          lr1110_execute_wifi_scan when other threads must 
+ *                          not talk to the radio during the scan.
+ */
+int lr1110_start_wifi_scan(void * context, 
+                           struct wifi_settings wifi_settings,
+                           struct lr1110_wifi_scan_async * async,
+                           lr1110_wifi_scan_cb_t cb,
+                           void * user_data)
+{
+    if (!atomic_cas(&async->state, WIFI_ASYNC_IDLE, WIFI_ASYNC_RUNNING)) {
+        return -EBUSY;
+    }
 
-    wifi_diagnostics.result_fetch_duration = end_scan - start_scan;
-    return wifi_diagnostics;
+    if (async->context == NULL) {
+        /* First use, works are never reinitialized as they could still be
+         * queued after previous scan. */
+        k_work_init(&async->done_work, lr1110_wifi_async_done_handler);
+        k_work_init_delayable(&async->timeout_work, 
+                              lr1110_wifi_async_timeout_handler);
+    }
+    async->context = context;
+    async->cb = cb;
+    async->user_data = user_data;
+
+    lr1110_lock(context, K_FOREVER);
+
+    async->start_scan = k_uptime_get();
+
+    if (lr1110_irq_register(context, LR1110_IRQ_SOURCE_WIFI,
+                            LR1110_SYSTEM_IRQ_WIFI_SCAN_DONE,
+                            &async->done_work) ||
+        lr1110_wifi_start(context, wifi_settings)) {
+        lr1110_irq_unregister(context, LR1110_IRQ_SOURCE_WIFI,
+                              &async->done_work);
+        lr1110_wifi_abort(context);
+        lr1110_unlock(context);
+        atomic_set(&async->state, WIFI_ASYNC_IDLE);
+        return -EIO;
+    }
+
+    lr1110_unlock(context);
+
+    k_work_schedule_for_queue(lr1110_irq_work_queue(context),
+                              &async->timeout_work,
+                              K_MSEC(lr1110_wifi_scan_timeout_ms(
+                                         wifi_settings)));
+    return 0;
 }
 
 
-void
+/*!
+ * @brief                   Cancels scan started with lr1110_start_wifi_scan.
+ *                          Callback is called with -ECANCELED before this 
+ *                          function returns.
+ *
+ * @param[in] async         Scan state
+ *
+ * @return                  0 on success, -EALREADY if scan is not running.
+ */
+int lr1110_cancel_wifi_scan(struct lr1110_wifi_scan_async * async)
+{
+    if (!atomic_cas(&async->state, WIFI_ASYNC_RUNNING, WIFI_ASYNC_FINISHING)) {
+        return -EALREADY;
+    }
+
+    k_work_cancel_delayable(&async->timeout_work);
+    k_work_cancel(&async->done_work);
+    lr1110_wifi_async_abort(async, -ECANCELED);
+    return 0;
+}
+
+
+/*!
+ * @brief                   Reads all basic results
+ *
+ * @param[in] context       Radio abstraction
+ * @param[in] wifi_diagnostics  Diagnostics of finished scan
+ * @param[out] results      Array for num_wifi_results results
+ *
+ * @return                  Diagnostics with fetch statistics updated
+ */
+struct wifi_diagnostics
 lr1110_get_wifi_scan_results(void * context,
                              struct wifi_diagnostics wifi_diagnostics,
                              lr1110_wifi_basic_complete_result_t * results)
 {
+    struct lr1110_hal_snapshot fetch;
+
+    /* Driver reads results in several chunks, keep them together */
+    lr1110_lock(context, K_FOREVER);
+    lr1110_hal_traffic_begin(context, &fetch);
     lr1110_wifi_read_basic_complete_results(context,
                                             0,  /* start result index */
                                             wifi_diagnostics.num_wifi_results,
                                             results);
+    lr1110_wifi_fetch_end(context, &fetch, &wifi_diagnostics);
+    lr1110_unlock(context);
+    return wifi_diagnostics;
 }
 
 
-void
+/*!
+ * @brief                   Same as lr1110_get_wifi_scan_results, for 
+ *                          extended results.
+ */
+struct wifi_diagnostics
 lr1110_get_ext_wifi_scan_results(void * context,
                                  struct wifi_diagnostics wifi_diagnostics,
                                  lr1110_wifi_extended_full_result_t * results)
 {
-    printk("start1\n");
+    struct lr1110_hal_snapshot fetch;
+
+    lr1110_lock(context, K_FOREVER);
+    lr1110_hal_traffic_begin(context, &fetch);
     lr1110_wifi_read_extended_full_results(context,
                                            0,
                                            wifi_diagnostics.num_wifi_results,
                                            results);
-    printk("start2\n");
+    lr1110_wifi_fetch_end(context, &fetch, &wifi_diagnostics);
+    lr1110_unlock(context);
+    return wifi_diagnostics;
+}
+
+
+/*!
+ * @brief                   Reads basic results in chunks into small stack 
+ *                          buffer and passes each chunk to callback. RAM use
+ *                          does not depend on number of results.
+ *
+ * @param[in] context       Radio abstraction
+ * @param[in] wifi_diagnostics  Diagnostics of finished scan
+ * @param[in] chunk_size    Results per chunk, 0 or values above 
+ *                          LR1110_WIFI_STREAM_CHUNK_MAX select the maximum
+ * @param[in] cb            Called for every chunk, from calling thread, 
+ *                          while radio is locked
+ * @param[in] user_data     Passed to callback
+ *
+ * @return                  Number of results passed to callback, -EIO if 
+ *                          reading failed.
+ */
+int
+lr1110_stream_wifi_scan_results(void * context,
+                                struct wifi_diagnostics wifi_diagnostics,
+                                uint8_t chunk_size,
+                                lr1110_wifi_results_cb_t cb,
+                                void * user_data)
+{
+    lr1110_wifi_basic_complete_result_t results[LR1110_WIFI_STREAM_CHUNK_MAX];
+    uint8_t index = 0;
+    int ret = 0;
+
+    if (chunk_size == 0 || chunk_size > LR1110_WIFI_STREAM_CHUNK_MAX) {
+        chunk_size = LR1110_WIFI_STREAM_CHUNK_MAX;
+    }
+
+    lr1110_lock(context, K_FOREVER);
+
+    while (index < wifi_diagnostics.num_wifi_results) {
+        uint8_t n = MIN(chunk_size, wifi_diagnostics.num_wifi_results - index);
+
+        if (lr1110_wifi_read_basic_complete_results(context, index, n, 
+                                                    results)) {
+            ret = -EIO;
+            break;
+        }
+        index += n;
+        ret = index;
+
+        if (!cb(context, results, index - n, n, user_data)) {
+            break;
+        }
+    }
+
+    lr1110_unlock(context);
+    return ret;
 }
 
 
+/*!
+ * @brief                   Same as lr1110_stream_wifi_scan_results, for 
+ *                          extended results.
+ */
+int
+lr1110_stream_ext_wifi_scan_results(void * context,
+                                    struct wifi_diagnostics wifi_diagnostics,
+                                    uint8_t chunk_size,
+                                    lr1110_wifi_ext_results_cb_t cb,
+                                    void * user_data)
+{
+    lr1110_wifi_extended_full_result_t results[LR1110_WIFI_STREAM_CHUNK_MAX];
+    uint8_t index = 0;
+    int ret = 0;
+
+    if (chunk_size == 0 || chunk_size > LR1110_WIFI_STREAM_CHUNK_MAX) {
+        chunk_size = LR1110_WIFI_STREAM_CHUNK_MAX;
+    }
+
+    lr1110_lock(context, K_FOREVER);
+
+    while (index < wifi_diagnostics.num_wifi_results) {
+        uint8_t n = MIN(chunk_size, wifi_diagnostics.num_wifi_results - index);
+
+        if (lr1110_wifi_read_extended_full_results(context, index, n, 
+                                                   results)) {
+            ret = -EIO;
+            break;
+        }
+        index += n;
+        ret = index;
+
+        if (!cb(context, results, index - n, n, user_data)) {
+            break;
+        }
+    }
+
+    lr1110_unlock(context);
+    return ret;
+}
+
+
+/*!
+ * @brief                   Prints scan diagnostics and results to console,
+ *                          one line per result. Meant for debugging, use 
+ *                          lr1110_wifi_serialize for logging or uplink.
+ */
 void
 lr1110_print_wifi_scan_results(void * contex,
                                struct wifi_diagnostics wifi_diagnostics,
                                lr1110_wifi_basic_complete_result_t * results)
 {
+    lr1110_print_wifi_diagnostics("WIFI SCAN RESULTS", wifi_diagnostics);
 
-    printk("**************************************************************\n");
-    printk("*                      WIFI SCAN RESULTS                     *\n");
-    printk("**************************************************************\n");
-    printk("Scan duration:          %d ms\n",
-            wifi_diagnostics.wifi_scan_duration);
-    printk("Fetch result duration:  %d ms\n",
-            wifi_diagnostics.result_fetch_duration);
-    printk("Number of wifi results: %d\n",
-            wifi_diagnostics.num_wifi_results);
-
-    /* Print results*/
     for (int i = 0; i < wifi_diagnostics.num_wifi_results; i++)
     {
-        printk("{\n\t\"macAddress\": \"");
-        for (int j = 0; j < LR1110_WIFI_MAC_ADDRESS_LENGTH; j++)
-        {
-            printk(" %02x:", results[i].mac_address[j]);
-        }
-        printk("\",\n\t\"signalStrength\": ");
-        printk("%d\n},\n", results[i].rssi);
+        const uint8_t * mac = results[i].mac_address;
+
+        printk("%2d: %02x:%02x:%02x:%02x:%02x:%02x, rssi: %d\n", i,
+               mac[0], mac[1], mac[2], mac[3], mac[4], mac[5],
+               results[i].rssi);
     }
 }
 
+
+/*!
+ * @brief                   Same as lr1110_print_wifi_scan_results, for 
+ *                          extended results. All three addresses are 
+ *                          printed.
+ */
 void
 lr1110_print_ext_wifi_scan_results(void * contex,
                                    struct wifi_diagnostics wifi_diagnostics,
                                    lr1110_wifi_extended_full_result_t * results)
 {
+    lr1110_print_wifi_diagnostics("EXTENDED WIFI SCAN RESULTS", 
+                                  wifi_diagnostics);
 
-    printk("**************************************************************\n");
-    printk("*                 EXTENDED WIFI SCAN RESULTS                 *\n");
-    printk("**************************************************************\n");
-    printk("Scan duration:          %d ms\n",
-            wifi_diagnostics.wifi_scan_duration);
-    printk("Fetch result duration:  %d ms\n",
-            wifi_diagnostics.result_fetch_duration);
-    printk("Number of wifi results: %d\n",
-            wifi_diagnostics.num_wifi_results);
-
-    /* Print results*/
-    for (int i = 0; i < wifi_diagnostics.num_wifi_results; i++)
-    {
-        printk("{\n\t\"macAddress\": \"");
-        for (int j = 0; j < LR1110_WIFI_MAC_ADDRESS_LENGTH; j++)
-        {
-            printk(" %02x:", results[i].mac_address_1[j]);
-        }
-        printk("\",\n\t\"signalStrength\": ");
-        printk("%d\n},\n", results[i].rssi);
-    }
     for (int i = 0; i < wifi_diagnostics.num_wifi_results; i++)
     {
-        printk("{\n\t\"macAddress\": \"");
-        for (int j = 0; j < LR1110_WIFI_MAC_ADDRESS_LENGTH; j++)
-        {
-            printk(" %02x:", results[i].mac_address_2[j]);
-        }
-        printk("\",\n\t\"signalStrength\": ");
-        printk("%d\n},\n", results[i].rssi);
-    }
-    for (int i = 0; i < wifi_diagnostics.num_wifi_results; i++)
-    {
-        printk("{\n\t\"macAddress\": \"");
-        for (int j = 0; j < LR1110_WIFI_MAC_ADDRESS_LENGTH; j++)
-        {
-            printk(" %02x:", results[i].mac_address_3[j]);
-        }
-        printk("\",\n\t\"signalStrength\": ");
-        printk("%d\n},\n", results[i].rssi);
+        const uint8_t * mac1 = results[i].mac_address_1;
+        const uint8_t * mac2 = results[i].mac_address_2;
+        const uint8_t * mac3 = results[i].mac_address_3;
+
+        printk("%2d: %02x:%02x:%02x:%02x:%02x:%02x "
+               "%02x:%02x:%02x:%02x:%02x:%02x "
+               "%02x:%02x:%02x:%02x:%02x:%02x, rssi: %d\n", i,
+               mac1[0], mac1[1], mac1[2], mac1[3], mac1[4], mac1[5],
+               mac2[0], mac2[1], mac2[2], mac2[3], mac2[4], mac2[5],
+               mac3[0], mac3[1], mac3[2], mac3[3], mac3[4], mac3[5],
+               results[i].rssi);
     }
 }
+
 /* -------------------------------------------------------------------------
  * PRIVATE IMPLEMENTATIONS
  * ------------------------------------------------------------------------- */
 
+/*!
+ * @brief                   Sends wifi scan command
+ *
+ * @param[in] context       Radio abstraction
+ * @param[in] wifi_settings Scan settings
+ *
+ * @return                  Driver status
+ */
+static lr1110_status_t lr1110_wifi_start(void * context, 
+                                         struct wifi_settings wifi_settings)
+{
+    return lr1110_wifi_scan(context,
+                            wifi_settings.signal_type,
+                            wifi_settings.channels,
+                            wifi_settings.scan_mode,
+                            wifi_settings.max_results,
+                            wifi_settings.nb_scan_per_channel,
+                            wifi_settings.timeout_in_ms,
+                            wifi_settings.abort_on_timeout);
+}
+
+
+/*!
+ * @brief                   Collects scan outcome after WIFI_SCAN_DONE event
+ *
+ * @param[in] context       Radio abstraction
+ * @param[in] start_scan    Uptime when scan was started
+ *
+ * @return                  Diagnostics with number of results
+ */
+static struct wifi_diagnostics lr1110_wifi_scan_done(void * context, 
+                                                     uint32_t start_scan)
+{
+    struct wifi_diagnostics wifi_diagnostics = {0};
+    struct lr1110_hal_snapshot fetch;
+    uint32_t end_scan = k_uptime_get();
+
+    wifi_diagnostics.wifi_scan_duration = end_scan - start_scan;
+
+    /* Timing is cumulative in radio, reset it so it covers one scan */
+    lr1110_wifi_read_cumulative_timing(context, &wifi_diagnostics.timings);
+    lr1110_wifi_reset_cumulative_timing(context);
+
+    /* Get number of wifi scan results */
+    lr1110_hal_traffic_begin(context, &fetch);
+    lr1110_wifi_get_nb_results(context, &wifi_diagnostics.num_wifi_results);
+    lr1110_wifi_fetch_end(context, &fetch, &wifi_diagnostics);
+
+    return wifi_diagnostics;
+}
+
+
+/*!
+ * @brief                   Adds HAL traffic since lr1110_hal_traffic_begin 
+ *                          to diagnostics
+ *
+ * @param[in] context       Radio abstraction, has to be locked
+ * @param[in] fetch         Snapshot taken by lr1110_hal_traffic_begin
+ * @param[in,out] wifi_diagnostics  Diagnostics that are updated
+ */
+static void lr1110_wifi_fetch_end(void * context, 
+                                  const struct lr1110_hal_snapshot * fetch,
+                                  struct wifi_diagnostics * wifi_diagnostics)
+{
+    lr1110_hal_traffic_end(context, fetch, &wifi_diagnostics->fetch);
+    wifi_diagnostics->result_fetch_duration = 
+        wifi_diagnostics->fetch.duration_us / 1000;
+}
+
+
+/*!
+ * @brief                   Aborts running scan, so radio is usable again
+ *
+ * @param[in] context       Radio abstraction
+ */
+static void lr1110_wifi_abort(void * context)
+{
+    lr1110_system_set_standby(context, LR1110_SYSTEM_STANDBY_CFG_RC);
+    lr1110_clear_event(context, LR1110_SYSTEM_IRQ_WIFI_SCAN_DONE);
+    /* Timing of aborted scan would otherwise be added to the next one */
+    lr1110_wifi_reset_cumulative_timing(context);
+}
+
+
+/*!
+ * @brief                   Work handler, submitted from event interrupt
+ */
+static void lr1110_wifi_async_done_handler(struct k_work * work)
+{
+    struct lr1110_wifi_scan_async * async = 
+        CONTAINER_OF(work, struct lr1110_wifi_scan_async, done_work);
+
+    if (!atomic_cas(&async->state, WIFI_ASYNC_RUNNING, WIFI_ASYNC_FINISHING)) {
+        return;
+    }
+    k_work_cancel_delayable(&async->timeout_work);
+
+    lr1110_lock(async->context, K_FOREVER);
+    lr1110_irq_unregister(async->context, LR1110_IRQ_SOURCE_WIFI,
+                          &async->done_work);
+    struct wifi_diagnostics wifi_diagnostics = 
+        lr1110_wifi_scan_done(async->context, async->start_scan);
+    lr1110_unlock(async->context);
+
+    /* Callback can start next scan into the same state once it is idle,
+     * so its arguments are taken before */
+    void * context = async->context;
+    lr1110_wifi_scan_cb_t cb = async->cb;
+    void * user_data = async->user_data;
+
+    atomic_set(&async->state, WIFI_ASYNC_IDLE);
+    cb(context, 0, wifi_diagnostics, user_data);
+}
+
+
+/*!
+ * @brief                   Delayed work handler, scan did not finish in time
+ */
+static void lr1110_wifi_async_timeout_handler(struct k_work * work)
+{
+    struct k_work_delayable * dwork = k_work_delayable_from_work(work);
+    struct lr1110_wifi_scan_async * async = 
+        CONTAINER_OF(dwork, struct lr1110_wifi_scan_async, timeout_work);
+
+    if (!atomic_cas(&async->state, WIFI_ASYNC_RUNNING, WIFI_ASYNC_FINISHING)) {
+        return;
+    }
+    k_work_cancel(&async->done_work);
+    lr1110_wifi_async_abort(async, -ETIMEDOUT);
+}
+
+
+/*!
+ * @brief                   Stops radio and reports unsuccessful scan
+ *
+ * @param[in] async         Scan state
+ * @param[in] status        Status passed to callback
+ */
+static void lr1110_wifi_async_abort(struct lr1110_wifi_scan_async * async,
+                                    int status)
+{
+    struct wifi_diagnostics wifi_diagnostics = {0};
+
+    lr1110_lock(async->context, K_FOREVER);
+    lr1110_irq_unregister(async->context, LR1110_IRQ_SOURCE_WIFI,
+                          &async->done_work);
+    lr1110_wifi_abort(async->context);
+    lr1110_unlock(async->context);
+
+    wifi_diagnostics.wifi_scan_duration = k_uptime_get() - async->start_scan;
+
+    /* Same as in done handler, arguments are taken before state is idle */
+    void * context = async->context;
+    lr1110_wifi_scan_cb_t cb = async->cb;
+    void * user_data = async->user_data;
+
+    atomic_set(&async->state, WIFI_ASYNC_IDLE);
+    cb(context, status, wifi_diagnostics, user_data);
+}
+
+
+/*!
+ * @brief                   Prints diagnostics header of result printers
+ */
+static void lr1110_print_wifi_diagnostics(const char * title,
+                                          struct wifi_diagnostics wifi_diagnostics)
+{
+    printk("*** %s ***\n"
+           "Scan duration:          %d ms\n"
+           "Fetch result duration:  %d ms\n"
+           "Number of wifi results: %d\n"
+           "Radio timing:           detection %d us, correlation %d us, "
+           "capture %d us, demodulation %d us\n"
+           "Fetch:                  %d us, %d HAL calls, %d SPI bytes\n",
+           title,
+           wifi_diagnostics.wifi_scan_duration,
+           wifi_diagnostics.result_fetch_duration,
+           wifi_diagnostics.num_wifi_results,
+           wifi_diagnostics.timings.rx_detection_us,
+           wifi_diagnostics.timings.rx_correlation_us,
+           wifi_diagnostics.timings.rx_capture_us,
+           wifi_diagnostics.timings.demodulation_us,
+           wifi_diagnostics.fetch.duration_us,
+           wifi_diagnostics.fetch.hal_calls,
+           wifi_diagnostics.fetch.spi_bytes);
+}
+
+
+/*!
+ * @brief                   Calculates worst case duration of a wifi scan
+ *
+ * @param[in] wifi_settings Settings that scan is started with
+ *
+ * @return                  Timeout in milliseconds
+ */
+static uint32_t lr1110_wifi_scan_timeout_ms(struct wifi_settings wifi_settings)
+{
+    uint32_t num_channels = __builtin_popcount(wifi_settings.channels & 
+                                               LR1110_WIFI_ALL_CHANNELS);
+
+    return num_channels * 
+           wifi_settings.nb_scan_per_channel * 
+           wifi_settings.timeout_in_ms + 
+           WIFI_SCAN_TIMEOUT_MARGIN_MS;
+}
+
 /*** end of file ***/
@@ -17,8 +17,16 @@ extern "C" {
 #include <zephyr.h>
 #include "lr1110_driver/lr1110_wifi.h"
 #include "lr1110_driver/lr1110_wifi_types.h"
+#include "lr1110_trx_board.h"
 
 
+/* Non-overlapping 2.4 GHz channels, where most APs are found.
+ * Channel mask bit n-1 corresponds to channel n. */
+#define DEMO_WIFI_CHANNELS_DEFAULT                                       \
+    ( ( 1 << ( LR1110_WIFI_CHANNEL_11 - 1 ) ) +                          \
+      ( 1 << ( LR1110_WIFI_CHANNEL_6 - 1 ) ) +                           \
+      ( 1 << ( LR1110_WIFI_CHANNEL_1 - 1 ) ) )
+
 struct wifi_settings
 {
     lr1110_wifi_signal_type_scan_t signal_type;
@@ -34,13 +42,65 @@ struct wifi_diagnostics {
     uint32_t wifi_scan_duration;
     uint32_t result_fetch_duration;
     uint8_t num_wifi_results;
+    /* Time radio spent in each scan phase, in us, read from the radio */
+    lr1110_wifi_cumulative_timings_t timings;
+    /* Radio traffic of reading number of results and the results */
+    struct lr1110_hal_traffic fetch;
 };
 
+/*!
+ * @brief Called from radio work queue when asynchronous scan ends.
+ *        Status is 0 on success, -ETIMEDOUT or -ECANCELED otherwise.
+ */
+typedef void (*lr1110_wifi_scan_cb_t)(void * context, 
+                                      int status,
+                                      struct wifi_diagnostics wifi_diagnostics,
+                                      void * user_data);
+
+/*!
+ * @brief State of asynchronous wifi scan, owned by caller. Has to be zero 
+ *        initialized before first use.
+ */
+struct lr1110_wifi_scan_async {
+    void * context;
+    lr1110_wifi_scan_cb_t cb;
+    void * user_data;
+    struct k_work done_work;
+    struct k_work_delayable timeout_work;
+    atomic_t state;
+    uint32_t start_scan;
+};
+
+/*!
+ * @brief Called by streaming result readers for each chunk of results. 
+ *        Results are valid only during the call. Return false to stop 
+ *        reading.
+ */
+typedef bool (*lr1110_wifi_results_cb_t)(
+    void * context,
+    const lr1110_wifi_basic_complete_result_t * results,
+    uint8_t start_index,
+    uint8_t nb_results,
+    void * user_data);
+
+typedef bool (*lr1110_wifi_ext_results_cb_t)(
+    void * context,
+    const lr1110_wifi_extended_full_result_t * results,
+    uint8_t start_index,
+    uint8_t nb_results,
+    void * user_data);
+
 void lr1110_init_wifi_scan(void * context);
 struct wifi_diagnostics
 lr1110_execute_wifi_scan(void * context, struct wifi_settings wifi_settings);
 struct wifi_settings lr1110_get_default_wifi_settings();
-void
+int lr1110_start_wifi_scan(void * context, 
+                           struct wifi_settings wifi_settings,
+                           struct lr1110_wifi_scan_async * async,
+                           lr1110_wifi_scan_cb_t cb,
+                           void * user_data);
+int lr1110_cancel_wifi_scan(struct lr1110_wifi_scan_async * async);
+struct wifi_diagnostics
 lr1110_get_wifi_scan_results(void * context,
                              struct wifi_diagnostics wifi_diagnostics,
                              lr1110_wifi_basic_complete_result_t * results);
@@ -49,10 +109,23 @@ lr1110_print_wifi_scan_results(void * contex,
                                struct wifi_diagnostics wifi_diagnostics,
                                lr1110_wifi_basic_complete_result_t * results);
 
-void
+struct wifi_diagnostics
 lr1110_get_ext_wifi_scan_results(void * context,
                                  struct wifi_diagnostics wifi_diagnostics,
                                  lr1110_wifi_extended_full_result_t * results);
+int
+lr1110_stream_wifi_scan_results(void * context,
+                                struct wifi_diagnostics wifi_diagnostics,
+                                uint8_t chunk_size,
+                                lr1110_wifi_results_cb_t cb,
+                                void * user_data);
+int
+lr1110_stream_ext_wifi_scan_results(void * context,
+                                    struct wifi_diagnostics wifi_diagnostics,
+                                    uint8_t chunk_size,
+                                    lr1110_wifi_ext_results_cb_t cb,
+                                    void * user_data);
+
 void
 lr1110_print_ext_wifi_scan_results(void * contex,
                                    struct wifi_diagnostics wifi_diagnostics,
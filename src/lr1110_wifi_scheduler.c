@@ -0,0 +1,270 @@
+/** @file lr1110_wifi_scheduler.c
+ *
+ * @brief       Adaptive selection of wifi scan parameters.
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 Irnas.  All rights reserved.
+ */
+
+#include <zephyr.h>
+#include <string.h>
+#include "lr1110_wifi_scheduler.h"
+
+/* -------------------------------------------------------------------------
+ * PRIVATE VARIABLES
+ * ------------------------------------------------------------------------- */
+
+/* Channels with at least this many APs per scan on average, in 1/16, are
+ * scanned */
+#ifndef LR1110_WIFI_SCHED_CHANNEL_THRESHOLD_Q4
+#define LR1110_WIFI_SCHED_CHANNEL_THRESHOLD_Q4  4
+#endif
+
+/* Weight of new sample in moving averages is 1/2^shift. Averages are kept
+ * in 1/256 of their unit, so they settle on the sample value instead of
+ * stopping up to 2^shift units short of it. */
+#define WIFI_SCHED_SCORE_SHIFT      2
+#define WIFI_SCHED_HIT_RATE_SHIFT   3
+#define WIFI_SCHED_Q8(x)            ((x) << 8)
+
+/* -------------------------------------------------------------------------
+ * PRIVATE PROTOTYPES
+ * ------------------------------------------------------------------------- */
+static void add_channel_hit(struct lr1110_wifi_scheduler * sched,
+                            uint8_t channel);
+static lr1110_wifi_channel_mask_t
+productive_channels(const struct lr1110_wifi_scheduler * sched);
+static int32_t ewma_update(int32_t average, int32_t sample, uint8_t shift);
+
+/* -------------------------------------------------------------------------
+ * PUBLIC IMPLEMENTATIONS
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * @brief               Default configuration: default wifi settings as
+ *                      base, at least 3 results in 80 % of scans, full band
+ *                      every 10th scan.
+ */
+struct lr1110_wifi_scheduler_cfg lr1110_wifi_scheduler_default_cfg(void)
+{
+    struct lr1110_wifi_scheduler_cfg cfg = {
+        .base                   = lr1110_get_default_wifi_settings(),
+        .min_results            = 3,
+        .hit_rate_target        = 80,
+        .reprobe_interval       = 10,
+        .min_scan_per_channel   = 3,
+    };
+    return cfg;
+}
+
+
+/*!
+ * @brief               Initializes scheduler. First scan is full band.
+ *
+ * @param[out] sched    Scheduler
+ * @param[in] cfg       Configuration, copied
+ */
+void lr1110_wifi_scheduler_init(struct lr1110_wifi_scheduler * sched,
+                                const struct lr1110_wifi_scheduler_cfg * cfg)
+{
+    memset(sched, 0, sizeof(*sched));
+    sched->cfg = *cfg;
+    sched->cfg.min_scan_per_channel = MAX(1, MIN(cfg->min_scan_per_channel,
+                                          cfg->base.nb_scan_per_channel));
+    sched->last = cfg->base;
+    sched->hit_rate = WIFI_SCHED_Q8(100);
+    sched->nb_scan_per_channel = cfg->base.nb_scan_per_channel;
+    sched->probing = true;
+}
+
+
+/*!
+ * @brief               Returns settings for next scan. Full band base
+ *                      settings are returned on re-probe and while hit rate
+ *                      is below target, otherwise only productive channels
+ *                      and non-overlapping channels 1, 6 and 11 are scanned.
+ *
+ * @param[in] sched     Scheduler
+ *
+ * @return              Wifi settings
+ */
+struct wifi_settings
+lr1110_wifi_scheduler_next(struct lr1110_wifi_scheduler * sched)
+{
+    struct wifi_settings settings = sched->cfg.base;
+
+    sched->scans_since_probe++;
+    sched->probing = sched->hit_rate < 
+                     WIFI_SCHED_Q8(sched->cfg.hit_rate_target) ||
+                     (sched->cfg.reprobe_interval &&
+                      sched->scans_since_probe >= sched->cfg.reprobe_interval);
+
+    if (sched->probing) {
+        sched->scans_since_probe = 0;
+    }
+    else {
+        settings.channels = (productive_channels(sched) |
+                             DEMO_WIFI_CHANNELS_DEFAULT) &
+                            sched->cfg.base.channels;
+        if (!settings.channels) {
+            settings.channels = sched->cfg.base.channels;
+        }
+    }
+    settings.nb_scan_per_channel = sched->nb_scan_per_channel;
+
+    memset(sched->channel_hits, 0, sizeof(sched->channel_hits));
+    sched->last = settings;
+    return settings;
+}
+
+
+/*!
+ * @brief               Learns from results of scan done with settings from
+ *                      last lr1110_wifi_scheduler_next call. Results can be
+ *                      passed as aps, or fed into scheduler with streaming
+ *                      callbacks before this call, in which case aps is NULL.
+ *
+ * @param[in] sched     Scheduler
+ * @param[in] wifi_diagnostics  Diagnostics of scan
+ * @param[in] aps       Found access points, can be NULL
+ * @param[in] nb_aps    Number of access points
+ */
+void lr1110_wifi_scheduler_update(struct lr1110_wifi_scheduler * sched,
+                                  struct wifi_diagnostics wifi_diagnostics,
+                                  const struct lr1110_wifi_ap * aps,
+                                  uint8_t nb_aps)
+{
+    const struct lr1110_wifi_scheduler_cfg * cfg = &sched->cfg;
+    int hit = wifi_diagnostics.num_wifi_results >= cfg->min_results ? 100 : 0;
+
+    for (uint8_t i = 0; aps && i < nb_aps; i++) {
+        add_channel_hit(sched, aps[i].channel);
+    }
+
+    /* Only scanned channels are learned, others keep their score until
+     * next re-probe */
+    for (uint8_t ch = 0; ch < LR1110_WIFI_NB_CHANNELS; ch++)
+    {
+        if (sched->last.channels & (1 << ch)) {
+            sched->channel_score[ch] = 
+                ewma_update(sched->channel_score[ch],
+                            WIFI_SCHED_Q8(sched->channel_hits[ch]),
+                            WIFI_SCHED_SCORE_SHIFT);
+        }
+    }
+    memset(sched->channel_hits, 0, sizeof(sched->channel_hits));
+
+    sched->hit_rate = ewma_update(sched->hit_rate, WIFI_SCHED_Q8(hit),
+                                  WIFI_SCHED_HIT_RATE_SHIFT);
+
+    if (wifi_diagnostics.num_wifi_results >= sched->last.max_results) {
+        /* Result list is full, fewer scans would find the same */
+        sched->nb_scan_per_channel =
+            MAX(cfg->min_scan_per_channel,
+                sched->nb_scan_per_channel - sched->nb_scan_per_channel / 4);
+    }
+    else if (!hit) {
+        sched->nb_scan_per_channel =
+            MIN(cfg->base.nb_scan_per_channel,
+                sched->nb_scan_per_channel + 1 +
+                sched->nb_scan_per_channel / 4);
+    }
+}
+
+
+/*!
+ * @brief               Streaming reader callback that feeds basic results
+ *                      into scheduler passed as user_data
+ */
+bool lr1110_wifi_scheduler_results_cb(void * context,
+                                      const lr1110_wifi_basic_complete_result_t * results,
+                                      uint8_t start_index,
+                                      uint8_t nb_results,
+                                      void * user_data)
+{
+    for (uint8_t i = 0; i < nb_results; i++)
+    {
+        struct lr1110_wifi_ap ap;
+
+        lr1110_wifi_ap_from_basic(&results[i], &ap);
+        add_channel_hit(user_data, ap.channel);
+    }
+    return true;
+}
+
+
+/*!
+ * @brief               Streaming reader callback that feeds extended results
+ *                      into scheduler passed as user_data
+ */
+bool lr1110_wifi_scheduler_ext_results_cb(void * context,
+                                          const lr1110_wifi_extended_full_result_t * results,
+                                          uint8_t start_index,
+                                          uint8_t nb_results,
+                                          void * user_data)
+{
+    for (uint8_t i = 0; i < nb_results; i++)
+    {
+        struct lr1110_wifi_ap ap;
+
+        lr1110_wifi_ap_from_ext(&results[i], &ap);
+        add_channel_hit(user_data, ap.channel);
+    }
+    return true;
+}
+
+/* -------------------------------------------------------------------------
+ * PRIVATE IMPLEMENTATIONS
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * @brief               Counts AP found on channel, 1 to 14
+ */
+static void add_channel_hit(struct lr1110_wifi_scheduler * sched,
+                            uint8_t channel)
+{
+    if (channel >= 1 && channel <= LR1110_WIFI_NB_CHANNELS &&
+        sched->channel_hits[channel - 1] < UINT8_MAX) {
+        sched->channel_hits[channel - 1]++;
+    }
+}
+
+
+/*!
+ * @brief               Channels with average AP count above threshold
+ */
+static lr1110_wifi_channel_mask_t
+productive_channels(const struct lr1110_wifi_scheduler * sched)
+{
+    lr1110_wifi_channel_mask_t mask = 0;
+
+    for (uint8_t ch = 0; ch < LR1110_WIFI_NB_CHANNELS; ch++)
+    {
+        /* Threshold is in q4, score in q8 */
+        if (sched->channel_score[ch] >= 
+            (LR1110_WIFI_SCHED_CHANNEL_THRESHOLD_Q4 << 4)) {
+            mask |= 1 << ch;
+        }
+    }
+    return mask;
+}
+
+
+/*!
+ * @brief               Moves average towards sample by 1/2^shift of their
+ *                      difference, rounded to nearest. Step is at least
+ *                      one, so average reaches the sample.
+ */
+static int32_t ewma_update(int32_t average, int32_t sample, uint8_t shift)
+{
+    int32_t diff = sample - average;
+    int32_t half = (1 << shift) / 2;
+    int32_t step = (diff >= 0 ? diff + half : diff - half) / (1 << shift);
+
+    if (!step && diff) {
+        step = diff > 0 ? 1 : -1;
+    }
+    return average + step;
+}
+
+/*** end of file ***/
@@ -0,0 +1,80 @@
+/** @file lr1110_wifi_scheduler.h
+ *
+ * @brief       Adaptive selection of wifi scan parameters. Learns on which
+ *              channels access points are found and scans only those,
+ *              lowers number of scans per channel while results saturate
+ *              and periodically re-probes full band, so new APs on other
+ *              channels are not missed. If share of scans with enough
+ *              results falls below target, full band settings are used
+ *              until it recovers.
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 Irnas.  All rights reserved.
+ */
+
+#ifndef LR1110_WIFI_SCHEDULER_H
+#define LR1110_WIFI_SCHEDULER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "lr1110_wifi_scan.h"
+#include "lr1110_wifi_codec.h"
+
+#define LR1110_WIFI_NB_CHANNELS     14
+
+/*!
+ * @brief Scheduler configuration
+ */
+struct lr1110_wifi_scheduler_cfg {
+    struct wifi_settings base;      /* Full band settings, used to re-probe */
+    uint8_t min_results;            /* Scan with this many results is a hit */
+    uint8_t hit_rate_target;        /* Target share of hits, in percent */
+    uint8_t reprobe_interval;       /* Every n-th scan is full band, 0 never */
+    uint8_t min_scan_per_channel;   /* Lower limit for nb_scan_per_channel */
+};
+
+/*!
+ * @brief Scheduler state, owned by caller
+ */
+struct lr1110_wifi_scheduler {
+    struct lr1110_wifi_scheduler_cfg cfg;
+    struct wifi_settings last;      /* Settings returned by last next() */
+    uint16_t channel_score[LR1110_WIFI_NB_CHANNELS];  /* APs per scan, q8 */
+    uint8_t channel_hits[LR1110_WIFI_NB_CHANNELS];    /* APs in last scan */
+    uint16_t hit_rate;              /* Moving average, percent in q8 */
+    uint8_t nb_scan_per_channel;
+    uint8_t scans_since_probe;
+    bool probing;                   /* Last settings were full band */
+};
+
+void lr1110_wifi_scheduler_init(struct lr1110_wifi_scheduler * sched,
+                                const struct lr1110_wifi_scheduler_cfg * cfg);
+struct lr1110_wifi_scheduler_cfg lr1110_wifi_scheduler_default_cfg(void);
+struct wifi_settings
+lr1110_wifi_scheduler_next(struct lr1110_wifi_scheduler * sched);
+void lr1110_wifi_scheduler_update(struct lr1110_wifi_scheduler * sched,
+                                  struct wifi_diagnostics wifi_diagnostics,
+                                  const struct lr1110_wifi_ap * aps,
+                                  uint8_t nb_aps);
+
+bool lr1110_wifi_scheduler_results_cb(void * context,
+                                      const lr1110_wifi_basic_complete_result_t * results,
+                                      uint8_t start_index,
+                                      uint8_t nb_results,
+                                      void * user_data);
+bool lr1110_wifi_scheduler_ext_results_cb(void * context,
+                                          const lr1110_wifi_extended_full_result_t * results,
+                                          uint8_t start_index,
+                                          uint8_t nb_results,
+                                          void * user_data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LR1110_WIFI_SCHEDULER_H */
+/*** end of file ***/
@@ -0,0 +1,363 @@
+/** @file lr1110_wifi_serialize.c
+ *
+ * @brief       Serializes wifi scan results as JSON or CBOR.
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 Irnas.  All rights reserved.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include "lr1110_wifi_serialize.h"
+#include "lr1110_wifi_codec.h"
+
+/* -------------------------------------------------------------------------
+ * PRIVATE VARIABLES
+ * ------------------------------------------------------------------------- */
+
+/* CBOR major types */
+#define CBOR_UINT           0
+#define CBOR_NINT           1
+#define CBOR_BYTES          2
+#define CBOR_TEXT           3
+#define CBOR_ARRAY          4
+#define CBOR_MAP            5
+
+/* Output cursor. Length is counted even when buffer is full or NULL, so
+ * the same pass gives the exact size. */
+struct writer {
+    enum lr1110_wifi_format format;
+    uint8_t * buf;
+    size_t size;
+    size_t len;
+};
+
+static const char hex_digits[] = "0123456789abcdef";
+
+/* -------------------------------------------------------------------------
+ * PRIVATE PROTOTYPES
+ * ------------------------------------------------------------------------- */
+static int serialize(struct writer * w,
+                     struct wifi_diagnostics wifi_diagnostics,
+                     const lr1110_wifi_basic_complete_result_t * results,
+                     const lr1110_wifi_extended_full_result_t * ext_results);
+static void put_ap(struct writer * w,
+                   const struct lr1110_wifi_ap * ap,
+                   const uint8_t * ssid);
+static void put_raw(struct writer * w, const void * data, size_t len);
+static void put_char(struct writer * w, char c);
+static void put_cbor_head(struct writer * w, uint8_t major, uint32_t value);
+static void put_key(struct writer * w, const char * key, bool first);
+static void put_int(struct writer * w, int32_t value);
+static void put_mac(struct writer * w, const uint8_t * mac);
+static void put_ssid(struct writer * w, const uint8_t * ssid);
+
+/* -------------------------------------------------------------------------
+ * PUBLIC IMPLEMENTATIONS
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * @brief               Serializes basic results
+ *
+ * @param[in] format    JSON or CBOR
+ * @param[in] wifi_diagnostics  Diagnostics of scan, gives number of results
+ * @param[in] results   Results
+ * @param[out] buf      Output buffer, NULL to query size
+ * @param[in] buf_size  Size of output buffer
+ *
+ * @return              Length of output in bytes, -ENOMEM if buffer is too
+ *                      small, -EINVAL on unknown format. JSON output is 
+ *                      also NUL terminated if there is room for it, which 
+ *                      is not included in length.
+ */
+int lr1110_wifi_serialize(enum lr1110_wifi_format format,
+                          struct wifi_diagnostics wifi_diagnostics,
+                          const lr1110_wifi_basic_complete_result_t * results,
+                          uint8_t * buf,
+                          size_t buf_size)
+{
+    struct writer w = { format, buf, buf_size, 0 };
+
+    return serialize(&w, wifi_diagnostics, results, NULL);
+}
+
+
+/*!
+ * @brief               Same as lr1110_wifi_serialize, for extended results.
+ *                      BSSID (address 3) is used as MAC address.
+ */
+int lr1110_wifi_serialize_ext(enum lr1110_wifi_format format,
+                              struct wifi_diagnostics wifi_diagnostics,
+                              const lr1110_wifi_extended_full_result_t * results,
+                              uint8_t * buf,
+                              size_t buf_size)
+{
+    struct writer w = { format, buf, buf_size, 0 };
+
+    return serialize(&w, wifi_diagnostics, NULL, results);
+}
+
+/* -------------------------------------------------------------------------
+ * PRIVATE IMPLEMENTATIONS
+ * ------------------------------------------------------------------------- */
+
+/*!
+ * @brief               Writes whole document, either results or ext_results
+ *                      is set
+ */
+static int serialize(struct writer * w,
+                     struct wifi_diagnostics wifi_diagnostics,
+                     const lr1110_wifi_basic_complete_result_t * results,
+                     const lr1110_wifi_extended_full_result_t * ext_results)
+{
+    if (w->format != LR1110_WIFI_FORMAT_JSON &&
+        w->format != LR1110_WIFI_FORMAT_CBOR) {
+        return -EINVAL;
+    }
+
+    if (w->format == LR1110_WIFI_FORMAT_CBOR) {
+        put_cbor_head(w, CBOR_MAP, 2);
+    }
+    else {
+        put_char(w, '{');
+    }
+    put_key(w, "scan_ms", true);
+    put_int(w, wifi_diagnostics.wifi_scan_duration);
+    put_key(w, "results", false);
+
+    if (w->format == LR1110_WIFI_FORMAT_CBOR) {
+        put_cbor_head(w, CBOR_ARRAY, wifi_diagnostics.num_wifi_results);
+    }
+    else {
+        put_char(w, '[');
+    }
+
+    for (uint8_t i = 0; i < wifi_diagnostics.num_wifi_results; i++)
+    {
+        struct lr1110_wifi_ap ap;
+
+        if (w->format == LR1110_WIFI_FORMAT_JSON && i) {
+            put_char(w, ',');
+        }
+        if (ext_results) {
+            lr1110_wifi_ap_from_ext(&ext_results[i], &ap);
+            put_ap(w, &ap, ext_results[i].ssid_bytes);
+        }
+        else {
+            lr1110_wifi_ap_from_basic(&results[i], &ap);
+            put_ap(w, &ap, NULL);
+        }
+    }
+
+    if (w->format == LR1110_WIFI_FORMAT_JSON) {
+        put_raw(w, "]}", 2);
+    }
+
+    if (w->buf && w->len > w->size) {
+        return -ENOMEM;
+    }
+    if (w->buf && w->format == LR1110_WIFI_FORMAT_JSON && w->len < w->size) {
+        w->buf[w->len] = '\0';
+    }
+    return w->len;
+}
+
+
+/*!
+ * @brief               Writes one result as map or object
+ */
+static void put_ap(struct writer * w,
+                   const struct lr1110_wifi_ap * ap,
+                   const uint8_t * ssid)
+{
+    if (w->format == LR1110_WIFI_FORMAT_CBOR) {
+        put_cbor_head(w, CBOR_MAP, ssid ? 5 : 4);
+    }
+    else {
+        put_char(w, '{');
+    }
+
+    put_key(w, "mac", true);
+    put_mac(w, ap->mac);
+    put_key(w, "rssi", false);
+    put_int(w, ap->rssi);
+    put_key(w, "channel", false);
+    put_int(w, ap->channel);
+    put_key(w, "type", false);
+    put_int(w, ap->signal_type);
+    if (ssid) {
+        put_key(w, "ssid", false);
+        put_ssid(w, ssid);
+    }
+
+    if (w->format == LR1110_WIFI_FORMAT_JSON) {
+        put_char(w, '}');
+    }
+}
+
+
+/*!
+ * @brief               Appends bytes, as far as they fit
+ */
+static void put_raw(struct writer * w, const void * data, size_t len)
+{
+    if (w->buf && w->len < w->size) {
+        size_t room = w->size - w->len;
+
+        memcpy(&w->buf[w->len], data, len < room ? len : room);
+    }
+    w->len += len;
+}
+
+
+static void put_char(struct writer * w, char c)
+{
+    put_raw(w, &c, 1);
+}
+
+
+/*!
+ * @brief               Writes CBOR item head with shortest argument
+ */
+static void put_cbor_head(struct writer * w, uint8_t major, uint32_t value)
+{
+    uint8_t head[5];
+    uint8_t len;
+
+    if (value < 24) {
+        head[0] = (major << 5) | value;
+        len = 1;
+    }
+    else if (value <= UINT8_MAX) {
+        head[0] = (major << 5) | 24;
+        head[1] = value;
+        len = 2;
+    }
+    else if (value <= UINT16_MAX) {
+        head[0] = (major << 5) | 25;
+        head[1] = value >> 8;
+        head[2] = value;
+        len = 3;
+    }
+    else {
+        head[0] = (major << 5) | 26;
+        head[1] = value >> 24;
+        head[2] = value >> 16;
+        head[3] = value >> 8;
+        head[4] = value;
+        len = 5;
+    }
+    put_raw(w, head, len);
+}
+
+
+/*!
+ * @brief               Writes map key, in JSON preceded by comma unless it
+ *                      is the first one
+ */
+static void put_key(struct writer * w, const char * key, bool first)
+{
+    size_t len = strlen(key);
+
+    if (w->format == LR1110_WIFI_FORMAT_CBOR) {
+        put_cbor_head(w, CBOR_TEXT, len);
+        put_raw(w, key, len);
+        return;
+    }
+
+    if (!first) {
+        put_char(w, ',');
+    }
+    put_char(w, '"');
+    put_raw(w, key, len);
+    put_raw(w, "\":", 2);
+}
+
+
+static void put_int(struct writer * w, int32_t value)
+{
+    char digits[11];
+    uint8_t n = 0;
+    uint32_t abs_value = value < 0 ? -(uint32_t) value : (uint32_t) value;
+
+    if (w->format == LR1110_WIFI_FORMAT_CBOR) {
+        if (value < 0) {
+            put_cbor_head(w, CBOR_NINT, abs_value - 1);
+        }
+        else {
+            put_cbor_head(w, CBOR_UINT, abs_value);
+        }
+        return;
+    }
+
+    if (value < 0) {
+        put_char(w, '-');
+    }
+    do {
+        digits[sizeof(digits) - ++n] = '0' + abs_value % 10;
+        abs_value /= 10;
+    } while (abs_value);
+    put_raw(w, &digits[sizeof(digits) - n], n);
+}
+
+
+static void put_mac(struct writer * w, const uint8_t * mac)
+{
+    char text[3 * LR1110_WIFI_MAC_ADDRESS_LENGTH + 1];
+    uint8_t n = 0;
+
+    if (w->format == LR1110_WIFI_FORMAT_CBOR) {
+        put_cbor_head(w, CBOR_BYTES, LR1110_WIFI_MAC_ADDRESS_LENGTH);
+        put_raw(w, mac, LR1110_WIFI_MAC_ADDRESS_LENGTH);
+        return;
+    }
+
+    text[n++] = '"';
+    for (uint8_t i = 0; i < LR1110_WIFI_MAC_ADDRESS_LENGTH; i++)
+    {
+        text[n++] = hex_digits[mac[i] >> 4];
+        text[n++] = hex_digits[mac[i] & 0x0F];
+        text[n++] = i < LR1110_WIFI_MAC_ADDRESS_LENGTH - 1 ? ':' : '"';
+    }
+    put_raw(w, text, n);
+}
+
+
+/*!
+ * @brief               Writes SSID, up to first NUL. In JSON quotes,
+ *                      backslashes and non printable bytes are escaped.
+ */
+static void put_ssid(struct writer * w, const uint8_t * ssid)
+{
+    size_t len = strnlen((const char *) ssid, LR1110_WIFI_RESULT_SSID_LENGTH);
+
+    if (w->format == LR1110_WIFI_FORMAT_CBOR) {
+        put_cbor_head(w, CBOR_BYTES, len);
+        put_raw(w, ssid, len);
+        return;
+    }
+
+    put_char(w, '"');
+    for (size_t i = 0; i < len; i++)
+    {
+        uint8_t c = ssid[i];
+
+        if (c == '"' || c == '\\') {
+            char escaped[2] = { '\\', c };
+
+            put_raw(w, escaped, 2);
+        }
+        else if (c < 0x20 || c >= 0x7F) {
+            char escaped[6] = { '\\', 'u', '0', '0',
+                                hex_digits[c >> 4], hex_digits[c & 0x0F] };
+
+            put_raw(w, escaped, 6);
+        }
+        else {
+            put_char(w, c);
+        }
+    }
+    put_char(w, '"');
+}
+
+/*** end of file ***/
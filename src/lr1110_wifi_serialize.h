@@ -0,0 +1,51 @@
+/** @file lr1110_wifi_serialize.h
+ *
+ * @brief       Serializes wifi scan results as JSON or CBOR into caller
+ *              supplied buffer, in one pass, without allocations. Passing
+ *              NULL buffer returns exact size of output, so buffer can be
+ *              sized before serializing.
+ *
+ *              JSON:
+ *              {"scan_ms":1234,"results":[{"mac":"aa:bb:cc:dd:ee:ff",
+ *              "rssi":-70,"channel":6,"type":2,"ssid":"name"}]}
+ *
+ *              CBOR has same structure, MAC address and SSID are byte
+ *              strings. "ssid" is present only for extended results.
+ *
+ * @par
+ * COPYRIGHT NOTICE: (c) 2021 Irnas.  All rights reserved.
+ */
+
+#ifndef LR1110_WIFI_SERIALIZE_H
+#define LR1110_WIFI_SERIALIZE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include "lr1110_wifi_scan.h"
+
+enum lr1110_wifi_format {
+    LR1110_WIFI_FORMAT_JSON = 0,
+    LR1110_WIFI_FORMAT_CBOR,
+};
+
+int lr1110_wifi_serialize(enum lr1110_wifi_format format,
+                          struct wifi_diagnostics wifi_diagnostics,
+                          const lr1110_wifi_basic_complete_result_t * results,
+                          uint8_t * buf,
+                          size_t buf_size);
+int lr1110_wifi_serialize_ext(enum lr1110_wifi_format format,
+                              struct wifi_diagnostics wifi_diagnostics,
+                              const lr1110_wifi_extended_full_result_t * results,
+                              uint8_t * buf,
+                              size_t buf_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LR1110_WIFI_SERIALIZE_H */
+/*** end of file ***/